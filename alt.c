@@ -0,0 +1,171 @@
+/* alt.c -- landmark (ALT) heuristic for the A* search.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sat Oct 17 13:20:37 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "graph.h"
+#include "alt.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+/* costs from s (over the links, if fwd) or to s (over the reverse
+ * links) of all the nodes, in 64 bits, into the column i of the
+ * table tab of k columns.  Nodes not reached get D_ALT_INF. */
+static void
+lm_search(
+        const struct d_csr *csr,
+        struct d_heap      *heap,
+        int                 fwd,
+        int                 s,
+        int64_t            *tab,
+        int                 k,
+        int                 i)
+{
+    const uint32_t *off = fwd ? csr->off : csr->r_off;
+    const uint32_t *nod = fwd ? csr->tgt : csr->r_src;
+    const int32_t  *wgt = fwd ? csr->wgt : csr->r_wgt;
+    uint32_t v, e;
+    int64_t c;
+    int u;
+
+    for (v = 0; v < csr->n; ++v)
+        tab[(size_t)v * k + i] = D_ALT_INF;
+    d_heap_clear(heap);
+    tab[(size_t)s * k + i] = 0;
+    d_heap_push(heap, s, 0);
+    /* a node popped has its final cost, and no link improves it
+     * again, so it is not pushed twice */
+    while ((u = d_heap_pop(heap, &c)) >= 0) {
+        for (e = off[u]; e < off[u + 1]; ++e) {
+            int64_t *t = &tab[(size_t)nod[e] * k + i];
+            if (c + wgt[e] < *t) {
+                *t = c + wgt[e];
+                d_heap_push(heap, nod[e], *t);
+            }
+        }
+    }
+} /* lm_search */
+
+struct d_alt *
+d_alt_new(
+        struct d_graph   *graph,
+        int               k,
+        int               flags)
+{
+    d_freeze(graph, flags);
+
+    struct d_csr *csr = graph->csr;
+    if (!__atomic_load_n(&csr->r_off, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&graph->mtx);
+        d_csr_build_reverse(csr);
+        pthread_mutex_unlock(&graph->mtx);
+    }
+
+    int n = csr->n, i, v;
+    if (k > n) k = n;
+    if (k < 1) k = 1;
+
+    size_t nk = (size_t)n * k;
+    struct d_alt *res = calloc(1, sizeof *res);
+    assert(res != NULL);
+    res->graph = graph;
+    res->k     = k;
+    res->lm    = malloc(k * sizeof *res->lm);
+    res->from  = malloc((nk ? nk : 1) * sizeof *res->from);
+    res->to    = malloc((nk ? nk : 1) * sizeof *res->to);
+    assert(res->lm && res->from && res->to);
+    if (n == 0) {
+        res->k = 0;
+        return res;
+    }
+
+    /* closest landmark cost of each node (in any direction), to
+     * select the next landmark as the farthest node from the ones
+     * already selected.  The first one is the farthest node from
+     * node 0.  Costs are 64 bit, so the bounds are right whatever
+     * the arithmetic of the searches is. */
+    int64_t *near = malloc(n * sizeof *near);
+    assert(near != NULL);
+    for (v = 0; v < n; ++v) near[v] = -1;
+
+    struct d_heap *heap = d_graph_heap_new(graph, n);
+    int next = 0;
+    lm_search(csr, heap, 1, 0, res->from, k, 0);
+    for (v = 0; v < n; ++v)
+        if (res->from[(size_t)v * k] != D_ALT_INF
+                && res->from[(size_t)v * k] > res->from[(size_t)next * k])
+            next = v;
+
+    for (i = 0; i < k; ++i) {
+        res->lm[i] = next;
+        if (flags & D_FLAG_DEBUG)
+            printf(F("landmark #%d: %s\n"), i, d_csr_name(csr, next));
+
+        lm_search(csr, heap, 1, next, res->from, k, i);
+        lm_search(csr, heap, 0, next, res->to, k, i);
+        for (v = 0; v < n; ++v) {
+            int64_t f = res->from[(size_t)v * k + i];
+            int64_t t = res->to[(size_t)v * k + i];
+            int64_t c = f < t ? f : t;
+            if (c != D_ALT_INF && (near[v] < 0 || c < near[v]))
+                near[v] = c;
+        }
+
+        /* the next one is the farthest from all of these */
+        for (v = 0, next = -1; v < n; ++v)
+            if (near[v] > 0 && (next < 0 || near[v] > near[next]))
+                next = v;
+        if (next < 0) {
+            /* nodes not connected to the landmarks, if any, are
+             * taken in order */
+            for (v = 0; v < n && near[v] >= 0; ++v)
+                continue;
+            if (v == n) {
+                res->k = i + 1; /* no more nodes to choose */
+                break;
+            }
+            next = v;
+        }
+    }
+    if (res->k < k) {
+        /* repack the tables to the final number of landmarks */
+        int kk = res->k, j;
+        for (v = 0; v < n; ++v)
+            for (j = 0; j < kk; ++j) {
+                res->from[(size_t)v * kk + j] = res->from[(size_t)v * k + j];
+                res->to[(size_t)v * kk + j]   = res->to[(size_t)v * k + j];
+            }
+    }
+    d_heap_free(heap);
+    free(near);
+    return res;
+} /* d_alt_new */
+
+void
+d_alt_free(
+        struct d_alt     *alt)
+{
+    if (!alt) return;
+    free(alt->lm);
+    free(alt->from);
+    free(alt->to);
+    free(alt);
+} /* d_alt_free */
+
+int
+d_alt_heuristic(
+        struct d_node    *nod,
+        struct d_node    *dest,
+        void             *alt)
+{
+    int64_t res = d_alt_bound(alt, nod->id, dest->id);
+    return res < INT_MAX ? res : INT_MAX;
+} /* d_alt_heuristic */
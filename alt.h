@@ -0,0 +1,65 @@
+/* alt.h -- landmark (ALT) heuristic for the A* search.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sat Oct 17 13:20:37 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _ALT_H
+#define _ALT_H
+
+#include "dijkstra.h"
+
+struct d_alt;                  /* opaque */
+
+/**
+ * Precompute the landmark heuristic of a graph.
+ *
+ * Selects k landmark nodes, each one as far as possible from the
+ * ones already selected, and runs a full search from each of
+ * them (as d_dijkstra(graph, landmark, NULL, flags) does) and a
+ * full search to each of them, over the reverse links, storing
+ * the costs to and from the landmarks of every node.  By the
+ * triangle inequality, these costs give a lower bound of the
+ * cost between any two nodes, see d_alt_heuristic().
+ *
+ * The graph is frozen (see d_freeze()) and must not be modified
+ * while the heuristic is in use.  The costs are kept in 64 bits,
+ * whatever the arithmetic of the searches (see d_set_costs()), so
+ * memory used is 16 * k bytes per node.
+ *
+ * @param graph is the graph to precompute the heuristic for.
+ * @param k is the number of landmarks.
+ * @return the heuristic data, to be passed as calldata of
+ *         d_alt_heuristic().
+ */
+struct d_alt *
+d_alt_new(
+        struct d_graph   *graph,
+        int               k,
+        int               flags);
+
+/**
+ * Free the landmark heuristic data.
+ */
+void
+d_alt_free(
+        struct d_alt     *alt);
+
+/**
+ * The landmark heuristic, to be used with d_astar() or
+ * d_set_heuristic() with the data returned by d_alt_new() as
+ * calldata.  It is consistent, so the costs found by A* are the
+ * minimum ones.
+ *
+ * @return a lower bound of the cost to go from nod to dest, or
+ *         INT_MAX if dest cannot be reached from nod (or the bound
+ *         doesn't fit in an int).
+ */
+int
+d_alt_heuristic(
+        struct d_node    *nod,
+        struct d_node    *dest,
+        void             *alt);
+
+#endif /* _ALT_H */
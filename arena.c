@@ -0,0 +1,110 @@
+/* arena.c -- arena and slab allocator for graph objects.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 16:48:03 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define MIN_CHUNK           (64 * 1024)
+#define MAX_CHUNK           (16 * 1024 * 1024)
+#define CHUNK_ALIGN         16
+
+struct d_arena_chunk {
+    struct d_arena_chunk
+                   *next;      /* previously allocated chunk */
+    size_t          size;      /* size of the chunk, header included */
+};
+
+void
+d_arena_init(
+        struct d_arena   *a)
+{
+    memset(a, 0, sizeof *a);
+    a->chunk_sz = MIN_CHUNK;
+} /* d_arena_init */
+
+void
+d_arena_destroy(
+        struct d_arena   *a)
+{
+    struct d_arena_chunk *c = a->chunks;
+    while (c) {
+        struct d_arena_chunk *next = c->next;
+        free(c);
+        c = next;
+    }
+    d_arena_init(a);
+} /* d_arena_destroy */
+
+void *
+d_arena_alloc(
+        struct d_arena   *a,
+        size_t            size,
+        size_t            align)
+{
+    size_t pad = (-(uintptr_t)a->cur) & (align - 1);
+
+    if (!a->cur || pad + size > a->left) {
+        /* need a new chunk.  Chunks grow geometrically, so the
+         * number of chunks is logarithmic in the memory used. */
+        size_t hdr = (sizeof(struct d_arena_chunk) + CHUNK_ALIGN - 1)
+                & ~(size_t)(CHUNK_ALIGN - 1);
+        size_t sz  = a->chunk_sz;
+        if (sz < hdr + size + align)
+            sz = hdr + size + align;
+        struct d_arena_chunk *c = malloc(sz);
+        assert(c != NULL);
+        c->next     = a->chunks;
+        c->size     = sz;
+        a->chunks   = c;
+        a->cur      = (char *)c + hdr;
+        a->left     = sz - hdr;
+        a->reserved += sz;
+        if (a->chunk_sz < MAX_CHUNK)
+            a->chunk_sz <<= 1;
+        pad = (-(uintptr_t)a->cur) & (align - 1);
+    }
+    void *res = a->cur + pad;
+    a->cur  += pad + size;
+    a->left -= pad + size;
+    a->used += size;
+    return res;
+} /* d_arena_alloc */
+
+void *
+d_arena_slab_alloc(
+        struct d_arena   *a,
+        int               cls,
+        size_t            size)
+{
+    assert(cls >= 0 && cls < D_ARENA_CLASSES);
+    assert(size >= sizeof(void *));
+
+    void *res = a->free[cls];
+    if (res) {
+        memcpy(&a->free[cls], res, sizeof(void *));
+        a->slab_free -= size;
+        return res;
+    }
+    return d_arena_alloc(a, size, sizeof(void *));
+} /* d_arena_slab_alloc */
+
+void
+d_arena_slab_free(
+        struct d_arena   *a,
+        int               cls,
+        void             *block,
+        size_t            size)
+{
+    assert(cls >= 0 && cls < D_ARENA_CLASSES);
+    memcpy(block, &a->free[cls], sizeof(void *));
+    a->free[cls] = block;
+    a->slab_free += size;
+} /* d_arena_slab_free */
@@ -0,0 +1,84 @@
+/* arena.h -- arena and slab allocator for graph objects.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 16:48:03 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * This is an internal header.  An arena allocates memory from big
+ * chunks, and frees it all at once when the arena is destroyed.
+ * Blocks can be given back to the arena in size classes (slabs),
+ * so they are reused by later allocations of the same class
+ * (e.g. when an array is grown by doubling its capacity).
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+#define D_ARENA_CLASSES     32     /* number of slab size classes */
+
+struct d_arena_chunk;
+
+struct d_arena {
+    struct d_arena_chunk
+                   *chunks;    /* list of chunks, last allocated first */
+    char           *cur;       /* free space in the current chunk */
+    size_t          left;      /* bytes left in the current chunk */
+    size_t          chunk_sz;  /* size of the next chunk */
+    size_t          used;      /* bytes handed out */
+    size_t          reserved;  /* bytes allocated in chunks */
+    size_t          slab_free; /* bytes waiting in the free lists */
+    void           *free[D_ARENA_CLASSES]; /* free lists, per class */
+};
+
+/**
+ * Initialize an empty arena.  No memory is allocated until the
+ * first allocation.
+ */
+void
+d_arena_init(
+        struct d_arena   *arena);
+
+/**
+ * Release all the memory of the arena.  The cost depends on the
+ * number of chunks, not on the number of allocations.
+ */
+void
+d_arena_destroy(
+        struct d_arena   *arena);
+
+/**
+ * Allocate size bytes, aligned to align (a power of two).
+ * The memory is not initialized.
+ */
+void *
+d_arena_alloc(
+        struct d_arena   *arena,
+        size_t            size,
+        size_t            align);
+
+/**
+ * Allocate a block of size class cls.  All the blocks of a class
+ * must be of the same size (size), at least the size of a
+ * pointer.  The block is taken from the free list of the class,
+ * if not empty.
+ */
+void *
+d_arena_slab_alloc(
+        struct d_arena   *arena,
+        int               cls,
+        size_t            size);
+
+/**
+ * Give back a block of class cls (and size size) to the arena,
+ * for reuse.
+ */
+void
+d_arena_slab_free(
+        struct d_arena   *arena,
+        int               cls,
+        void             *block,
+        size_t            size);
+
+#endif /* _ARENA_H */
@@ -0,0 +1,282 @@
+/* batch.c -- batch of queries run by a pool of worker threads.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 14:22:10 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+#define SEP_STRING      ", \t\n"
+#define CHUNK_SIZE      4096    /* queries per chunk */
+#define GRAB_SIZE       16      /* queries taken by a worker at once */
+
+struct job {
+    char           *src;       /* source name */
+    char           *dst;       /* destination name */
+    char           *route;     /* route, if requested */
+    int64_t         cost;      /* result, -1 if unreached */
+    int             settled;   /* nodes settled by the query */
+    double          usec;      /* latency of the query */
+};
+
+struct chunk {
+    struct job      jobs[CHUNK_SIZE];
+    int             n;         /* number of jobs in the chunk */
+};
+
+struct pool {
+    pthread_mutex_t mtx;
+    pthread_cond_t  cv_work;   /* a chunk has been submitted */
+    pthread_cond_t  cv_done;   /* a chunk has been completed */
+    struct d_graph *graph;
+    struct chunk   *cur;       /* chunk being processed */
+    int             next;      /* next job to grab in cur */
+    int             done;      /* jobs completed in cur */
+    int             quit;      /* workers must exit */
+    int             opts;
+    int             flags;
+    struct d_stats  search;    /* counters of the finished workers */
+};
+
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0E-9;
+} /* now */
+
+static void
+run_job(struct pool *p, struct d_query *q, struct job *j)
+{
+    struct d_node *s = d_find_node(p->graph, j->src);
+    struct d_node *d = d_find_node(p->graph, j->dst);
+
+    j->cost    = -1;
+    j->route   = NULL;
+    j->settled = 0;
+    double t0 = now();
+    if (s && d) {
+        j->settled = d_query_run(q, s, d, p->flags);
+        j->cost = d_query_cost(q, d);
+    }
+    j->usec = (now() - t0) * 1.0E6;
+
+    if ((p->opts & D_BATCH_ROUTES) && j->cost >= 0) {
+        size_t sz;
+        FILE *f = open_memstream(&j->route, &sz);
+        assert(f != NULL);
+        d_query_print_route(f, q, d);
+        fclose(f);
+    }
+} /* run_job */
+
+static void *
+worker(void *arg)
+{
+    struct pool *p = arg;
+    struct d_query *q = d_query_new(p->graph, p->flags);
+
+    pthread_mutex_lock(&p->mtx);
+    for (;;) {
+        while (!p->quit && (!p->cur || p->next >= p->cur->n))
+            pthread_cond_wait(&p->cv_work, &p->mtx);
+        if (p->quit) break;
+
+        struct chunk *c = p->cur;
+        int i = p->next, end = i + GRAB_SIZE;
+        if (end > c->n) end = c->n;
+        p->next = end;
+        pthread_mutex_unlock(&p->mtx);
+
+        int k;
+        for (k = i; k < end; ++k)
+            run_job(p, q, &c->jobs[k]);
+
+        pthread_mutex_lock(&p->mtx);
+        p->done += end - i;
+        if (p->done == c->n)
+            pthread_cond_signal(&p->cv_done);
+    }
+    d_stats_add(&p->search, d_query_stats(q));
+    pthread_mutex_unlock(&p->mtx);
+    d_query_free(q);
+    return NULL;
+} /* worker */
+
+/* reads a chunk of queries, returns the number of queries read */
+static int
+read_chunk(FILE *in, struct chunk *c, char **line, size_t *cap)
+{
+    c->n = 0;
+    while (c->n < CHUNK_SIZE && getline(line, cap, in) >= 0) {
+        char *save;
+        char *src = strtok_r(*line, SEP_STRING, &save);
+        if (!src || src[0] == '#') continue;
+        char *dst = strtok_r(NULL, SEP_STRING, &save);
+        if (!dst) {
+            fprintf(stderr, F("WARNING: no destination node for "
+                    "'%s'.  Skipping this entry.\n"),
+                    src);
+            continue;
+        }
+        struct job *j = &c->jobs[c->n++];
+        j->src = strdup(src);
+        j->dst = strdup(dst);
+        assert(j->src != NULL && j->dst != NULL);
+    }
+    return c->n;
+} /* read_chunk */
+
+static void
+submit(struct pool *p, struct chunk *c)
+{
+    pthread_mutex_lock(&p->mtx);
+    p->cur  = c;
+    p->next = 0;
+    p->done = 0;
+    pthread_cond_broadcast(&p->cv_work);
+    pthread_mutex_unlock(&p->mtx);
+} /* submit */
+
+static void
+wait_chunk(struct pool *p)
+{
+    pthread_mutex_lock(&p->mtx);
+    while (p->done < p->cur->n)
+        pthread_cond_wait(&p->cv_done, &p->mtx);
+    p->cur = NULL;
+    pthread_mutex_unlock(&p->mtx);
+} /* wait_chunk */
+
+static int
+cmp_double(const void *a, const void *b)
+{
+    double A = *(const double *)a, B = *(const double *)b;
+    return (A > B) - (A < B);
+} /* cmp_double */
+
+/* nearest rank percentile (pct in [1, 100]) of the n > 0 sorted
+ * latencies: the smallest one with at least pct% of them at or
+ * below it */
+static double
+percentile(const double *lat, long n, int pct)
+{
+    long k = (pct * n + 99) / 100 - 1;
+    return lat[k < 0 ? 0 : k >= n ? n - 1 : k];
+} /* percentile */
+
+int
+d_batch_run(
+        struct d_graph       *graph,
+        FILE                 *in,
+        FILE                 *out,
+        int                   nthreads,
+        int                   opts,
+        int                   flags,
+        struct d_batch_stats *stats)
+{
+    struct pool p = {
+        .mtx     = PTHREAD_MUTEX_INITIALIZER,
+        .cv_work = PTHREAD_COND_INITIALIZER,
+        .cv_done = PTHREAD_COND_INITIALIZER,
+        .graph   = graph,
+        .opts    = opts,
+        .flags   = flags,
+    };
+    if (nthreads < 1) nthreads = 1;
+
+    /* freeze now, as workers cannot do it concurrently */
+    d_freeze(graph, flags);
+
+    pthread_t *th = malloc(nthreads * sizeof *th);
+    struct chunk *a = malloc(sizeof *a), *b = malloc(sizeof *b);
+    assert(th != NULL && a != NULL && b != NULL);
+
+    int i, res = 0;
+    for (i = 0; i < nthreads; ++i) {
+        if (pthread_create(&th[i], NULL, worker, &p)) {
+            fprintf(stderr, F("cannot create worker thread\n"));
+            nthreads = i;
+            res = -1;
+            break;
+        }
+    }
+
+    double *lat = NULL;
+    long lat_cap = 0, n = 0, unreached = 0;
+    double settled = 0.0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    double t0 = now();
+
+    if (nthreads > 0 && read_chunk(in, a, &line, &line_cap) > 0) {
+        submit(&p, a);
+        for (;;) {
+            /* read the next chunk while this one runs */
+            int more = read_chunk(in, b, &line, &line_cap);
+            wait_chunk(&p);
+            if (more) submit(&p, b);
+
+            for (i = 0; i < a->n; ++i) {
+                struct job *j = &a->jobs[i];
+                fprintf(out, "%s %s %lld %.3f", j->src, j->dst,
+                        (long long)j->cost, j->usec);
+                if (j->route) fprintf(out, " %s", j->route);
+                fputc('\n', out);
+                if (n == lat_cap) {
+                    lat_cap = lat_cap ? 2 * lat_cap : CHUNK_SIZE;
+                    lat = realloc(lat, lat_cap * sizeof *lat);
+                    assert(lat != NULL);
+                }
+                lat[n++] = j->usec;
+                if (j->cost < 0) unreached++;
+                settled += j->settled;
+                free(j->src); free(j->dst); free(j->route);
+            }
+            if (!more) break;
+            struct chunk *t = a; a = b; b = t;
+        }
+    }
+    double elapsed = now() - t0;
+
+    pthread_mutex_lock(&p.mtx);
+    p.quit = 1;
+    pthread_cond_broadcast(&p.cv_work);
+    pthread_mutex_unlock(&p.mtx);
+    for (i = 0; i < nthreads; ++i)
+        pthread_join(th[i], NULL);
+
+    if (stats) {
+        double sum = 0.0;
+        long k;
+        memset(stats, 0, sizeof *stats);
+        stats->queries   = n;
+        stats->unreached = unreached;
+        stats->elapsed   = elapsed;
+        stats->search    = p.search;
+        if (n > 0) {
+            for (k = 0; k < n; ++k) sum += lat[k];
+            qsort(lat, n, sizeof *lat, cmp_double);
+            stats->lat_avg = sum / n;
+            stats->lat_p50 = percentile(lat, n, 50);
+            stats->lat_p99 = percentile(lat, n, 99);
+            stats->lat_max = lat[n - 1];
+            stats->settled = settled / n;
+        }
+    }
+    free(lat);
+    free(line);
+    free(a); free(b);
+    free(th);
+    return res;
+} /* d_batch_run */
@@ -0,0 +1,66 @@
+/* batch.h -- batch of queries run by a pool of worker threads.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 14:22:10 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include <stdio.h>
+
+#include "dijkstra.h"
+
+#define D_BATCH_ROUTES      (1 << 0)   /* print the route of each query */
+
+struct d_batch_stats {
+    long            queries;   /* number of queries run */
+    long            unreached; /* queries with no path (or unknown nodes) */
+    double          elapsed;   /* wall time, in seconds */
+    double          lat_avg;   /* average latency, in microseconds */
+    double          lat_p50;   /* median latency */
+    double          lat_p99;   /* 99th percentile latency */
+    double          lat_max;   /* maximum latency */
+    double          settled;   /* average of nodes settled per query */
+    struct d_stats  search;    /* counters of the searches, added up
+                                * from all the workers */
+};
+
+/**
+ * Run a batch of queries on a graph.
+ *
+ * Reads pairs of node names (source and destination, one pair
+ * per line, with the same syntax used for the links of the graph,
+ * and '#' for comments) from in, and runs them in a pool of
+ * nthreads worker threads, each with its own query context.  The
+ * graph is frozen first, and it is not modified.
+ *
+ * Input is read in chunks, so the queries of one chunk run while
+ * the results of the previous one are written, and the next one
+ * is read.  Results are written to out in the same order of the
+ * input, one line per query, with the source and destination
+ * names, the cost (or -1 if the destination cannot be reached)
+ * and the latency of the query in microseconds.  With
+ * D_BATCH_ROUTES in opts, the route is printed at the end of
+ * the line.
+ *
+ * @param graph is the graph to run the queries on.
+ * @param in is the stream to read the queries from.
+ * @param out is the stream to write the results to.
+ * @param nthreads is the number of worker threads.
+ * @param opts is a combination of the D_BATCH_* flags.
+ * @param stats if not NULL, gets the statistics of the run.
+ * @return 0 on success, -1 on error.
+ */
+int
+d_batch_run(
+        struct d_graph       *graph,
+        FILE                 *in,
+        FILE                 *out,
+        int                   nthreads,
+        int                   opts,
+        int                   flags,
+        struct d_batch_stats *stats);
+
+#endif /* _BATCH_H */
@@ -0,0 +1,346 @@
+/* cache.c -- cache of the searches from the most used origins.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 23 09:51:26 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * An entry keeps the state of a search that matters to go on with
+ * it: the nodes settled (in order) and the nodes in the frontier,
+ * with their costs and parents, in arrays as long as the part of
+ * the graph explored, not as the graph.  Entries are indexed by
+ * origin id, and sit in the CLOCK ring.  Each one has a count of
+ * references, so the queries restore them out of the lock, while
+ * they can be evicted.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "graph.h"
+#include "cache.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+struct entry {
+    int              orig;     /* origin of the search */
+    int              n_set;    /* nodes settled, first in the arrays */
+    int              n_front;  /* nodes in the frontier, after them */
+    int              complete; /* the frontier is empty */
+    int              refs;     /* the cache (while in it) and the
+                                * queries restoring it */
+    int              used;     /* CLOCK reference bit */
+    int              pos;      /* index in the ring */
+    size_t           bytes;
+    int32_t         *ids;
+    int32_t         *cost;
+    int32_t         *back;
+};
+
+struct d_cache {
+    pthread_mutex_t  mtx;
+    struct entry   **slot;     /* entry of each origin id, or NULL */
+    uint32_t         slot_n;   /* nodes of the graph of slot */
+    struct entry   **ring;     /* the entries, in CLOCK order */
+    int              ring_n;
+    int              ring_cap;
+    int              hand;     /* next entry to look at for eviction */
+    struct d_cache_stats st;
+};
+
+static void
+release(struct entry *e)
+{
+    if (--e->refs > 0) return;
+    free(e->ids);
+    free(e);
+} /* release */
+
+/* takes the entry out of the cache, with the lock held */
+static void
+drop(struct d_cache *c, struct entry *e)
+{
+    struct entry *last = c->ring[--c->ring_n];
+    c->ring[e->pos] = last;
+    last->pos = e->pos;
+    if (c->hand >= c->ring_n) c->hand = 0;
+    c->slot[e->orig] = NULL;
+    c->st.entries--;
+    c->st.bytes -= e->bytes;
+    release(e);
+} /* drop */
+
+/* evicts entries until bytes more fit, with the lock held */
+static void
+make_room(struct d_cache *c, size_t bytes)
+{
+    while (c->ring_n > 0 && c->st.bytes + bytes > c->st.capacity) {
+        struct entry *e = c->ring[c->hand];
+        if (e->used) {
+            /* a second chance */
+            e->used = 0;
+            c->hand = (c->hand + 1) % c->ring_n;
+            continue;
+        }
+        drop(c, e);
+        c->st.evictions++;
+    }
+} /* make_room */
+
+static void
+clear(struct d_cache *c)
+{
+    while (c->ring_n > 0)
+        drop(c, c->ring[c->ring_n - 1]);
+    c->hand = 0;
+} /* clear */
+
+void
+d_cache_invalidate(
+        struct d_cache   *c)
+{
+    if (!c) return;
+    pthread_mutex_lock(&c->mtx);
+    if (c->ring_n > 0) c->st.invalidations++;
+    clear(c);
+    pthread_mutex_unlock(&c->mtx);
+} /* d_cache_invalidate */
+
+void
+d_cache_free(
+        struct d_cache   *c)
+{
+    if (!c) return;
+    clear(c);
+    free(c->slot);
+    free(c->ring);
+    pthread_mutex_destroy(&c->mtx);
+    free(c);
+} /* d_cache_free */
+
+int
+d_cache_set(
+        struct d_graph   *graph,
+        size_t            bytes)
+{
+    struct d_cache *c = graph->cache;
+
+    if (!bytes) {
+        d_cache_free(c);
+        graph->cache = NULL;
+        return 0;
+    }
+    if (!c) {
+        c = calloc(1, sizeof *c);
+        assert(c != NULL);
+        pthread_mutex_init(&c->mtx, NULL);
+        graph->cache = c;
+    }
+    pthread_mutex_lock(&c->mtx);
+    c->st.capacity = bytes;
+    make_room(c, 0);
+    pthread_mutex_unlock(&c->mtx);
+    return 0;
+} /* d_cache_set */
+
+/* the entry of orig, referenced, or NULL.  The index is fit to the
+ * graph, that may have been frozen again. */
+static struct entry *
+lookup(struct d_cache *c, uint32_t n, int orig)
+{
+    struct entry *res;
+
+    pthread_mutex_lock(&c->mtx);
+    if (c->slot_n != n) {
+        clear(c);
+        free(c->slot);
+        c->slot = calloc(n ? n : 1, sizeof *c->slot);
+        assert(c->slot != NULL);
+        c->slot_n = n;
+    }
+    res = c->slot[orig];
+    if (res) {
+        res->used = 1;
+        res->refs++;
+    }
+    pthread_mutex_unlock(&c->mtx);
+    return res;
+} /* lookup */
+
+/* the state of the search of the entry, in the query */
+static void
+restore(struct d_query *q, const struct entry *e)
+{
+    d_query_start(q);
+
+    uint32_t ep = q->epoch;
+    int i;
+    for (i = 0; i < e->n_set; ++i) {
+        int v = e->ids[i];
+        q->stamp[v] = ep + 1;
+        q->cost[v]  = e->cost[i];
+        q->back[v]  = e->back[i];
+        q->order[i] = v;
+    }
+    q->settled = e->n_set;
+    for (; i < e->n_set + e->n_front; ++i) {
+        int v = e->ids[i];
+        q->stamp[v] = ep;
+        q->cost[v]  = e->cost[i];
+        q->back[v]  = e->back[i];
+        d_heap_push(q->heap, v, e->cost[i]);
+    }
+    q->orig = e->orig;
+} /* restore */
+
+/* keeps the search of the query in the cache, replacing the entry
+ * of its origin.  The frontier is taken out of the heap of the
+ * query, that is not needed anymore.  A search stopped at dest has
+ * not relaxed its links, so dest goes back to the frontier. */
+static void
+store(struct d_cache *c, struct d_query *q, struct d_node *dest,
+        uint32_t n)
+{
+    int ns = q->settled, nf = d_heap_size(q->heap), i, v;
+    int stop = dest && ns > 0 && q->order[ns - 1] == dest->id;
+
+    if (stop) {
+        ns--;
+        nf++;
+    }
+    size_t bytes = sizeof(struct entry)
+            + (size_t)(ns + nf) * 3 * sizeof(int32_t);
+
+    if (bytes > c->st.capacity) {
+        pthread_mutex_lock(&c->mtx);
+        c->st.rejected++;
+        pthread_mutex_unlock(&c->mtx);
+        return;
+    }
+    struct entry *e = malloc(sizeof *e);
+    assert(e != NULL);
+    e->orig     = q->orig;
+    e->n_set    = ns;
+    e->n_front  = nf;
+    e->complete = nf == 0;
+    e->refs     = 1;
+    e->used     = 0;
+    e->bytes    = bytes;
+    e->ids      = malloc((ns + nf ? ns + nf : 1) * 3 * sizeof(int32_t));
+    assert(e->ids != NULL);
+    e->cost     = e->ids + ns + nf;
+    e->back     = e->cost + ns + nf;
+    for (i = 0; i < ns; ++i) {
+        v = q->order[i];
+        e->ids[i]  = v;
+        e->cost[i] = q->cost[v];
+        e->back[i] = q->back[v];
+    }
+    if (stop) {
+        v = dest->id;
+        e->ids[i]  = v;
+        e->cost[i] = q->cost[v];
+        e->back[i] = q->back[v];
+        i++;
+    }
+    while ((v = d_heap_pop(q->heap, NULL)) >= 0) {
+        e->ids[i]  = v;
+        e->cost[i] = q->cost[v];
+        e->back[i] = q->back[v];
+        i++;
+    }
+
+    pthread_mutex_lock(&c->mtx);
+    if (c->slot_n != n) {
+        /* the graph changed meanwhile */
+        pthread_mutex_unlock(&c->mtx);
+        release(e);
+        return;
+    }
+    if (c->slot[e->orig])
+        drop(c, c->slot[e->orig]);
+    make_room(c, bytes);
+    if (c->ring_n == c->ring_cap) {
+        c->ring_cap = c->ring_cap ? 2 * c->ring_cap : 64;
+        c->ring = realloc(c->ring, c->ring_cap * sizeof *c->ring);
+        assert(c->ring != NULL);
+    }
+    e->pos = c->ring_n;
+    c->ring[c->ring_n++] = e;
+    c->slot[e->orig] = e;
+    c->st.entries++;
+    c->st.bytes += bytes;
+    pthread_mutex_unlock(&c->mtx);
+} /* store */
+
+int
+d_cache_run(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+    struct d_cache *c = q->graph->cache;
+    uint32_t n = q->graph->csr->n;
+    struct entry *e = lookup(c, n, orig->id);
+    int res;
+
+    if (!e) {
+        res = d_query_forward_checked(q, orig, dest, flags);
+        pthread_mutex_lock(&c->mtx);
+        c->st.misses++;
+        pthread_mutex_unlock(&c->mtx);
+        store(c, q, dest, n);
+        return res;
+    }
+
+    restore(q, e);
+    int hit = e->complete || (dest && Q_SETTLED(q, dest->id));
+    pthread_mutex_lock(&c->mtx);
+    if (hit) c->st.hits++;
+    else c->st.resumes++;
+    release(e);
+    pthread_mutex_unlock(&c->mtx);
+    if (flags & D_FLAG_DEBUG)
+        printf(F("Cache %s for origin %d, %d nodes settled\n"),
+                hit ? "hit" : "resume", q->orig, q->settled);
+    if (hit)
+        return 0;
+
+    res = d_query_forward_checked(q, NULL, dest, flags);
+    store(c, q, dest, n);
+    return res;
+} /* d_cache_run */
+
+void
+d_cache_stats(
+        struct d_graph       *graph,
+        struct d_cache_stats *stats)
+{
+    struct d_cache *c = graph->cache;
+
+    if (!c) {
+        memset(stats, 0, sizeof *stats);
+        return;
+    }
+    pthread_mutex_lock(&c->mtx);
+    *stats = c->st;
+    pthread_mutex_unlock(&c->mtx);
+} /* d_cache_stats */
+
+ssize_t
+d_cache_print_stats(
+        const char                 *title,
+        const struct d_cache_stats *st,
+        FILE                       *out)
+{
+    return fprintf(out,
+            "%s: %ld entries, %zu of %zu bytes\n"
+            "  hits=%ld resumes=%ld misses=%ld\n"
+            "  evictions=%ld rejected=%ld invalidations=%ld\n",
+            title, st->entries, st->bytes, st->capacity,
+            st->hits, st->resumes, st->misses,
+            st->evictions, st->rejected, st->invalidations);
+} /* d_cache_print_stats */
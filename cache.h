@@ -0,0 +1,83 @@
+/* cache.h -- cache of the searches from the most used origins.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 23 09:51:26 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "dijkstra.h"
+
+struct d_cache_stats {
+    long            hits;      /* searches answered by the cache */
+    long            resumes;   /* partial searches of the cache that
+                                * were continued */
+    long            misses;    /* searches run from the origin */
+    long            evictions; /* entries dropped to make room */
+    long            rejected;  /* searches too big for the cache */
+    long            invalidations; /* the graph changed, and all the
+                                    * entries were dropped */
+    long            entries;   /* entries in the cache */
+    size_t          bytes;     /* bytes used by them */
+    size_t          capacity;  /* bytes they can use */
+};
+
+/**
+ * Keep a cache of the searches of a graph, by origin.
+ *
+ * After each one directional search (see d_set_search()), the
+ * nodes settled, with their costs and parents, and the nodes left
+ * in the frontier (if the search stopped at its destination) are
+ * kept in the cache, for its origin.  The next search from the
+ * same origin restores them, without searching, if its destination
+ * was settled (or there's none, and the search was complete), or
+ * resumes the search from the frontier until it is settled, as if
+ * it hadn't stopped.  The results are the same as without the
+ * cache.
+ *
+ * Entries are evicted with the CLOCK algorithm (an approximation
+ * of LRU) when the bytes of all of them would go over the
+ * capacity.  Searches that don't fit alone are not kept.  Adding
+ * links or nodes to the graph, changing their weights or the
+ * arithmetic of the costs drops all the entries.  The cache is
+ * shared by all the queries of the graph (see d_query_new()), and
+ * used by d_dijkstra(), that runs on the frozen layout while the
+ * graph has a cache.  Entries hold int costs, so the searches of
+ * the cache always check them, as with D_COSTS_CHECKED (see
+ * d_set_costs()): paths costing more than INT_MAX are dropped.
+ *
+ * @param graph is the graph of the searches.
+ * @param bytes is the capacity of the cache, 0 to drop it.
+ * @return 0.
+ */
+int
+d_cache_set(
+        struct d_graph   *graph,
+        size_t            bytes);
+
+/**
+ * Get the counters of the cache of a graph (all zero if the graph
+ * has no cache).
+ */
+void
+d_cache_stats(
+        struct d_graph       *graph,
+        struct d_cache_stats *stats);
+
+/**
+ * Print the counters of a cache.
+ *
+ * @return the number of characters printed.
+ */
+ssize_t
+d_cache_print_stats(
+        const char                 *title,
+        const struct d_cache_stats *stats,
+        FILE                       *out);
+
+#endif /* _CACHE_H */
@@ -0,0 +1,426 @@
+/* ch.c -- contraction hierarchies.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sat Oct 17 15:48:06 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * Contraction works on a copy of the graph in adjacency lists
+ * (out and in links of each node), where the links of contracted
+ * nodes are removed from their neighbours.  The lists of a node
+ * are not modified after its contraction, so they are the up and
+ * down links of the node in the hierarchy.  The witness searches
+ * sum their costs in 64 bits, and no shortcut heavier than an int
+ * is added, as the searches on the hierarchy drop the paths that
+ * cost more than that anyway.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "graph.h"
+#include "ch.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+#define WITNESS_SETTLED     64         /* max nodes settled by a witness
+                                        * search, plus */
+#define WITNESS_PER_TARGET  8          /* these, per target to reach */
+
+struct arc {
+    int             node;      /* other end of the link */
+    int             w;         /* weight */
+    int             via;       /* node of a shortcut, or -1 */
+};
+
+struct arcs {
+    struct arc     *a;
+    int             n;
+    int             cap;
+};
+
+struct ctx {
+    int             n;
+    struct arcs    *out;       /* links leaving each node */
+    struct arcs    *in;        /* links arriving to each node */
+    int            *deleted;   /* contracted neighbours of each node */
+    int            *level;     /* level of each node in the hierarchy */
+    int            *mark;      /* scratch, for dedup of links and
+                                * the targets of witness searches */
+    int             tok;       /* current value of a mark */
+
+    /* queue of nodes to contract, by priority.  Entries whose key
+     * is not the current priority of the node are stale. */
+    struct pq_ent {
+        int         key;
+        int         node;
+    }              *pq;
+    int             pq_n;
+    int             pq_cap;
+    int            *prio;      /* current priority of each node */
+
+    /* witness searches */
+    struct d_heap  *heap;
+    int64_t        *dist;
+    uint32_t       *stamp;
+    uint32_t        ep;
+};
+
+static void
+arcs_add(struct arcs *l, int node, int w, int via)
+{
+    if (l->n == l->cap) {
+        l->cap = l->cap ? 2 * l->cap : 4;
+        l->a = realloc(l->a, l->cap * sizeof *l->a);
+        assert(l->a != NULL);
+    }
+    l->a[l->n].node = node;
+    l->a[l->n].w    = w;
+    l->a[l->n].via  = via;
+    l->n++;
+} /* arcs_add */
+
+static void
+arcs_del(struct arcs *l, int node)
+{
+    int i;
+    for (i = 0; i < l->n; ++i)
+        if (l->a[i].node == node) {
+            l->a[i] = l->a[--l->n];
+            return;
+        }
+} /* arcs_del */
+
+static struct arc *
+arcs_find(struct arcs *l, int node)
+{
+    int i;
+    for (i = 0; i < l->n; ++i)
+        if (l->a[i].node == node)
+            return &l->a[i];
+    return NULL;
+} /* arcs_find */
+
+/* search from u, not passing through v, until the cost exceeds
+ * limit, the targets (nodes with c->mark equal to c->tok) are all
+ * settled, or too many nodes are.  Costs found are valid in
+ * c->dist where c->stamp is c->ep. */
+static void
+witness(struct ctx *c, int u, int v, int64_t limit, int targets)
+{
+    int x, settled = 0;
+    int64_t k;
+    int max = WITNESS_SETTLED + WITNESS_PER_TARGET * targets;
+
+    if (++c->ep == 0) {
+        memset(c->stamp, 0, c->n * sizeof *c->stamp);
+        c->ep = 1;
+    }
+    d_heap_clear(c->heap);
+    c->dist[u]  = 0;
+    c->stamp[u] = c->ep;
+    d_heap_push(c->heap, u, 0);
+    while ((x = d_heap_pop(c->heap, &k)) >= 0) {
+        if (k > limit || ++settled > max)
+            break;
+        if (c->mark[x] == c->tok && --targets == 0)
+            break;
+        const struct arcs *l = &c->out[x];
+        int i;
+        for (i = 0; i < l->n; ++i) {
+            int y = l->a[i].node;
+            int64_t d = k + l->a[i].w;
+            if (y == v) continue;
+            if (c->stamp[y] != c->ep || d < c->dist[y]) {
+                c->stamp[y] = c->ep;
+                c->dist[y]  = d;
+                d_heap_push(c->heap, y, d);
+            }
+        }
+    }
+} /* witness */
+
+static void
+add_shortcut(struct ctx *c, int u, int x, int w, int via)
+{
+    struct arc *a = arcs_find(&c->out[u], x);
+    if (a) {
+        if (w >= a->w) return;
+        a->w   = w;
+        a->via = via;
+        a = arcs_find(&c->in[x], u);
+        a->w   = w;
+        a->via = via;
+        return;
+    }
+    arcs_add(&c->out[u], x, w, via);
+    arcs_add(&c->in[x],  u, w, via);
+} /* add_shortcut */
+
+/* contracts v (or only counts the shortcuts needed, if simulate)
+ * and returns the number of shortcuts */
+static int
+contract(struct ctx *c, int v, int simulate)
+{
+    struct arcs *in = &c->in[v], *out = &c->out[v];
+    int i, j, res = 0;
+
+    for (i = 0; i < in->n; ++i) {
+        int u = in->a[i].node, wu = in->a[i].w, max = -1;
+        for (j = 0; j < out->n; ++j)
+            if (out->a[j].node != u && out->a[j].w > max)
+                max = out->a[j].w;
+        if (max < 0) continue;
+
+        if (++c->tok == INT_MAX) {
+            for (j = 0; j < c->n; ++j) c->mark[j] = -1;
+            c->tok = 0;
+        }
+        int targets = 0;
+        for (j = 0; j < out->n; ++j)
+            if (out->a[j].node != u) {
+                c->mark[out->a[j].node] = c->tok;
+                targets++;
+            }
+        witness(c, u, v, (int64_t)wu + max, targets);
+        for (j = 0; j < out->n; ++j) {
+            int x = out->a[j].node;
+            int64_t w = (int64_t)wu + out->a[j].w;
+            if (x == u) continue;
+            if (c->stamp[x] == c->ep && c->dist[x] <= w)
+                continue; /* there's a path as good without v */
+            if (w > INT_MAX)
+                continue; /* only paths dropped by the searches */
+            res++;
+            if (!simulate)
+                add_shortcut(c, u, x, w, v);
+        }
+    }
+    if (!simulate) {
+        /* v goes out of the graph, its lists are frozen */
+        for (i = 0; i < in->n; ++i) {
+            arcs_del(&c->out[in->a[i].node], v);
+            c->deleted[in->a[i].node]++;
+        }
+        for (i = 0; i < out->n; ++i) {
+            arcs_del(&c->in[out->a[i].node], v);
+            c->deleted[out->a[i].node]++;
+        }
+    }
+    return res;
+} /* contract */
+
+/* the lower, the sooner a node is contracted */
+static int
+priority(struct ctx *c, int v)
+{
+    int sc = contract(c, v, 1);
+    return 2 * (sc - c->in[v].n - c->out[v].n)
+        + c->deleted[v]
+        + c->level[v];
+} /* priority */
+
+static void
+pq_push(struct ctx *c, int v, int key)
+{
+    if (c->pq_n == c->pq_cap) {
+        c->pq_cap = c->pq_cap ? 2 * c->pq_cap : 1024;
+        c->pq = realloc(c->pq, c->pq_cap * sizeof *c->pq);
+        assert(c->pq != NULL);
+    }
+    int i = c->pq_n++;
+    c->prio[v] = key;
+    while (i > 0 && c->pq[(i - 1) / 2].key > key) {
+        c->pq[i] = c->pq[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    c->pq[i].key  = key;
+    c->pq[i].node = v;
+} /* pq_push */
+
+/* the entry of minimum key, not stale, or NULL */
+static struct pq_ent *
+pq_top(struct ctx *c)
+{
+    while (c->pq_n > 0
+            && c->pq[0].key != c->prio[c->pq[0].node]) {
+        /* stale, remove it */
+        struct pq_ent last = c->pq[--c->pq_n];
+        int i = 0, j;
+        while ((j = 2 * i + 1) < c->pq_n) {
+            if (j + 1 < c->pq_n && c->pq[j + 1].key < c->pq[j].key)
+                j++;
+            if (last.key <= c->pq[j].key) break;
+            c->pq[i] = c->pq[j];
+            i = j;
+        }
+        c->pq[i] = last;
+    }
+    return c->pq_n > 0 ? &c->pq[0] : NULL;
+} /* pq_top */
+
+/* packs the lists of the nodes in CSR form */
+static uint32_t
+pack(struct arcs *l, int n, uint32_t **off, uint32_t **node,
+        int32_t **w, int32_t **via)
+{
+    uint32_t m = 0;
+    int i, j;
+
+    for (i = 0; i < n; ++i) m += l[i].n;
+    *off  = malloc((n + 1) * sizeof **off);
+    *node = malloc((m ? m : 1) * sizeof **node);
+    *w    = malloc((m ? m : 1) * sizeof **w);
+    *via  = malloc((m ? m : 1) * sizeof **via);
+    assert(*off && *node && *w && *via);
+    for (i = 0, m = 0; i < n; ++i) {
+        (*off)[i] = m;
+        for (j = 0; j < l[i].n; ++j, ++m) {
+            (*node)[m] = l[i].a[j].node;
+            (*w)[m]    = l[i].a[j].w;
+            (*via)[m]  = l[i].a[j].via;
+        }
+    }
+    (*off)[n] = m;
+    return m;
+} /* pack */
+
+long
+d_ch_build(
+        struct d_graph   *graph,
+        int               flags)
+{
+    d_freeze(graph, flags);
+
+    const struct d_csr *csr = graph->csr;
+    int n = csr->n, u, v;
+    uint32_t e;
+    struct ctx c = { .n = n };
+
+    c.out     = calloc(n ? n : 1, sizeof *c.out);
+    c.in      = calloc(n ? n : 1, sizeof *c.in);
+    c.deleted = calloc(n ? n : 1, sizeof *c.deleted);
+    c.level   = calloc(n ? n : 1, sizeof *c.level);
+    c.prio    = malloc((n ? n : 1) * sizeof *c.prio);
+    c.mark    = malloc((n ? n : 1) * sizeof *c.mark);
+    c.dist    = malloc((n ? n : 1) * sizeof *c.dist);
+    c.stamp   = calloc(n ? n : 1, sizeof *c.stamp);
+    c.heap    = d_heap_new(D_HEAP_BINARY, n);
+    assert(c.out && c.in && c.deleted && c.level && c.prio
+            && c.mark && c.dist && c.stamp);
+
+    /* copy the graph, without loops and keeping only the cheapest
+     * of parallel links (the first one, as they are sorted) */
+    for (v = 0; v < n; ++v) c.mark[v] = -1;
+    for (u = 0; u < n; ++u) {
+        for (e = csr->off[u]; e < csr->off[u + 1]; ++e) {
+            v = csr->tgt[e];
+            if (v == u || c.mark[v] == u) continue;
+            c.mark[v] = u;
+            arcs_add(&c.out[u], v, csr->wgt[e], -1);
+            arcs_add(&c.in[v],  u, csr->wgt[e], -1);
+        }
+    }
+
+    struct d_ch *ch = calloc(1, sizeof *ch);
+    assert(ch != NULL);
+    ch->n    = n;
+    ch->rank = malloc((n ? n : 1) * sizeof *ch->rank);
+    assert(ch->rank != NULL);
+
+    for (v = 0; v < n; ++v) c.mark[v] = -1;
+    for (v = 0; v < n; ++v)
+        pq_push(&c, v, priority(&c, v));
+
+    long shortcuts = 0;
+    uint32_t rank = 0;
+    struct pq_ent *top;
+    while ((top = pq_top(&c)) != NULL) {
+        v = top->node;
+        /* priorities change as the neighbours are contracted, so
+         * the one of the node is checked again before contracting
+         * it.  If it got worse, it goes back to the queue. */
+        int p = priority(&c, v);
+        if (p > top->key) {
+            pq_push(&c, v, p);
+            continue;
+        }
+        c.prio[v] = INT_MIN; /* out of the queue */
+        shortcuts += contract(&c, v, 0);
+        ch->rank[v] = rank++;
+
+        /* the neighbours, still in the queue, get their deleted and
+         * level terms raised in place.  Their shortcut term is only
+         * computed again when they reach the top of the queue. */
+        struct arcs *l[2] = { &c.in[v], &c.out[v] };
+        int i, j;
+        for (i = 0; i < 2; ++i)
+            for (j = 0; j < l[i]->n; ++j) {
+                int x = l[i]->a[j].node, key = c.prio[x] + 1;
+                if (c.level[x] <= c.level[v]) {
+                    key += c.level[v] + 1 - c.level[x];
+                    c.level[x] = c.level[v] + 1;
+                }
+                pq_push(&c, x, key);
+            }
+        if ((flags & D_FLAG_DEBUG) && rank % 10000 == 0)
+            printf(F("%u nodes contracted, %ld shortcuts\n"),
+                    rank, shortcuts);
+    }
+    free(c.pq);
+    free(c.prio);
+
+    ch->up_m = pack(c.out, n, &ch->up_off, &ch->up_tgt,
+            &ch->up_wgt, &ch->up_via);
+    ch->dn_m = pack(c.in,  n, &ch->dn_off, &ch->dn_src,
+            &ch->dn_wgt, &ch->dn_via);
+
+    for (v = 0; v < n; ++v) {
+        free(c.out[v].a);
+        free(c.in[v].a);
+    }
+    free(c.out);
+    free(c.in);
+    free(c.deleted);
+    free(c.level);
+    free(c.mark);
+    free(c.dist);
+    free(c.stamp);
+    d_heap_free(c.heap);
+
+    d_ch_free(graph->ch);
+    graph->ch = ch;
+    if (flags & (D_FLAG_DEBUG | D_FLAG_FREEZE))
+        printf(F("Graph %s contracted, %ld shortcuts, "
+                "%u up links, %u down links\n"),
+                graph->name, shortcuts, ch->up_m, ch->dn_m);
+    return shortcuts;
+} /* d_ch_build */
+
+int
+d_ch_present(
+        struct d_graph   *graph)
+{
+    return graph->ch != NULL;
+} /* d_ch_present */
+
+void
+d_ch_free(
+        struct d_ch      *ch)
+{
+    if (!ch) return;
+    if (!ch->mapped) {
+        free(ch->rank);
+        free(ch->up_off);
+        free(ch->up_tgt);
+        free(ch->up_wgt);
+        free(ch->up_via);
+        free(ch->dn_off);
+        free(ch->dn_src);
+        free(ch->dn_wgt);
+        free(ch->dn_via);
+    }
+    free(ch);
+} /* d_ch_free */
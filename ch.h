@@ -0,0 +1,48 @@
+/* ch.h -- contraction hierarchies.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sat Oct 17 15:48:06 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _CH_H
+#define _CH_H
+
+#include "dijkstra.h"
+
+/**
+ * Build the contraction hierarchy of a graph.
+ *
+ * The nodes of the (frozen) graph are contracted one by one, in
+ * order of importance (nodes whose removal needs less shortcuts
+ * go first).  Contracting a node adds a shortcut link between
+ * each pair of its remaining neighbours whose minimum cost path
+ * goes through it.  The result is kept with the frozen layout of
+ * the graph: the rank of each node, and the links (original ones
+ * and shortcuts, marked with the node they go through) going up
+ * in rank from each node, or coming down to it.
+ *
+ * Once built, d_set_search(graph, D_SEARCH_CH) makes the queries
+ * with a destination run an upward search from both ends, that
+ * only settles a few nodes, and unpack the shortcuts of the path
+ * found, so the routes have the original links.  The hierarchy
+ * is saved with the graph by d_save_snapshot(), so it has only
+ * to be built once.  It is dropped, as the frozen layout, if the
+ * graph is modified.
+ *
+ * @param graph is the graph to contract.
+ * @return the number of shortcuts added.
+ */
+long
+d_ch_build(
+        struct d_graph   *graph,
+        int               flags);
+
+/**
+ * @return nonzero if the graph has a contraction hierarchy.
+ */
+int
+d_ch_present(
+        struct d_graph   *graph);
+
+#endif /* _CH_H */
@@ -0,0 +1,126 @@
+#!/bin/sh
+# check.sh -- checks that all the frontier engines and search
+#             strategies of dijkstra find the same costs as the
+#             plain search.
+# Author: Luis Colorado <luiscoloradourcola@gmail.com>
+# Date: Fri Oct 16 23:30:12 EEST 2026
+# Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+# License: BSD.
+#
+# Usage: check.sh graph ...
+#
+# For each graph, some of its nodes (spread over it) are taken as
+# sources and targets, and the costs between all of them are
+# computed in batch mode with the plain search, and then with each
+# engine of -f, each arithmetic of -c, each strategy (-B, -A, -C,
+# -P, -K) and as a matrix (-m, alone and with -C).  The costs of
+# the tree of the first source are also compared with each engine
+# and with delta-stepping (-w).  Only the costs are compared, as
+# different searches may pick different paths of the same cost.
+# Any difference is printed, and makes the check fail.  Variables
+# DIJKSTRA, ENGINES, COSTS, STRATEGIES and NODES of the environment
+# change what is checked.
+
+DIJKSTRA="${DIJKSTRA:-./dijkstra}"
+ENGINES="${ENGINES:-list binary pairing radix dial}"
+COSTS="${COSTS:-int checked int64}"
+STRATEGIES="${STRATEGIES:--B -A4 -C -P0 -K1M}"
+NODES="${NODES:-8}"     # number of sources and of targets per graph
+
+LC_ALL=C
+export LC_ALL
+
+tmp=$(mktemp -d "${TMPDIR:-/tmp}/check.XXXXXX") || exit 1
+trap 'rm -rf "$tmp"' EXIT
+trap 'exit 2' HUP INT TERM
+
+fails=0
+checks=0
+
+# same title ref out: compares the costs of out with those of ref
+same()
+{
+    checks=$((checks + 1))
+    if cmp -s "$2" "$3"; then
+        echo "ok   $1"
+    else
+        echo "FAIL $1"
+        diff "$2" "$3" | head -n 10
+        fails=$((fails + 1))
+    fi
+}
+
+# the 'src dst cost' of the lines of a batch or a matrix, sorted
+costs()
+{
+    awk 'NF >= 3 { print $1, $2, $3 }' | sort
+}
+
+# the 'node cost' of the lines of a tree, sorted
+tree_costs()
+{
+    awk 'NF == 3 { print $1, $3 }' | sort
+}
+
+for g in "$@"
+do
+    # sources and targets, NODES of each, evenly spread over the
+    # names of the nodes
+    awk '{ print $1; print $2 }' "$g" | sort -u > "$tmp/nodes"
+    n=$(wc -l < "$tmp/nodes")
+    step=$((n / NODES))
+    [ "$step" -ge 2 ] || step=2
+    awk -v s="$step" 'NR % s == 1' "$tmp/nodes" \
+        | head -n "$NODES" > "$tmp/src"
+    awk -v s="$step" 'NR % s == 0' "$tmp/nodes" \
+        | head -n "$NODES" > "$tmp/dst"
+    awk 'NR == FNR { t[++n] = $1; next }
+        { for (i = 1; i <= n; i++) print $1, t[i] }' \
+        "$tmp/dst" "$tmp/src" > "$tmp/queries"
+    { cat "$tmp/src"; echo; cat "$tmp/dst"; } > "$tmp/matrix"
+    orig=$(head -n 1 "$tmp/src")
+
+    "$DIJKSTRA" -f binary -b "$tmp/queries" "$g" 2>/dev/null \
+        | costs > "$tmp/ref"
+    if [ ! -s "$tmp/ref" ]; then
+        echo "FAIL $g: the plain search gave no costs"
+        fails=$((fails + 1))
+        continue
+    fi
+    "$DIJKSTRA" -f binary -s "$orig" -t text "$g" 2>/dev/null \
+        | tree_costs > "$tmp/tref"
+
+    for e in $ENGINES
+    do
+        "$DIJKSTRA" -f "$e" -b "$tmp/queries" "$g" 2>/dev/null \
+            | costs > "$tmp/out"
+        same "$g -f $e" "$tmp/ref" "$tmp/out"
+        "$DIJKSTRA" -f "$e" -s "$orig" -t text "$g" 2>/dev/null \
+            | tree_costs > "$tmp/out"
+        same "$g -f $e -s $orig" "$tmp/tref" "$tmp/out"
+    done
+    for c in $COSTS
+    do
+        "$DIJKSTRA" -c "$c" -b "$tmp/queries" "$g" 2>/dev/null \
+            | costs > "$tmp/out"
+        same "$g -c $c" "$tmp/ref" "$tmp/out"
+    done
+    for s in $STRATEGIES
+    do
+        "$DIJKSTRA" "$s" -b "$tmp/queries" "$g" 2>/dev/null \
+            | costs > "$tmp/out"
+        same "$g $s" "$tmp/ref" "$tmp/out"
+    done
+    for s in "" -C
+    do
+        "$DIJKSTRA" $s -m "$tmp/matrix" "$g" 2>/dev/null \
+            | costs > "$tmp/out"
+        same "$g $s${s:+ }-m" "$tmp/ref" "$tmp/out"
+    done
+    "$DIJKSTRA" -w 0 -s "$orig" -t text "$g" 2>/dev/null \
+        | tree_costs > "$tmp/out"
+    same "$g -w 0 -s $orig" "$tmp/tref" "$tmp/out"
+done
+
+echo "$((checks - fails)) of $checks checks passed"
+[ "$fails" -eq 0 ]
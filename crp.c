@@ -0,0 +1,467 @@
+/* crp.c -- customizable route planning: multilevel partition of
+ *          the nodes and overlay of the cells.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Wed Oct 21 10:26:41 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * The partition only depends on the links of the graph, and it is
+ * built once.  The overlay depends on the weights, and is computed
+ * again (customized) when they change, bottom up: the overlay of
+ * a cell of level k comes from searches on the overlay of its
+ * cells of level k - 1, that only visit their entries and exits.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "graph.h"
+#include "crp.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+#define SEP_STRING          ", \t\n"
+#define MAX_LEVELS          8
+
+void
+d_crp_free(
+        struct d_crp     *crp)
+{
+    int k;
+
+    if (!crp) return;
+    for (k = 0; k < crp->levels; ++k) {
+        struct d_crp_level *l = crp->lvl + k;
+        free(l->cell);
+        free(l->ent_idx);
+        free(l->ext_idx);
+        free(l->ent_off);
+        free(l->ent);
+        free(l->ext_off);
+        free(l->ext);
+        free(l->mat_off);
+        free(l->mat);
+    }
+    free(crp->lvl);
+    free(crp);
+} /* d_crp_free */
+
+/* the nodes of each cell of a level, as the ncells + 1 offsets off
+ * into the array nodes */
+static void
+cell_nodes(
+        const struct d_crp_level *l,
+        uint32_t                  n,
+        uint32_t                **off,
+        uint32_t                **nodes)
+{
+    uint32_t c, v;
+
+    *off   = calloc(l->ncells + 1, sizeof **off);
+    *nodes = malloc((n ? n : 1) * sizeof **nodes);
+    assert(*off && *nodes);
+    for (v = 0; v < n; ++v)
+        (*off)[l->cell[v] + 1]++;
+    for (c = 0; c < l->ncells; ++c)
+        (*off)[c + 1] += (*off)[c];
+    for (v = 0; v < n; ++v)
+        (*nodes)[(*off)[l->cell[v]]++] = v;
+    /* the offsets moved to the end of each cell */
+    for (c = l->ncells; c > 0; --c)
+        (*off)[c] = (*off)[c - 1];
+    (*off)[0] = 0;
+} /* cell_nodes */
+
+/* the cells of level l, of up to max nodes, grown in breadth first
+ * order over the links of the graph in both directions.  The units
+ * grouped are the nodes (prev is NULL) or the cells of the level
+ * below prev, so the cells are nested. */
+static void
+grow_cells(
+        const struct d_csr       *csr,
+        const struct d_crp_level *prev,
+        long                      max,
+        struct d_crp_level       *l)
+{
+    uint32_t n = csr->n, nu = prev ? prev->ncells : n;
+    uint32_t *off = NULL, *nodes = NULL, u, v, e;
+    int32_t *unit_cell = malloc((nu ? nu : 1) * sizeof *unit_cell);
+    uint32_t *queue = malloc((nu ? nu : 1) * sizeof *queue);
+    assert(unit_cell && queue);
+
+    if (prev)
+        cell_nodes(prev, n, &off, &nodes);
+    for (u = 0; u < nu; ++u)
+        unit_cell[u] = -1;
+
+    l->ncells = 0;
+    for (u = 0; u < nu; ++u) {
+        if (unit_cell[u] >= 0) continue;
+        uint32_t head = 0, tail = 0;
+        int32_t c = l->ncells++;
+        long size = prev ? off[u + 1] - off[u] : 1;
+        unit_cell[u] = c;
+        queue[tail++] = u;
+        while (head < tail) {
+            uint32_t x = queue[head++];
+            uint32_t i, beg = prev ? off[x] : x, end = prev ? off[x + 1] : x + 1;
+            for (i = beg; i < end; ++i) {
+                uint32_t m = prev ? nodes[i] : i;
+                int dir;
+                for (dir = 0; dir < 2; ++dir) {
+                    const uint32_t *o = dir ? csr->r_off : csr->off;
+                    const uint32_t *t = dir ? csr->r_src : csr->tgt;
+                    for (e = o[m]; e < o[m + 1]; ++e) {
+                        uint32_t y = prev ? prev->cell[t[e]] : t[e];
+                        long sz = prev ? off[y + 1] - off[y] : 1;
+                        if (unit_cell[y] >= 0 || size + sz > max)
+                            continue;
+                        unit_cell[y] = c;
+                        size += sz;
+                        queue[tail++] = y;
+                    }
+                }
+            }
+        }
+    }
+
+    l->cell = malloc((n ? n : 1) * sizeof *l->cell);
+    assert(l->cell != NULL);
+    for (v = 0; v < n; ++v)
+        l->cell[v] = unit_cell[prev ? prev->cell[v] : v];
+    free(queue);
+    free(unit_cell);
+    free(off);
+    free(nodes);
+} /* grow_cells */
+
+/* the entries and exits of the cells of a level, and room for
+ * their overlay */
+static void
+find_boundary(
+        const struct d_csr       *csr,
+        struct d_crp_level       *l)
+{
+    uint32_t n = csr->n, nc = l->ncells, u, e, c;
+
+    l->ent_idx = malloc((n ? n : 1) * sizeof *l->ent_idx);
+    l->ext_idx = malloc((n ? n : 1) * sizeof *l->ext_idx);
+    l->ent_off = calloc(nc + 1, sizeof *l->ent_off);
+    l->ext_off = calloc(nc + 1, sizeof *l->ext_off);
+    assert(l->ent_idx && l->ext_idx && l->ent_off && l->ext_off);
+    for (u = 0; u < n; ++u)
+        l->ent_idx[u] = l->ext_idx[u] = -1;
+    for (u = 0; u < n; ++u)
+        for (e = csr->off[u]; e < csr->off[u + 1]; ++e)
+            if (l->cell[csr->tgt[e]] != l->cell[u]) {
+                l->ext_idx[u] = 0;
+                l->ent_idx[csr->tgt[e]] = 0;
+            }
+
+    /* number them in their cells, in id order */
+    for (u = 0; u < n; ++u) {
+        if (l->ent_idx[u] >= 0)
+            l->ent_idx[u] = l->ent_off[l->cell[u] + 1]++;
+        if (l->ext_idx[u] >= 0)
+            l->ext_idx[u] = l->ext_off[l->cell[u] + 1]++;
+    }
+    for (c = 0; c < nc; ++c) {
+        l->ent_off[c + 1] += l->ent_off[c];
+        l->ext_off[c + 1] += l->ext_off[c];
+    }
+    l->ent = malloc((l->ent_off[nc] ? l->ent_off[nc] : 1) * sizeof *l->ent);
+    l->ext = malloc((l->ext_off[nc] ? l->ext_off[nc] : 1) * sizeof *l->ext);
+    assert(l->ent && l->ext);
+    for (u = 0; u < n; ++u) {
+        if (l->ent_idx[u] >= 0)
+            l->ent[l->ent_off[l->cell[u]] + l->ent_idx[u]] = u;
+        if (l->ext_idx[u] >= 0)
+            l->ext[l->ext_off[l->cell[u]] + l->ext_idx[u]] = u;
+    }
+
+    l->mat_off = malloc((nc + 1) * sizeof *l->mat_off);
+    assert(l->mat_off != NULL);
+    l->mat_off[0] = 0;
+    for (c = 0; c < nc; ++c)
+        l->mat_off[c + 1] = l->mat_off[c]
+            + (size_t)(l->ent_off[c + 1] - l->ent_off[c])
+                * (l->ext_off[c + 1] - l->ext_off[c]);
+    l->mat = malloc((l->mat_off[nc] ? l->mat_off[nc] : 1) * sizeof *l->mat);
+    assert(l->mat != NULL);
+} /* find_boundary */
+
+static inline void
+cs_relax(
+        struct d_crp_search *s,
+        int                  u,
+        int                  v,
+        long long            nc,
+        int                  jump)
+{
+    if (nc > INT_MAX) return;      /* doesn't fit in a cost */
+    if (s->stamp[v] != s->ep) {
+        if (s->stamp[v] == s->ep + 1) return; /* settled */
+        s->stamp[v] = s->ep;
+    } else if (nc >= s->dist[v]) {
+        return;
+    }
+    s->dist[v] = nc;
+    s->back[v] = u;
+    s->jump[v] = jump;
+    d_heap_push(s->heap, v, nc);
+} /* cs_relax */
+
+int
+d_crp_cell_search(
+        const struct d_crp  *crp,
+        const struct d_csr  *csr,
+        int                  level,
+        int                  src,
+        int                  dst,
+        struct d_crp_search *s)
+{
+    const struct d_crp_level *l = crp->lvl + level;
+    const struct d_crp_level *b = level > 0 ? l - 1 : NULL;
+    uint32_t c = l->cell[src], e;
+    int u, settled = 0;
+
+    s->dist[src]  = 0;
+    s->back[src]  = -1;
+    s->jump[src]  = 0;
+    s->stamp[src] = s->ep;
+    d_heap_push(s->heap, src, 0);
+    while ((u = d_heap_pop(s->heap, NULL)) >= 0) {
+        s->stamp[u] = s->ep + 1;
+        settled++;
+        if (u == dst) break;
+
+        long long du = s->dist[u];
+        if (!b) {
+            /* the finest level, on the links of the graph */
+            for (e = csr->off[u]; e < csr->off[u + 1]; ++e)
+                if (l->cell[csr->tgt[e]] == c)
+                    cs_relax(s, u, csr->tgt[e], du + csr->wgt[e], 0);
+            continue;
+        }
+        uint32_t sub = b->cell[u];
+        if (b->ent_idx[u] >= 0) {
+            /* through the cell of the level below */
+            uint32_t j, nx = b->ext_off[sub + 1] - b->ext_off[sub];
+            const int32_t *row = b->mat + b->mat_off[sub]
+                + (size_t)b->ent_idx[u] * nx;
+            const uint32_t *ext = b->ext + b->ext_off[sub];
+            for (j = 0; j < nx; ++j)
+                if (row[j] != D_CRP_INF)
+                    cs_relax(s, u, ext[j], du + row[j], level);
+        }
+        if (b->ext_idx[u] >= 0) {
+            /* to other cells of the level below, in this cell */
+            for (e = csr->off[u]; e < csr->off[u + 1]; ++e) {
+                uint32_t v = csr->tgt[e];
+                if (b->cell[v] != sub && l->cell[v] == c)
+                    cs_relax(s, u, v, du + csr->wgt[e], 0);
+            }
+        }
+    }
+    return settled;
+} /* d_crp_cell_search */
+
+/* the cells of a level, spread among the threads of
+ * d_crp_customize() */
+struct custom_work {
+    struct d_crp       *crp;
+    const struct d_csr *csr;
+    int                 level;
+    uint32_t            next;      /* first cell not taken yet */
+};
+
+static void *
+custom_worker(void *arg)
+{
+    struct custom_work *w = arg;
+    struct d_crp_level *l = w->crp->lvl + w->level;
+    uint32_t n = w->csr->n, c, i, j;
+    struct d_crp_search s;
+
+    s.dist  = malloc((n ? n : 1) * sizeof *s.dist);
+    s.back  = malloc((n ? n : 1) * sizeof *s.back);
+    s.jump  = malloc((n ? n : 1) * sizeof *s.jump);
+    s.stamp = calloc(n ? n : 1, sizeof *s.stamp);
+    s.heap  = d_heap_new(D_HEAP_BINARY, n ? n : 1);
+    s.ep    = 0;
+    assert(s.dist && s.back && s.jump && s.stamp && s.heap);
+
+    while ((c = __atomic_fetch_add(&w->next, 1, __ATOMIC_RELAXED))
+            < l->ncells) {
+        uint32_t ne = l->ent_off[c + 1] - l->ent_off[c];
+        uint32_t nx = l->ext_off[c + 1] - l->ext_off[c];
+        const uint32_t *ext = l->ext + l->ext_off[c];
+        for (i = 0; i < ne; ++i) {
+            int32_t *row = l->mat + l->mat_off[c] + (size_t)i * nx;
+            if (s.ep >= UINT32_MAX - 2) {
+                memset(s.stamp, 0, n * sizeof *s.stamp);
+                s.ep = 0;
+            }
+            s.ep += 2;
+            d_crp_cell_search(w->crp, w->csr, w->level,
+                    l->ent[l->ent_off[c] + i], -1, &s);
+            for (j = 0; j < nx; ++j)
+                row[j] = s.stamp[ext[j]] == s.ep + 1
+                    ? s.dist[ext[j]]
+                    : D_CRP_INF;
+        }
+    }
+    d_heap_free(s.heap);
+    free(s.stamp);
+    free(s.jump);
+    free(s.back);
+    free(s.dist);
+    return NULL;
+} /* custom_worker */
+
+long
+d_crp_customize(
+        struct d_graph   *graph,
+        int               threads,
+        int               flags)
+{
+    struct d_crp *crp = graph->crp;
+    long res = 0;
+    int k, i;
+
+    if (!crp) return -1;
+    if (threads < 1) threads = 1;
+    pthread_t *th = malloc(threads * sizeof *th);
+    assert(th != NULL);
+    for (k = 0; k < crp->levels; ++k) {
+        struct custom_work w = {
+            .crp = crp, .csr = graph->csr, .level = k, .next = 0,
+        };
+        int nth = threads < (int)crp->lvl[k].ncells
+            ? threads
+            : (int)crp->lvl[k].ncells;
+        /* the levels go one after the other, each one is computed
+         * from the one below */
+        for (i = 1; i < nth; ++i) {
+            int r = pthread_create(&th[i], NULL, custom_worker, &w);
+            assert(r == 0);
+        }
+        custom_worker(&w);
+        for (i = 1; i < nth; ++i)
+            pthread_join(th[i], NULL);
+        res += crp->lvl[k].mat_off[crp->lvl[k].ncells];
+        if (flags & D_FLAG_DEBUG)
+            printf(F("Graph %s, level %d customized, %zu overlay "
+                    "links\n"), graph->name, k,
+                    crp->lvl[k].mat_off[crp->lvl[k].ncells]);
+    }
+    free(th);
+    crp->customized = 1;
+    return res;
+} /* d_crp_customize */
+
+long
+d_crp_build(
+        struct d_graph   *graph,
+        int               levels,
+        int               cell_size,
+        int               threads,
+        int               flags)
+{
+    if (levels == 0) levels = D_CRP_LEVELS;
+    if (cell_size == 0) cell_size = D_CRP_CELL_SIZE;
+    if (levels < 1 || levels > MAX_LEVELS || cell_size < 1)
+        return -1;
+
+    d_freeze(graph, flags);
+    struct d_csr *csr = graph->csr;
+    if (!__atomic_load_n(&csr->r_off, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&graph->mtx);
+        d_csr_build_reverse(csr);
+        pthread_mutex_unlock(&graph->mtx);
+    }
+
+    d_crp_free(graph->crp);
+    struct d_crp *crp = calloc(1, sizeof *crp);
+    assert(crp != NULL);
+    crp->n      = csr->n;
+    crp->levels = levels;
+    crp->lvl    = calloc(levels, sizeof *crp->lvl);
+    assert(crp->lvl != NULL);
+
+    long cells = 0, max = cell_size;
+    int k;
+    for (k = 0; k < levels; ++k, max *= D_CRP_FANOUT) {
+        struct d_crp_level *l = crp->lvl + k;
+        grow_cells(csr, k > 0 ? l - 1 : NULL, max, l);
+        find_boundary(csr, l);
+        cells += l->ncells;
+        if (flags & D_FLAG_DEBUG)
+            printf(F("Graph %s, level %d: %u cells of up to %ld nodes, "
+                    "%u entries, %u exits\n"), graph->name, k,
+                    l->ncells, max, l->ent_off[l->ncells],
+                    l->ext_off[l->ncells]);
+    }
+    graph->crp = crp;
+    d_crp_customize(graph, threads, flags);
+    return cells;
+} /* d_crp_build */
+
+long
+d_crp_load_metric(
+        struct d_graph   *graph,
+        const char       *path,
+        int               flags)
+{
+    if (graph->ro) {
+        errno = EROFS; /* weights are in a read only map */
+        return -1;
+    }
+    int is_stdin = strcmp(path, "-") == 0;
+    FILE *in = is_stdin ? stdin : fopen(path, "r");
+    if (!in) return -1;
+
+    char *line = NULL;
+    size_t cap = 0;
+    long res = 0, lineno = 0;
+    while (getline(&line, &cap, in) >= 0) {
+        char *save;
+        char *from = strtok_r(line, SEP_STRING, &save);
+        lineno++;
+        if (!from || from[0] == '#') continue;
+        char *to = strtok_r(NULL, SEP_STRING, &save);
+        char *weight = strtok_r(NULL, SEP_STRING, &save);
+        struct d_node *f = to ? d_find_node(graph, from) : NULL;
+        struct d_node *t = f ? d_find_node(graph, to) : NULL;
+        if (!t || d_reweight_link(graph, f->id, t->id,
+                    weight ? atoi(weight) : 1, flags) < 0) {
+            fprintf(stderr, F("WARNING: %s:%ld: no link '%s' -> '%s'.  "
+                    "Skipping this entry.\n"),
+                    path, lineno, from, to ? to : "");
+            continue;
+        }
+        res++;
+    }
+    int err = ferror(in) ? errno : 0;
+    free(line);
+    if (!is_stdin)
+        fclose(in);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    if (flags & D_FLAG_DEBUG)
+        printf(F("%ld weights loaded from %s\n"), res, path);
+    return res;
+} /* d_crp_load_metric */
+
+int
+d_crp_present(
+        struct d_graph   *graph)
+{
+    return graph->crp && graph->crp->customized;
+} /* d_crp_present */
@@ -0,0 +1,113 @@
+/* crp.h -- customizable route planning: multilevel partition of
+ *          the nodes and overlay of the cells.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Wed Oct 21 10:26:41 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _CRP_H
+#define _CRP_H
+
+#include "dijkstra.h"
+
+#define D_CRP_LEVELS        3          /* default number of levels */
+#define D_CRP_CELL_SIZE     256        /* default nodes of a cell of
+                                        * the finest level */
+#define D_CRP_FANOUT        16         /* cells of a level in a cell
+                                        * of the next one, at most */
+
+/**
+ * Build the multilevel partition of a graph, and its overlay.
+ *
+ * The nodes of the (frozen) graph are split in cells of at most
+ * cell_size nodes, grown in breadth first order over the links
+ * (in both directions) from the first node not yet in a cell, so
+ * the nodes of a cell are connected.  Each of the next levels
+ * groups the cells of the level below the same way, in cells of
+ * up to D_CRP_FANOUT times more nodes.
+ *
+ * The overlay of a cell keeps the minimum cost, inside the cell,
+ * from each of its entries (nodes reached by a link from out of
+ * the cell) to each of its exits (nodes with a link going out of
+ * the cell).  It depends only on the weights, and is computed by
+ * d_crp_customize(), that is called here.
+ *
+ * Once built, d_set_search(graph, D_SEARCH_CRP) makes the queries
+ * with a destination search the links of the graph only in the
+ * cells of the origin and of the destination, and the overlay of
+ * the cells of the coarsest level not containing them elsewhere.
+ * The overlay links of the route found are unpacked, so routes
+ * have the links of the graph.
+ *
+ * The partition is dropped, as the frozen layout, if nodes or
+ * links are added to the graph.  Changing weights (see
+ * d_crp_load_metric()) keeps it, and the queries don't use it
+ * until d_crp_customize() is called again.  It is not saved in
+ * snapshots.
+ *
+ * @param graph is the graph to partition, frozen if not already.
+ * @param levels is the number of levels (D_CRP_LEVELS if 0).
+ * @param cell_size is the maximum number of nodes of the cells of
+ *        the finest level (D_CRP_CELL_SIZE if 0).
+ * @param threads is the number of threads of d_crp_customize().
+ * @return the number of cells of all the levels, or -1 if the
+ *         arguments are not valid.
+ */
+long
+d_crp_build(
+        struct d_graph   *graph,
+        int               levels,
+        int               cell_size,
+        int               threads,
+        int               flags);
+
+/**
+ * Compute the overlay of the partition for the current weights of
+ * the graph.
+ *
+ * The cells of a level are computed in parallel (a search from
+ * each entry of the cell, on the overlay of the level below, so
+ * each level only sees the boundary nodes of the level below),
+ * one level after the other.  No query can run on the graph
+ * meanwhile.
+ *
+ * @param threads is the number of threads to use.
+ * @return the number of overlay links computed, or -1 if the
+ *         graph has no partition.
+ */
+long
+d_crp_customize(
+        struct d_graph   *graph,
+        int               threads,
+        int               flags);
+
+/**
+ * Load a metric (new weights for the links of the graph) from a
+ * file.
+ *
+ * The file has the syntax of the graph files (lines with the
+ * origin, the destination and the weight of a link), but its links
+ * must exist in the graph.  Their weights are changed in place (as
+ * d_dyn_update() does), and the overlay must be computed again
+ * with d_crp_customize().
+ *
+ * @param path is the name of the file, "-" for standard input.
+ * @return the number of weights changed, or -1 if the file cannot
+ *         be read (errno tells why) or the graph is read only.
+ */
+long
+d_crp_load_metric(
+        struct d_graph   *graph,
+        const char       *path,
+        int               flags);
+
+/**
+ * @return nonzero if the graph has a partition with its overlay
+ *         computed for the current weights.
+ */
+int
+d_crp_present(
+        struct d_graph   *graph);
+
+#endif /* _CRP_H */
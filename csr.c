@@ -0,0 +1,233 @@
+/* csr.c -- compressed sparse row layout of a frozen graph.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 11:40:02 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "csr.h"
+
+static const struct d_csr *sort_csr; /* for cmp_by_name(), qsort(3)
+                                      * has no user data pointer */
+
+static int
+cmp_by_name(const void *a, const void *b)
+{
+    return strcmp(
+            d_csr_name(sort_csr, *(const uint32_t *)a),
+            d_csr_name(sort_csr, *(const uint32_t *)b));
+} /* cmp_by_name */
+
+struct d_csr *
+d_csr_build(
+        struct d_node   **tab,
+        int               n)
+{
+    struct d_csr *res = calloc(1, sizeof *res);
+    assert(res != NULL);
+
+    int i;
+    size_t m = 0, pool_sz = 0;
+    for (i = 0; i < n; ++i) {
+        m       += tab[i]->next_n;
+        pool_sz += strlen(tab[i]->name) + 1;
+    }
+    assert(m <= UINT32_MAX && pool_sz <= UINT32_MAX);
+
+    res->n        = n;
+    res->m        = m;
+    res->pool_sz  = pool_sz;
+    res->off      = malloc((n + 1) * sizeof *res->off);
+    res->tgt      = malloc((m ? m : 1) * sizeof *res->tgt);
+    res->wgt      = malloc((m ? m : 1) * sizeof *res->wgt);
+    res->name_off = malloc((n ? n : 1) * sizeof *res->name_off);
+    res->by_name  = malloc((n ? n : 1) * sizeof *res->by_name);
+    res->pool     = malloc(pool_sz ? pool_sz : 1);
+    assert(res->off && res->tgt && res->wgt
+            && res->name_off && res->by_name && res->pool);
+
+    uint32_t e = 0, p = 0;
+    for (i = 0; i < n; ++i) {
+        struct d_node *nod = tab[i];
+        struct d_link *l, *end = nod->next + nod->next_n;
+
+        res->off[i] = e;
+        for (l = nod->next; l < end; ++l, ++e) {
+            res->tgt[e] = l->to->id;
+            res->wgt[e] = l->weight;
+        }
+        size_t len = strlen(nod->name) + 1;
+        memcpy(res->pool + p, nod->name, len);
+        res->name_off[i] = p;
+        res->by_name[i]  = i;
+        p += len;
+    }
+    res->off[n] = e;
+
+    sort_csr = res;
+    qsort(res->by_name, n, sizeof *res->by_name, cmp_by_name);
+    sort_csr = NULL;
+
+    return res;
+} /* d_csr_build */
+
+void
+d_csr_build_reverse(
+        struct d_csr     *csr)
+{
+    uint32_t n = csr->n, m = csr->m, i, e;
+
+    if (csr->r_off) return;
+
+    uint32_t *r_off = calloc(n + 2, sizeof *r_off);
+    uint32_t *r_src = malloc((m ? m : 1) * sizeof *r_src);
+    int32_t  *r_wgt = malloc((m ? m : 1) * sizeof *r_wgt);
+    assert(r_off && r_src && r_wgt);
+
+    /* counting sort of the links by target.  Links keep their
+     * relative order, so the ones arriving to a node are still
+     * sorted by weight per origin. */
+    for (e = 0; e < m; ++e)
+        r_off[csr->tgt[e] + 2]++;
+    for (i = 2; i < n + 2; ++i)
+        r_off[i] += r_off[i - 1];
+    for (i = 0; i < n; ++i) {
+        for (e = csr->off[i]; e < csr->off[i + 1]; ++e) {
+            uint32_t p = r_off[csr->tgt[e] + 1]++;
+            r_src[p] = i;
+            r_wgt[p] = csr->wgt[e];
+        }
+    }
+    csr->r_src = r_src;
+    csr->r_wgt = r_wgt;
+    /* r_off is set last, so a reader that sees it can use the rest */
+    __atomic_store_n(&csr->r_off, r_off, __ATOMIC_RELEASE);
+} /* d_csr_build_reverse */
+
+int32_t
+d_csr_max_weight(
+        struct d_csr     *csr)
+{
+    if (__atomic_load_n(&csr->max_ok, __ATOMIC_ACQUIRE))
+        return csr->max_wgt;
+
+    /* threads racing here calculate the same value */
+    int32_t res = 0;
+    uint32_t i;
+    for (i = 0; i < csr->n; ++i)
+        if (csr->off[i + 1] > csr->off[i]
+                && csr->wgt[csr->off[i + 1] - 1] > res)
+            res = csr->wgt[csr->off[i + 1] - 1];
+    csr->max_wgt = res;
+    __atomic_store_n(&csr->max_ok, 1, __ATOMIC_RELEASE);
+    return res;
+} /* d_csr_max_weight */
+
+int64_t
+d_csr_cost_bound(
+        struct d_csr     *csr)
+{
+    if (__atomic_load_n(&csr->bound_ok, __ATOMIC_ACQUIRE))
+        return csr->bound;
+
+    /* threads racing here calculate the same value */
+    int64_t res = 0;
+    uint32_t i;
+    for (i = 0; i < csr->n; ++i)
+        if (csr->off[i + 1] > csr->off[i])
+            res += csr->wgt[csr->off[i + 1] - 1];
+    csr->bound = res;
+    __atomic_store_n(&csr->bound_ok, 1, __ATOMIC_RELEASE);
+    return res;
+} /* d_csr_cost_bound */
+
+int
+d_csr_set_weight(
+        struct d_csr     *csr,
+        uint32_t          from,
+        uint32_t          to,
+        int32_t           weight)
+{
+    uint32_t e, beg = csr->off[from], end = csr->off[from + 1];
+
+    for (e = beg; e < end && csr->tgt[e] != to; ++e)
+        continue;
+    if (e == end) return -1;
+
+    int32_t old = csr->wgt[e];
+    /* shift the links in between, to keep them sorted */
+    for (; e > beg && csr->wgt[e - 1] > weight; --e) {
+        csr->tgt[e] = csr->tgt[e - 1];
+        csr->wgt[e] = csr->wgt[e - 1];
+    }
+    for (; e + 1 < end && csr->wgt[e + 1] < weight; ++e) {
+        csr->tgt[e] = csr->tgt[e + 1];
+        csr->wgt[e] = csr->wgt[e + 1];
+    }
+    csr->tgt[e] = to;
+    csr->wgt[e] = weight;
+    if (csr->max_ok && weight > csr->max_wgt)
+        csr->max_wgt = weight;
+    csr->bound_ok = 0;
+
+    if (csr->r_off) {
+        for (e = csr->r_off[to]; e < csr->r_off[to + 1]; ++e)
+            if (csr->r_src[e] == from) {
+                csr->r_wgt[e] = weight;
+                break;
+            }
+    }
+    return old;
+} /* d_csr_set_weight */
+
+void
+d_csr_free(
+        struct d_csr     *csr)
+{
+    if (!csr) return;
+    free(csr->r_off);
+    free(csr->r_src);
+    free(csr->r_wgt);
+    if (csr->map) {
+        munmap(csr->map, csr->map_sz);
+        free(csr);
+        return;
+    }
+    free(csr->off);
+    free(csr->tgt);
+    free(csr->wgt);
+    free(csr->name_off);
+    free(csr->by_name);
+    free(csr->pool);
+    free(csr);
+} /* d_csr_free */
+
+int
+d_csr_find_name(
+        const struct d_csr *csr,
+        const char         *name,
+        size_t              len)
+{
+    uint32_t lo = 0, hi = csr->n;
+
+    /* binary search of the first name not less than name */
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const char *s = d_csr_name(csr, csr->by_name[mid]);
+        int c = strncmp(s, name, len);
+        if (c == 0 && s[len] != '\0') c = 1; /* s is longer */
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < csr->n) {
+        const char *s = d_csr_name(csr, csr->by_name[lo]);
+        if (strncmp(s, name, len) == 0 && s[len] == '\0')
+            return csr->by_name[lo];
+    }
+    return -1;
+} /* d_csr_find_name */
@@ -0,0 +1,148 @@
+/* csr.h -- compressed sparse row layout of a frozen graph.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 11:40:02 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * This is an internal header, shared by the modules of the
+ * library that traverse a frozen graph.  Users of the library
+ * should only use the functions in dijkstra.h
+ */
+
+#ifndef _CSR_H
+#define _CSR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dijkstra.h"
+
+/* a frozen graph.  Node ids are the d_node id's, and the links
+ * of node i are the entries [off[i], off[i+1]) of the tgt and
+ * wgt arrays, sorted by weight as d_sort() does. */
+struct d_csr {
+    uint32_t        n;         /* number of nodes */
+    uint32_t        m;         /* number of links */
+    uint32_t       *off;       /* n + 1 offsets into tgt/wgt */
+    uint32_t       *tgt;       /* target node id of each link */
+    int32_t        *wgt;       /* weight of each link */
+    uint32_t       *name_off;  /* offset of each node name in pool */
+    uint32_t       *by_name;   /* node ids, in name order */
+    char           *pool;      /* all node names, nul terminated */
+    size_t          pool_sz;   /* size of the pool */
+    void           *map;       /* if not NULL, the arrays point into
+                                * this mapping (of a snapshot) */
+    size_t          map_sz;    /* size of the mapping */
+    int32_t         max_wgt;   /* biggest weight, if max_ok */
+    int             max_ok;    /* max_wgt is known, see
+                                * d_csr_max_weight() */
+    int64_t         bound;     /* bound of the path costs, if
+                                * bound_ok */
+    int             bound_ok;  /* bound is known, see
+                                * d_csr_cost_bound() */
+
+    /* reverse adjacency, built on demand by d_csr_build_reverse().
+     * The links arriving to node i are the entries
+     * [r_off[i], r_off[i+1]) of the r_src and r_wgt arrays. */
+    uint32_t       *r_off;     /* n + 1 offsets into r_src/r_wgt */
+    uint32_t       *r_src;     /* origin node id of each link */
+    int32_t        *r_wgt;     /* weight of each link */
+}; /* struct d_csr */
+
+/**
+ * Build the CSR layout from the table of nodes of a graph.
+ *
+ * The links of every node must have been sorted before (with
+ * d_sort())
+ *
+ * @param tab is the table of nodes, indexed by id.
+ * @param n is the number of nodes in tab.
+ * @return the new layout.
+ */
+struct d_csr *
+d_csr_build(
+        struct d_node   **tab,
+        int               n);
+
+/**
+ * Build the reverse adjacency of a CSR layout (the r_* arrays),
+ * if not already built.
+ *
+ * This is not thread safe, callers sharing the layout must
+ * serialize the calls.
+ */
+void
+d_csr_build_reverse(
+        struct d_csr     *csr);
+
+/**
+ * Change the weight of the link from node from to node to, in
+ * place.  The link is moved among the links of from, so they are
+ * still sorted by weight, and the reverse adjacency is updated,
+ * if built.
+ *
+ * This is not thread safe, no query can be running on the
+ * layout.  Layouts pointing into a mapped file cannot be changed.
+ *
+ * @return the old weight of the link, or -1 if there's no link
+ *         from from to to.
+ */
+int
+d_csr_set_weight(
+        struct d_csr     *csr,
+        uint32_t          from,
+        uint32_t          to,
+        int32_t           weight);
+
+/**
+ * @return the biggest weight of the links of the layout (0 if it
+ *         has none).  It is calculated on the first call, from
+ *         the last link of each node (the links are sorted by
+ *         weight), and kept.
+ */
+int32_t
+d_csr_max_weight(
+        struct d_csr     *csr);
+
+/**
+ * @return an upper bound of the cost of any path without cycles of
+ *         the layout: the sum of the biggest weight of the links of
+ *         each node, as such a path leaves each node by one link at
+ *         most.  It is calculated on the first call, and kept until
+ *         a weight changes.
+ */
+int64_t
+d_csr_cost_bound(
+        struct d_csr     *csr);
+
+/**
+ * Free a CSR layout.  If the layout points into a mapped file,
+ * the file is unmapped.
+ */
+void
+d_csr_free(
+        struct d_csr     *csr);
+
+/**
+ * Search a node by name, in the name ordered table.
+ *
+ * @return the id of the node, or -1 if not found.
+ */
+int
+d_csr_find_name(
+        const struct d_csr *csr,
+        const char         *name,
+        size_t              len);
+
+/**
+ * @return the name of node id in the layout.
+ */
+static inline const char *
+d_csr_name(
+        const struct d_csr *csr,
+        uint32_t            id)
+{
+    return csr->pool + csr->name_off[id];
+} /* d_csr_name */
+
+#endif /* _CSR_H */
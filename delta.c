@@ -0,0 +1,312 @@
+/* delta.c -- parallel delta-stepping searches.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sun Oct 18 10:12:31 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * The tentative cost and parent of each node are packed in a 64
+ * bit word (cost in the high half), so a relaxation updates both
+ * at once with a compare and swap, and the parent of a node
+ * always gives its cost.  Each thread has its own set of cyclic
+ * buckets, where it puts the nodes it improves, and the entries
+ * of the current bucket of all threads are shared among them by
+ * an atomic counter in each phase.  Phases are separated by a
+ * barrier, and the first thread does the bookkeeping between
+ * them.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "graph.h"
+#include "delta.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+#define GRAB_SIZE           64         /* entries taken by a thread at once */
+#define MAX_BUCKETS         4096       /* max buckets per thread */
+
+#define NONE                UINT64_MAX /* not reached */
+#define PACK(_c, _p)        ((uint64_t)(uint32_t)(_c) << 32 | (uint32_t)(_p))
+#define COST(_x)            ((int)((_x) >> 32))
+#define BACK(_x)            ((int)(uint32_t)(_x))
+
+#define SETTLED             (-1)       /* in done[], heavy links relaxed */
+
+struct vec {
+    int            *a;
+    int             n;
+    int             cap;
+};
+
+struct worker {
+    struct shared  *s;
+    pthread_t       thr;
+    struct vec     *bkt;       /* the buckets of this thread */
+    struct vec      work;      /* entries of the current bucket */
+    struct vec      light;     /* nodes relaxed in the current bucket */
+    int             base;      /* index of work.a[0] among all the
+                                * entries of the phase */
+};
+
+struct shared {
+    const struct d_csr *csr;
+    uint64_t       *dist;      /* packed cost and parent of each node */
+    int            *done;      /* cost with which the light links of
+                                * each node were relaxed, INT_MAX if
+                                * not yet, or SETTLED */
+    int             delta;
+    int             nb;        /* buckets per thread */
+    int             threads;
+    struct worker  *w;
+    pthread_barrier_t bar;
+    int             cur;       /* bucket being processed */
+    int             total;     /* entries of the phase */
+    int             next;      /* next entry to grab */
+    int             more;      /* the bucket needs another phase */
+    int             stop;      /* no more buckets */
+    int             phases;
+};
+
+static void
+vec_push(struct vec *v, int x)
+{
+    if (v->n == v->cap) {
+        v->cap = v->cap ? 2 * v->cap : 64;
+        v->a = realloc(v->a, v->cap * sizeof *v->a);
+        assert(v->a != NULL);
+    }
+    v->a[v->n++] = x;
+} /* vec_push */
+
+static void
+relax(struct worker *w, int u, int v, long long cost)
+{
+    struct shared *s = w->s;
+
+    if (cost > INT_MAX)
+        return; /* doesn't fit in a cost, the path is dropped */
+
+    uint64_t old = __atomic_load_n(&s->dist[v], __ATOMIC_RELAXED);
+    uint64_t val = PACK(cost, u);
+
+    while (old == NONE || COST(old) > cost) {
+        if (__atomic_compare_exchange_n(&s->dist[v], &old, val, 1,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            vec_push(&w->bkt[cost / s->delta % s->nb], v);
+            return;
+        }
+    }
+} /* relax */
+
+/* relaxes the light links of entry x of the current bucket, if
+ * not done before with its current cost */
+static void
+do_light(struct worker *w, int x)
+{
+    struct shared *s = w->s;
+    int c = COST(__atomic_load_n(&s->dist[x], __ATOMIC_RELAXED));
+    int old = __atomic_load_n(&s->done[x], __ATOMIC_RELAXED);
+
+    do {
+        if (old <= c) return; /* done already, or settled */
+    } while (!__atomic_compare_exchange_n(&s->done[x], &old, c, 1,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    vec_push(&w->light, x);
+
+    /* links are sorted by weight, light ones go first */
+    const struct d_csr *csr = s->csr;
+    uint32_t e, end = csr->off[x + 1];
+    for (e = csr->off[x]; e < end && csr->wgt[e] <= s->delta; ++e)
+        relax(w, x, csr->tgt[e], (long long)c + csr->wgt[e]);
+} /* do_light */
+
+/* relaxes the heavy links of a node settled in the current
+ * bucket, once */
+static void
+do_heavy(struct worker *w, int x)
+{
+    struct shared *s = w->s;
+    int c = COST(s->dist[x]);
+    int old = c;
+
+    if (!__atomic_compare_exchange_n(&s->done[x], &old, SETTLED, 0,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return; /* relaxed with a higher cost, or settled */
+
+    const struct d_csr *csr = s->csr;
+    uint32_t e, beg = csr->off[x];
+    for (e = csr->off[x + 1]; e > beg && csr->wgt[e - 1] > s->delta; --e)
+        relax(w, x, csr->tgt[e - 1], (long long)c + csr->wgt[e - 1]);
+} /* do_heavy */
+
+static void *
+loop(void *arg)
+{
+    struct worker *w = arg;
+    struct shared *s = w->s;
+    int i, k;
+
+    for (;;) {
+        /* light phases, while nodes fall in the current bucket */
+        do {
+            struct vec *b = &w->bkt[s->cur % s->nb];
+            struct vec tmp = w->work;
+            w->work = *b;
+            *b = tmp;
+            b->n = 0;
+            pthread_barrier_wait(&s->bar);
+            if (w == s->w) {
+                for (i = 0, k = 0; i < s->threads; ++i) {
+                    s->w[i].base = k;
+                    k += s->w[i].work.n;
+                }
+                s->total = k;
+                s->next  = 0;
+                s->phases++;
+            }
+            pthread_barrier_wait(&s->bar);
+
+            int t = 0;
+            while ((k = __atomic_fetch_add(&s->next, GRAB_SIZE,
+                            __ATOMIC_RELAXED)) < s->total) {
+                int end = k + GRAB_SIZE < s->total
+                        ? k + GRAB_SIZE
+                        : s->total;
+                for (; k < end; ++k) {
+                    while (k >= s->w[t].base + s->w[t].work.n) t++;
+                    while (k < s->w[t].base) t--;
+                    do_light(w, s->w[t].work.a[k - s->w[t].base]);
+                }
+            }
+            pthread_barrier_wait(&s->bar);
+            if (w == s->w) {
+                s->more = 0;
+                for (i = 0; i < s->threads; ++i)
+                    if (s->w[i].bkt[s->cur % s->nb].n > 0)
+                        s->more = 1;
+            }
+            pthread_barrier_wait(&s->bar);
+        } while (s->more);
+
+        /* the nodes of the bucket are settled now */
+        for (i = 0; i < w->light.n; ++i)
+            do_heavy(w, w->light.a[i]);
+        w->light.n = 0;
+        pthread_barrier_wait(&s->bar);
+
+        if (w == s->w) {
+            int b;
+            s->stop = 1;
+            for (b = s->cur + 1; b <= s->cur + s->nb && s->stop; ++b)
+                for (i = 0; i < s->threads; ++i)
+                    if (s->w[i].bkt[b % s->nb].n > 0) {
+                        s->cur  = b;
+                        s->stop = 0;
+                        break;
+                    }
+        }
+        pthread_barrier_wait(&s->bar);
+        if (s->stop) break;
+    }
+    return NULL;
+} /* loop */
+
+int
+d_query_delta(
+        struct d_query   *q,
+        struct d_node    *orig,
+        int               delta,
+        int               threads,
+        int               flags)
+{
+    const struct d_csr *csr = q->graph->csr;
+    struct shared s = { .csr = csr };
+    uint32_t n = csr->n, v;
+    int i, max_w = 0;
+    long long sum_w = 0;
+
+    d_query_start(q);
+
+    /* the links of a node are sorted, the last is the heaviest */
+    for (v = 0; v < n; ++v)
+        if (csr->off[v + 1] > csr->off[v]
+                && csr->wgt[csr->off[v + 1] - 1] > max_w)
+            max_w = csr->wgt[csr->off[v + 1] - 1];
+    if (delta <= 0) {
+        uint32_t e;
+        for (e = 0; e < csr->m; ++e)
+            sum_w += csr->wgt[e];
+        delta = csr->m ? sum_w / csr->m : 1;
+        if (delta < 1) delta = 1;
+    }
+    if (max_w / delta + 2 > MAX_BUCKETS)
+        delta = max_w / (MAX_BUCKETS - 2) + 1;
+    if (threads < 1) threads = 1;
+
+    s.delta   = delta;
+    s.nb      = max_w / delta + 2; /* costs in the buckets are from
+                                    * the current one to max_w more */
+    s.threads = threads;
+    s.dist    = malloc((n ? n : 1) * sizeof *s.dist);
+    s.done    = malloc((n ? n : 1) * sizeof *s.done);
+    s.w       = calloc(threads, sizeof *s.w);
+    assert(s.dist && s.done && s.w);
+    memset(s.dist, 0xff, n * sizeof *s.dist); /* NONE */
+    for (v = 0; v < n; ++v)
+        s.done[v] = INT_MAX;
+    for (i = 0; i < threads; ++i) {
+        s.w[i].s   = &s;
+        s.w[i].bkt = calloc(s.nb, sizeof *s.w[i].bkt);
+        assert(s.w[i].bkt != NULL);
+    }
+    pthread_barrier_init(&s.bar, NULL, threads);
+
+    if (flags & (D_FLAG_DEBUG | D_FLAG_ADD_NODE_FRONTIER))
+        printf(F("Add start node %s to bucket 0 (delta=%d, "
+                "%d buckets, %d threads)\n"),
+                orig->name, delta, s.nb, threads);
+    q->orig = orig->id;
+    s.dist[orig->id] = PACK(0, -1);
+    vec_push(&s.w[0].bkt[0], orig->id);
+
+    for (i = 1; i < threads; ++i) {
+        int res = pthread_create(&s.w[i].thr, NULL, loop, &s.w[i]);
+        assert(res == 0);
+    }
+    loop(&s.w[0]);
+    for (i = 1; i < threads; ++i)
+        pthread_join(s.w[i].thr, NULL);
+
+    /* publish the result in the query */
+    uint32_t ep = q->epoch;
+    for (v = 0; v < n; ++v) {
+        if (s.dist[v] == NONE) continue;
+        q->cost[v]  = COST(s.dist[v]);
+        q->back[v]  = BACK(s.dist[v]);
+        q->stamp[v] = ep + 1;
+        q->order[q->settled++] = v;
+    }
+    STAT(q->stats.settled += q->settled);
+    if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END))
+        printf(F("Delta-stepping END, %d nodes settled in %d phases\n"),
+                q->settled, s.phases);
+
+    pthread_barrier_destroy(&s.bar);
+    for (i = 0; i < threads; ++i) {
+        int b;
+        for (b = 0; b < s.nb; ++b)
+            free(s.w[i].bkt[b].a);
+        free(s.w[i].bkt);
+        free(s.w[i].work.a);
+        free(s.w[i].light.a);
+    }
+    free(s.w);
+    free(s.dist);
+    free(s.done);
+    return q->settled;
+} /* d_query_delta */
@@ -0,0 +1,52 @@
+/* delta.h -- parallel delta-stepping searches.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sun Oct 18 10:12:31 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _DELTA_H
+#define _DELTA_H
+
+#include "dijkstra.h"
+
+/**
+ * Run a query without destination with the delta-stepping
+ * algorithm, on several threads.
+ *
+ * Nodes are grouped in buckets by tentative cost, each bucket
+ * covering delta consecutive costs.  The buckets are processed
+ * in order, and all the nodes of a bucket at once: first the
+ * light links (of weight not greater than delta) of its nodes
+ * are relaxed in parallel, again and again while nodes fall in
+ * the same bucket, then the heavy ones.  The work of each phase
+ * is spread among the threads.
+ *
+ * The costs are the same d_query_run(query, orig, NULL, flags)
+ * gives, and the parents are a valid tree of minimum cost paths
+ * (when several paths have the minimum cost, the one reported
+ * can be a different one).  All the nodes reached are settled
+ * and can be read with d_query_cost(), d_query_back() and
+ * d_query_print_route().
+ *
+ * A small delta makes more buckets, with less work each, and a
+ * large one makes nodes to be relaxed more than once.  A good
+ * value is about the weight of the links, and it is chosen as
+ * the average weight of the links if delta is 0.  It is raised
+ * if needed to limit the number of buckets.
+ *
+ * @param query is the query context.
+ * @param orig is the origin node of paths.
+ * @param delta is the width of the buckets, or 0.
+ * @param threads is the number of threads to use.
+ * @return the number of nodes settled.
+ */
+int
+d_query_delta(
+        struct d_query   *query,
+        struct d_node    *orig,
+        int               delta,
+        int               threads,
+        int               flags);
+
+#endif /* _DELTA_H */
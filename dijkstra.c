@@ -6,14 +6,15 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
-#include <avl.h>
-
-#include "dijkstra.h"
+#include "graph.h"
+#include "order.h"
 
 #define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
 
@@ -21,15 +22,13 @@
 
 #define FLAG_NEEDS_SORT     (1 << 0)
 #define FLAG_NODE_REACHED   (1 << 1)
+#define FLAG_NODE_QUEUED    (1 << 2)
+#define FLAG_NEEDS_DEDUP    (1 << 3)
+
+/* d_sort() hands the nodes to its threads in chunks of ids */
+#define SORT_CHUNK          1024
 
 
-struct d_graph {
-    AVL_TREE         db;       /* database of nodes */
-    char            *name;     /* name of this graph */
-    struct d_node   *fr_start; /* the list of nodes in the frontier */
-    struct d_node   *fr_end;   /* the last node of the frontier */
-    int              nodes;    /* num of nodes of this graph */
-}; /* struct d_graph */
 
 struct d_graph *
 d_new_graph(
@@ -42,49 +41,282 @@ d_new_graph(
     strcpy((char *)(res + 1), name); /* copy the name */
     res->name = (char *)(res + 1); /* make it point to the extra
                                     * bytes after the structure */
-    res->db = new_avl_tree( /* allocate the database instance */
-            (AVL_FCOMP) strcmp,  /* comparator */
-            NULL,
-            NULL,
-            NULL);
-    res->nodes = 0;
+    d_hindex_init(&res->idx); /* the database of nodes */
+    d_arena_init(&res->a_nodes);
+    d_arena_init(&res->a_names);
+    d_arena_init(&res->a_links);
+    res->sorted   = NULL;
+    res->sorted_n = 0;
+    res->nodes    = 0;
+    res->tab      = NULL;
+    res->tab_cap  = 0;
+    res->heap     = NULL;
+    res->csr      = NULL;
+    res->ch       = NULL;
+    res->crp      = NULL;
+    res->cache    = NULL;
+    res->query    = NULL;
+    res->pub      = NULL;
+    res->pub_n    = 0;
+    res->frontier = D_FRONTIER_DEFAULT;
+    res->search   = D_SEARCH_DEFAULT;
+    res->costs    = D_COSTS_DEFAULT;
+    res->order    = D_ORDER_DEFAULT;
+    res->max_wgt  = 0;
+    res->heuristic = NULL;
+    res->h_data   = NULL;
+    res->delta    = 0;
+    res->d_threads = 1;
+    res->ro       = 0;
+    res->bulk     = 0;
+    pthread_mutex_init(&res->mtx, NULL);
     if (flags & (D_FLAG_DEBUG | D_FLAG_NEW_GRAPH))
         printf(F("Graph %s created\n"), res->name);
 
     return res;
 } /* d_new_graph */
 
+void
+d_free_graph(
+        struct d_graph   *graph)
+{
+    if (!graph) return;
+    /* nodes, names and links go away with their arenas, we don't
+     * need to visit them */
+    d_arena_destroy(&graph->a_nodes);
+    d_arena_destroy(&graph->a_names);
+    d_arena_destroy(&graph->a_links);
+    d_hindex_destroy(&graph->idx);
+    d_ch_free(graph->ch);
+    d_crp_free(graph->crp);
+    d_cache_free(graph->cache);
+    d_csr_free(graph->csr);
+    d_query_free(graph->query);
+    d_heap_free(graph->heap);
+    free(graph->tab);
+    free(graph->sorted);
+    free(graph->pub);
+    pthread_mutex_destroy(&graph->mtx);
+    free(graph);
+} /* d_free_graph */
+
+void
+d_graph_mem_stats(
+        struct d_graph        *graph,
+        struct d_arena_stats   stats[D_ARENA_N])
+{
+    const struct d_arena *a[D_ARENA_N] = {
+        [D_ARENA_NODES] = &graph->a_nodes,
+        [D_ARENA_NAMES] = &graph->a_names,
+        [D_ARENA_LINKS] = &graph->a_links,
+    };
+    int i;
+    for (i = 0; i < D_ARENA_N; ++i) {
+        stats[i].used     = a[i]->used - a[i]->slab_free;
+        stats[i].reserved = a[i]->reserved;
+        stats[i].recycled = a[i]->slab_free;
+    }
+} /* d_graph_mem_stats */
+
+ssize_t
+d_print_mem_stats(
+        struct d_graph   *graph,
+        FILE             *out)
+{
+    static const char *names[D_ARENA_N] = {
+        [D_ARENA_NODES] = "nodes",
+        [D_ARENA_NAMES] = "names",
+        [D_ARENA_LINKS] = "links",
+    };
+    struct d_arena_stats st[D_ARENA_N];
+    ssize_t res = fprintf(out, "Graph %s memory:\n", graph->name);
+    int i;
+
+    d_graph_mem_stats(graph, st);
+    for (i = 0; i < D_ARENA_N; ++i)
+        res += fprintf(out,
+                "  Arena %s: used=%zu reserved=%zu recycled=%zu\n",
+                names[i], st[i].used, st[i].reserved, st[i].recycled);
+    return res;
+} /* d_print_mem_stats */
+
+double
+d_stats_now(void)
+{
+#if D_STATS
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+#else
+    return 0.0;
+#endif
+} /* d_stats_now */
+
+void
+d_get_stats(
+        struct d_graph   *graph,
+        struct d_stats   *stats)
+{
+    *stats = graph->stats;
+} /* d_get_stats */
+
+void
+d_stats_add(
+        struct d_stats       *to,
+        const struct d_stats *from)
+{
+    to->queries   += from->queries;
+    to->passes    += from->passes;
+    to->settled   += from->settled;
+    to->scanned   += from->scanned;
+    to->visited   += from->visited;
+    to->improved  += from->improved;
+    to->overflows += from->overflows;
+    if (from->frontier_max > to->frontier_max)
+        to->frontier_max = from->frontier_max;
+    to->t_setup   += from->t_setup;
+    to->t_search  += from->t_search;
+    to->t_publish += from->t_publish;
+} /* d_stats_add */
+
+ssize_t
+d_print_stats(
+        const char           *title,
+        const struct d_stats *st,
+        FILE                 *out)
+{
+    return fprintf(out,
+            "%s: %ld searches\n"
+            "  passes=%ld settled=%ld frontier_max=%ld\n"
+            "  links: scanned=%ld visited=%ld improved=%ld "
+            "overflows=%ld\n"
+            "  time(s): setup=%.6f search=%.6f publish=%.6f\n",
+            title, st->queries,
+            st->passes, st->settled, st->frontier_max,
+            st->scanned, st->visited, st->improved, st->overflows,
+            st->t_setup, st->t_search, st->t_publish);
+} /* d_print_stats */
+
+static void
+thaw(struct d_graph *graph, int flags)
+{
+    if (!graph->csr) return;
+    if (flags & (D_FLAG_DEBUG | D_FLAG_FREEZE))
+        printf(F("Graph %s modified, dropping frozen layout\n"),
+                graph->name);
+    d_csr_free(graph->csr);
+    d_ch_free(graph->ch);
+    d_crp_free(graph->crp);
+    d_cache_invalidate(graph->cache);
+    graph->csr = NULL;
+    graph->ch  = NULL;
+    graph->crp = NULL;
+    /* the frontier is fit to the weights, on the next search */
+    d_heap_free(graph->heap);
+    graph->heap = NULL;
+} /* thaw */
+
 struct d_node *
-d_lookup_node(
+d_lookup_node_hashed(
         struct d_graph          *graph,
         const char              *name,
+        size_t                   len,
+        uint64_t                 hash,
         int                      flags)
 {
-    struct d_node *res = avl_tree_get(graph->db, name);
+    if (graph->ro) {
+        /* nodes cannot be created in a read only graph */
+        int id = d_csr_find_name(graph->csr, name, len);
+        return id >= 0 ? d_node_by_id(graph, id) : NULL;
+    }
+    int id = d_hindex_find(&graph->idx, graph->tab, name, len, hash);
+    struct d_node *res = id >= 0 ? graph->tab[id] : NULL;
     if (!res) {
-        res = malloc(strlen(name) + 1 + sizeof *res);
-        assert(res != NULL);
-        res->name     = (char *)(res + 1);
-        strcpy(res->name, name);
-        avl_tree_put(graph->db, res->name, res);
+        thaw(graph, flags);
+        res = d_arena_alloc(&graph->a_nodes,
+                sizeof *res, _Alignof(struct d_node));
+        res->name     = d_arena_alloc(&graph->a_names, len + 1, 1);
+        memcpy(res->name, name, len);
+        res->name[len] = '\0';
+        res->hash     = hash;
         res->next_n   = 0;
         res->next_cap = DEFAULT_CAP;
-        res->next     = malloc(DEFAULT_CAP * sizeof *res->next);
-        assert(res->next != NULL);
+        res->next     = d_arena_slab_alloc(&graph->a_links, 0,
+                DEFAULT_CAP * sizeof *res->next);
         res->back     = NULL;
         res->graph    = graph;
         res->flags    = 0;
-        graph->nodes++;
+        res->cost     = 0;
+        if (graph->nodes == graph->tab_cap) {
+            graph->tab_cap = graph->tab_cap
+                    ? graph->tab_cap << 1
+                    : DEFAULT_CAP;
+            graph->tab = realloc(graph->tab,
+                    graph->tab_cap * sizeof *graph->tab);
+            assert(graph->tab != NULL);
+        }
+        res->id       = graph->nodes;
+        graph->tab[graph->nodes++] = res;
+        d_hindex_insert(&graph->idx, graph->tab, res);
         if (flags & (D_FLAG_DEBUG | D_FLAG_ALLOC_NODE))
             printf(F("Graph %s, allocating node %s => %p\n"),
-                graph->name, name, res);
+                graph->name, res->name, res);
     }
     if (flags & (D_FLAG_DEBUG | D_FLAG_LOOKUP_NODE))
         printf(F("Graph %s, lookup node %s => %p\n"),
             graph->name, res->name, res);
     return res;
+} /* d_lookup_node_hashed */
+
+struct d_node *
+d_lookup_node(
+        struct d_graph          *graph,
+        const char              *name,
+        int                      flags)
+{
+    size_t len = strlen(name);
+    return d_lookup_node_hashed(graph, name, len,
+            d_hash_name(name, len), flags);
 } /* d_lookup_node */
 
+struct d_node *
+d_find_node(
+        struct d_graph          *graph,
+        const char              *name)
+{
+    size_t len = strlen(name);
+    if (graph->ro) {
+        int id = d_csr_find_name(graph->csr, name, len);
+        return id >= 0 ? d_node_by_id(graph, id) : NULL;
+    }
+    int id     = d_hindex_find(&graph->idx, graph->tab,
+            name, len, d_hash_name(name, len));
+    return id >= 0 ? graph->tab[id] : NULL;
+} /* d_find_node */
+
+struct d_node *
+d_node_materialize(
+        struct d_graph          *graph,
+        int                      id)
+{
+    pthread_mutex_lock(&graph->mtx);
+    struct d_node *res = graph->tab[id];
+    if (!res) {
+        res = d_arena_alloc(&graph->a_nodes,
+                sizeof *res, _Alignof(struct d_node));
+        memset(res, 0, sizeof *res);
+        /* the name lives in the pool of the frozen layout, and the
+         * links only there. */
+        res->name  = (char *)d_csr_name(graph->csr, id);
+        res->hash  = d_hash_name(res->name, strlen(res->name));
+        res->graph = graph;
+        res->id    = id;
+        __atomic_store_n(&graph->tab[id], res, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&graph->mtx);
+    return res;
+} /* d_node_materialize */
+
 struct d_link *
 d_add_link(
         struct d_node           *from,
@@ -93,30 +325,56 @@ d_add_link(
         int                      flags)
 {
     /* first check that the link is not already present in the
-     * array. */
+     * array (unless in bulk mode). */
     struct d_link *res;
     int i;
-    for (i = 0, res = from->next; i < from->next_n; ++i, ++res) {
-        if (res->from == from && res->to == to) {
-            /* change the weight, set needs to sort */
-            res->weight       = weight;
-            res->from->flags |= FLAG_NEEDS_SORT;
-            if (flags & (D_FLAG_DEBUG | D_FLAG_ADD_ALREADY_IN_DB))
-                printf(F("Link from %s to %s already in node, "
-                    "just adjust weight to %d\n"),
-                    from->name, to->name, weight);
-            return res;
+    if (from->graph->ro) {
+        errno = EROFS; /* cannot modify a read only graph */
+        return NULL;
+    }
+    if (weight < 0) {
+        /* the frontier engines don't settle nodes right with
+         * negative weights */
+        errno = EINVAL;
+        return NULL;
+    }
+    thaw(from->graph, flags);
+    if (from->graph->bulk) {
+        /* the duplicates are dropped later, by d_end_bulk() */
+        if (from->next_n > 0)
+            from->flags |= FLAG_NEEDS_DEDUP;
+    } else {
+        for (i = 0, res = from->next; i < from->next_n; ++i, ++res) {
+            if (res->from == from && res->to == to) {
+                /* change the weight, set needs to sort */
+                res->weight       = weight;
+                if (weight > from->graph->max_wgt)
+                    from->graph->max_wgt = weight;
+                res->from->flags |= FLAG_NEEDS_SORT;
+                if (flags & (D_FLAG_DEBUG | D_FLAG_ADD_ALREADY_IN_DB))
+                    printf(F("Link from %s to %s already in node, "
+                        "just adjust weight to %d\n"),
+                        from->name, to->name, weight);
+                return res;
+            }
         }
     }
+    res = from->next + from->next_n;
     /* let's check the capacity for the need of expansion. */
     if (from->next_n == from->next_cap) {
-        /* need to expand */
+        /* need to expand.  Link arrays come from the slab of the
+         * graph, in classes of capacity DEFAULT_CAP << cls, so the
+         * old array is reused by the next node that grows to its
+         * size. */
+        struct d_arena *a = &from->graph->a_links;
+        int cls = __builtin_ctz(from->next_cap / DEFAULT_CAP);
+        size_t sz = from->next_cap * sizeof *from->next;
+        struct d_link *old = from->next;
+
+        from->next = d_arena_slab_alloc(a, cls + 1, 2 * sz);
+        memcpy(from->next, old, sz);
+        d_arena_slab_free(a, cls, old, sz);
         from->next_cap <<= 1;  /* double it */
-        from->next = realloc(  /* and extend */
-                from->next,
-                from->next_cap
-                    * (sizeof *from->next));
-        assert(from->next != NULL);
         res = from->next + from->next_n;
         if (flags & (D_FLAG_DEBUG | D_FLAG_ADD_INCREASING_CAP))
             printf(F("Node %s increasing capacity to %d\n"),
@@ -127,6 +385,8 @@ d_add_link(
     res->weight = weight;
     res->from = from;
     res->to = to;
+    if (weight > from->graph->max_wgt)
+        from->graph->max_wgt = weight;
     from->flags |= FLAG_NEEDS_SORT;
     from->next_n++;
     if (flags & (D_FLAG_DEBUG | D_FLAG_ADD))
@@ -135,20 +395,87 @@ d_add_link(
     return res;
 } /* d_add_link */
 
+int
+d_reweight_link(
+        struct d_graph          *graph,
+        int                      from,
+        int                      to,
+        int                      weight,
+        int                      flags)
+{
+    if (graph->ro) return -1; /* the layout is in a read only map */
+    if (weight < 0) return -1; /* as d_add_link() */
+
+    struct d_node *nod = graph->tab[from];
+    /* from the end, as the last of the duplicates pending from
+     * bulk mode is the one kept */
+    struct d_link *l = nod->next + nod->next_n;
+    while (l > nod->next && l[-1].to->id != to)
+        --l;
+    if (l-- == nod->next) return -1;
+
+    int old = l->weight;
+    l->weight   = weight;
+    nod->flags |= FLAG_NEEDS_SORT;
+    if (weight > graph->max_wgt)
+        graph->max_wgt = weight;
+    if (graph->csr)
+        d_csr_set_weight(graph->csr, from, to, weight);
+    if (graph->ch) {
+        /* shortcuts may not be minimum anymore */
+        d_ch_free(graph->ch);
+        graph->ch = NULL;
+    }
+    if (graph->crp)
+        graph->crp->customized = 0; /* the partition is still valid */
+    d_cache_invalidate(graph->cache);
+    if (flags & (D_FLAG_DEBUG | D_FLAG_ADD_ALREADY_IN_DB))
+        printf(F("Link from %s to %s, weight changed from %d to %d\n"),
+                nod->name, l->to->name, old, weight);
+    return old;
+} /* d_reweight_link */
+
 static int
 cmp_node(const void *a, const void *b)
 {
     const struct d_link
         *A = a,
         *B = b;
-    return A->weight - B->weight;
+    /* not A->weight - B->weight, that can overflow */
+    return (A->weight > B->weight) - (A->weight < B->weight);
 } /* cmp_node */
 
-static int
-sort_node(struct d_node *n, void *call_data)
+/* drops the links of n to a node it has a later link to, so the
+ * last weight added wins, as if the links had been added one by
+ * one.  mark[] has a slot per node, where the targets already seen
+ * are stamped with the id of n + 1 (so it is never cleared). */
+static void
+dedup_node(struct d_node *n, uint32_t *mark)
 {
-    int flags = *(int *)call_data;
+    uint32_t st = n->id + 1;
+    int i, j = n->next_n;
 
+    for (i = n->next_n - 1; i >= 0; --i) {
+        struct d_link *l = n->next + i;
+        if (mark[l->to->id] == st) continue; /* an older one */
+        mark[l->to->id] = st;
+        n->next[--j] = *l;
+    }
+    n->next_n -= j;
+    memmove(n->next, n->next + j, n->next_n * sizeof *n->next);
+    n->flags &= ~FLAG_NEEDS_DEDUP;
+} /* dedup_node */
+
+static void
+sort_node(struct d_node *n, uint32_t **mark, int flags)
+{
+    if (n->flags & FLAG_NEEDS_DEDUP) {
+        if (!*mark) {
+            *mark = calloc(n->graph->nodes, sizeof **mark);
+            assert(*mark != NULL);
+        }
+        dedup_node(n, *mark);
+    }
     if (n->flags & FLAG_NEEDS_SORT) {
         qsort(n->next, n->next_n, sizeof *n->next,
                 cmp_node);
@@ -158,17 +485,71 @@ sort_node(struct d_node *n, void *call_data)
                 n->name);
         }
     }
-    return 0;
 } /* sort_node */
 
+struct sort_work {
+    struct d_graph  *graph;
+    int              next;     /* first id not taken yet */
+    int              flags;
+};
+
+static void *
+sort_worker(void *arg)
+{
+    struct sort_work *w = arg;
+    struct d_graph *graph = w->graph;
+    uint32_t *mark = NULL;
+    int lo;
+
+    while ((lo = __atomic_fetch_add(&w->next, SORT_CHUNK,
+                    __ATOMIC_RELAXED)) < graph->nodes) {
+        int id, hi = graph->nodes - lo < SORT_CHUNK
+            ? graph->nodes
+            : lo + SORT_CHUNK;
+        for (id = lo; id < hi; ++id)
+            if (graph->tab[id]) /* read only graphs create them lazily */
+                sort_node(graph->tab[id], &mark, w->flags);
+    }
+    free(mark);
+    return NULL;
+} /* sort_worker */
+
+/* each node is deduplicated and sorted independently, so they are
+ * split among nthreads threads */
+static void
+sort_nodes(
+        struct d_graph          *graph,
+        int                      nthreads,
+        int                      flags)
+{
+    struct sort_work w = { .graph = graph, .next = 0, .flags = flags };
+    int i, max = (graph->nodes + SORT_CHUNK - 1) / SORT_CHUNK;
+
+    if (nthreads > max) nthreads = max;
+    if (nthreads <= 1) {
+        sort_worker(&w);
+        return;
+    }
+    pthread_t *th = malloc(nthreads * sizeof *th);
+    assert(th != NULL);
+    for (i = 0; i < nthreads; ++i) {
+        int res = pthread_create(&th[i], NULL, sort_worker, &w);
+        assert(res == 0);
+    }
+    for (i = 0; i < nthreads; ++i)
+        pthread_join(th[i], NULL);
+    free(th);
+} /* sort_nodes */
+
 static int
 reset_node(struct d_node *n, void *call_data)
 {
+    (void)call_data;
     n->back          = NULL;
     n->next_l        = n->next;
     n->cost          = 0;
-    n->flags         = 0;
-    return sort_node(n, call_data);
+    n->flags        &= FLAG_NEEDS_SORT | FLAG_NEEDS_DEDUP;
+    return 0;
 } /* reset_node */
 
 void
@@ -176,15 +557,51 @@ d_sort(
         struct d_graph          *graph,
         int                      flags)
 {
-    d_foreach_node(graph, sort_node, &flags);
+    sort_nodes(graph, 1, flags);
 } /* d_sort */
 
+int
+d_begin_bulk(
+        struct d_graph          *graph)
+{
+    if (graph->ro) return -1; /* cannot modify a read only graph */
+    graph->bulk = 1;
+    return 0;
+} /* d_begin_bulk */
+
+void
+d_end_bulk(
+        struct d_graph          *graph,
+        int                      nthreads,
+        int                      flags)
+{
+    graph->bulk = 0;
+    sort_nodes(graph, nthreads, flags);
+} /* d_end_bulk */
+
+int
+d_freeze(
+        struct d_graph   *graph,
+        int               flags)
+{
+    if (graph->csr) return 0; /* already frozen */
+
+    d_sort(graph, flags);
+    d_order_nodes(graph, graph->order, flags);
+    graph->csr = d_csr_build(graph->tab, graph->nodes);
+    if (flags & (D_FLAG_DEBUG | D_FLAG_FREEZE))
+        printf(F("Graph %s frozen, %u nodes, %u links\n"),
+                graph->name, graph->csr->n, graph->csr->m);
+    return 0;
+} /* d_freeze */
+
 void
 d_reset(
         struct d_graph   *graph,
         int               flags)
 {
-    d_foreach_node(graph, reset_node, &flags);
+    d_sort(graph, flags);
+    d_foreach_node(graph, reset_node, NULL);
 } /* d_reset */
 
 struct call_data {
@@ -196,10 +613,21 @@ static int
 print_node(struct d_node *n, void *call_data)
 {
     struct call_data *p = call_data;
-    int res;
+    int res = 0;
     res += fprintf(p->out_file,
             "  Node %s: flags=0x%x\n",
             n->name, n->flags);
+    const struct d_csr *csr = n->graph->csr;
+    if (csr) {
+        /* frozen, links may only exist in the frozen layout */
+        uint32_t e;
+        for (e = csr->off[n->id]; e < csr->off[n->id + 1]; ++e)
+            res += fprintf(p->out_file,
+                    "    Next=%s, wgt=%d\n",
+                    d_csr_name(csr, csr->tgt[e]), csr->wgt[e]);
+        p->printed_chars += res;
+        return 0;
+    }
     struct d_link *l = n->next;
     int i;
     for (i = 0; i < n->next_n; ++i, ++l)
@@ -224,13 +652,145 @@ d_print_graph(struct d_graph *graph, FILE *out)
 } /* d_print_graph */
 
 int
-d_dijkstra(
+d_set_frontier(
+        struct d_graph   *graph,
+        int               kind)
+{
+    switch (kind) {
+    case D_FRONTIER_LIST:
+    case D_FRONTIER_BINARY:
+    case D_FRONTIER_PAIRING:
+    case D_FRONTIER_RADIX:
+    case D_FRONTIER_DIAL:
+    case D_FRONTIER_AUTO:
+        break;
+    default:
+        return -1;
+    }
+    if (graph->frontier != kind) {
+        d_heap_free(graph->heap);
+        d_query_free(graph->query);
+        graph->heap     = NULL;
+        graph->query    = NULL;
+        graph->frontier = kind;
+    }
+    return 0;
+} /* d_set_frontier */
+
+struct d_heap *
+d_graph_heap_new(
+        struct d_graph   *graph,
+        int               capacity)
+{
+    /* read only graphs have their links in the frozen layout only */
+    int max_w = graph->ro
+            ? d_csr_max_weight(graph->csr)
+            : graph->max_wgt;
+    int kind = graph->frontier;
+
+    if (kind == D_FRONTIER_LIST)
+        kind = D_FRONTIER_BINARY;
+    if (kind == D_FRONTIER_AUTO)
+        kind = max_w <= D_DIAL_MAX_WEIGHT
+                ? D_FRONTIER_DIAL
+                : D_FRONTIER_BINARY;
+
+    struct d_heap *res = d_heap_new(kind, capacity);
+    /* keys in the frontier are at most the biggest weight over the
+     * minimum */
+    d_heap_set_span(res, max_w < INT_MAX ? max_w + 1 : max_w);
+    return res;
+} /* d_graph_heap_new */
+
+int
+d_set_search(
+        struct d_graph   *graph,
+        int               kind)
+{
+    switch (kind) {
+    case D_SEARCH_DIJKSTRA:
+    case D_SEARCH_BIDIR:
+    case D_SEARCH_ASTAR:
+    case D_SEARCH_CH:
+    case D_SEARCH_CRP:
+        break;
+    default:
+        return -1;
+    }
+    graph->search = kind;
+    return 0;
+} /* d_set_search */
+
+int
+d_set_costs(
+        struct d_graph   *graph,
+        int               kind)
+{
+    switch (kind) {
+    case D_COSTS_INT:
+    case D_COSTS_CHECKED:
+    case D_COSTS_AUTO:
+    case D_COSTS_INT64:
+        break;
+    default:
+        return -1;
+    }
+    if (kind != graph->costs)
+        d_cache_invalidate(graph->cache); /* paths may be dropped */
+    graph->costs = kind;
+    return 0;
+} /* d_set_costs */
+
+int
+d_set_order(
+        struct d_graph   *graph,
+        int               kind)
+{
+    switch (kind) {
+    case D_ORDER_NONE:
+    case D_ORDER_BFS:
+    case D_ORDER_RCM:
+        break;
+    default:
+        return -1;
+    }
+    graph->order = kind;
+    return 0;
+} /* d_set_order */
+
+int
+d_set_delta(
+        struct d_graph   *graph,
+        int               threads,
+        int               delta)
+{
+    if (delta < 0) return -1;
+    graph->d_threads = threads;
+    graph->delta     = delta;
+    return 0;
+} /* d_set_delta */
+
+int
+d_set_heuristic(
+        struct d_graph   *graph,
+        int             (*heuristic)(
+                                struct d_node *,
+                                struct d_node *,
+                                void *),
+        void             *calldata)
+{
+    graph->heuristic = heuristic;
+    graph->h_data    = calldata;
+    return 0;
+} /* d_set_heuristic */
+
+static int
+list_dijkstra(
         struct d_graph   *graph,
         struct d_node    *orig,
         struct d_node    *dest,
         int               flags)
 {
-    d_reset(graph, flags);
 
     if (flags & (D_FLAG_DEBUG | D_FLAG_ADD_NODE_FRONTIER))
         printf(F("Add start node %s to the frontier\n"),
@@ -243,8 +803,9 @@ d_dijkstra(
     int pass = 0;
     struct d_link *cand;  /* candidate */
     int n_nodes = 1;
+    struct d_stats *st = &graph->stats;
     do {
-        int cost = INT_MAX;
+        int64_t cost = INT64_MAX;
         pass++; /* increment the iteration */
 
         cand = NULL;
@@ -263,7 +824,9 @@ d_dijkstra(
             struct d_link *end = nod->next + nod->next_n;
             for (l = nod->next_l; l < end; ++l)
             {
+                STAT(st->scanned++);
                 if (l->to->flags & FLAG_NODE_REACHED) {
+                    STAT(st->visited++);
                     if (flags
                         & (D_FLAG_DEBUG
                             | D_FLAG_PASS_ALREADY_VISITED))
@@ -276,7 +839,7 @@ d_dijkstra(
                     nod->next_l = l + 1;
                     continue;
                 }
-                int new_cost = l->from->cost + l->weight;
+                int64_t new_cost = l->from->cost + l->weight;
                 if (new_cost < cost) {
                     cost = new_cost;
                     /* need to increment l before breaking
@@ -285,14 +848,18 @@ d_dijkstra(
                     cand = l;
                     if (flags & (D_FLAG_DEBUG |
                             D_FLAG_PASS_GOT_CANDIDATE))
-                        printf(F("   Got a candidate: %s(c=%d) "
-                                "-[w=%d]-> %s(c=%d)\n"),
-                                cand->from->name, cand->from->cost,
+                        printf(F("   Got a candidate: %s(c=%lld) "
+                                "-[w=%d]-> %s(c=%lld)\n"),
+                                cand->from->name,
+                                (long long)cand->from->cost,
                                 cand->weight,
-                                cand->to->name, cost);
-                    /* exit the loop */
-                    break;
+                                cand->to->name, (long long)cost);
                 }
+                /* links are sorted, so the first not visited one
+                 * is the best this node can offer.  We cannot go
+                 * on, or the skip of visited nodes above would
+                 * jump over this link. */
+                break;
             }
             if (nod->next_l == end) {
                 /* we exhausted this node, unlink it from the doubly linked list */
@@ -326,52 +893,341 @@ d_dijkstra(
                     D_FLAG_PASS_ADD_CANDIDATE))
             {
                 printf(F(" - Adding selected candidate "
-                        "%s(c=%d) >=[w=%d]=> %s(c=%d) => <<<%s>>> "
+                        "%s(c=%lld) >=[w=%d]=> %s(c=%lld) => <<<%s>>> "
                         "to the frontier\n"),
-                        cand->from->name, cand->from->cost,
+                        cand->from->name, (long long)cand->from->cost,
                         cand->weight,
-                        cand->to->name, cost,
+                        cand->to->name, (long long)cost,
                         cand->to->name);
             }
             n_nodes++;
+            STAT(st->improved++);
+            STAT(d_stats_frontier(st, n_nodes));
         }
     } while (cand && cand->to != dest);
+    STAT(st->passes += pass);
+    STAT(st->settled += st->improved + 1);
     if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END)) {
         printf(F("Pass #%d END (%d nodes in the frontier)\n"),
                 pass, n_nodes);
     }
     return pass;
+} /* list_dijkstra */
+
+static int
+heap_dijkstra(
+        struct d_graph   *graph,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+    if (!graph->heap)
+        graph->heap = d_graph_heap_new(graph, graph->nodes);
+    d_heap_clear(graph->heap);
+    d_heap_grow(graph->heap, graph->nodes);
+
+    if (flags & (D_FLAG_DEBUG | D_FLAG_ADD_NODE_FRONTIER))
+        printf(F("Add start node %s to the frontier\n"),
+                orig->name);
+    orig->flags |= FLAG_NODE_QUEUED;
+    d_heap_push(graph->heap, orig->id, 0);
+
+    int pass = 0;
+    int id;
+    struct d_stats *st = &graph->stats;
+    while ((id = d_heap_pop(graph->heap, NULL)) >= 0) {
+        struct d_node *nod = graph->tab[id];
+
+        pass++;
+        nod->flags |= FLAG_NODE_REACHED;
+        if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_START))
+            printf(F("Pass #%d START, node %s(c=%lld) "
+                    "(%d nodes in the frontier)\n"),
+                    pass, nod->name, (long long)nod->cost,
+                    d_heap_size(graph->heap));
+        if (nod == dest) break;
+
+        struct d_link *l;
+        struct d_link *end = nod->next + nod->next_n;
+        STAT(st->scanned += nod->next_n);
+        for (l = nod->next; l < end; ++l) {
+            struct d_node *to = l->to;
+            if (to->flags & FLAG_NODE_REACHED) {
+                STAT(st->visited++);
+                if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_ALREADY_VISITED))
+                    printf(F("     Node %s already visited, "
+                            "skipping link\n"),
+                            to->name);
+                continue;
+            }
+            int64_t new_cost = nod->cost + l->weight;
+            if (!(to->flags & FLAG_NODE_QUEUED) || new_cost < to->cost) {
+                to->cost   = new_cost;
+                to->back   = nod;
+                to->flags |= FLAG_NODE_QUEUED;
+                d_heap_push(graph->heap, to->id, new_cost);
+                STAT(st->improved++);
+                if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_ADD_CANDIDATE))
+                    printf(F(" - Candidate %s(c=%lld) -[w=%d]-> "
+                            "%s(c=%lld)\n"),
+                            nod->name, (long long)nod->cost, l->weight,
+                            to->name, (long long)new_cost);
+            }
+        }
+        STAT(d_stats_frontier(st, d_heap_size(graph->heap)));
+    }
+    STAT(st->passes += pass);
+    STAT(st->settled += pass);
+    if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END)) {
+        printf(F("Pass #%d END (%d nodes in the frontier)\n"),
+                pass, d_heap_size(graph->heap));
+    }
+    return pass;
+} /* heap_dijkstra */
+
+/* runs the query of the graph on the frozen layout (with A* if
+ * heuristic is not NULL), and publishes the result in the d_node
+ * structures.  Only the nodes published by the last run need to
+ * be reset. */
+static int
+query_dijkstra(
+        struct d_graph   *graph,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int             (*heuristic)(
+                                struct d_node *,
+                                struct d_node *,
+                                void *),
+        void             *calldata,
+        int               flags)
+{
+    int i;
+
+    if (graph->pub_n < 0) {
+        d_reset(graph, flags);
+    } else {
+        for (i = 0; i < graph->pub_n; ++i) {
+            struct d_node *n = d_node_by_id(graph, graph->pub[i]);
+            n->back   = NULL;
+            n->cost   = 0;
+            n->flags &= FLAG_NEEDS_SORT;
+        }
+    }
+    if (!graph->query)
+        graph->query = d_query_new(graph, flags);
+
+    struct d_query *q = graph->query;
+    d_query_stats_reset(q);
+    int res = heuristic
+            ? d_query_astar(q, orig, dest, heuristic, calldata, flags)
+            : d_query_run(q, orig, dest, flags);
+
+#if D_STATS
+    double t0 = d_stats_now();
+#endif
+    graph->pub = realloc(graph->pub, q->cap * sizeof *graph->pub);
+    assert(graph->pub != NULL);
+    for (i = 0; i < q->settled; ++i) {
+        int id = q->order[i];
+        struct d_node *n = d_node_by_id(graph, id);
+        n->cost   = Q_COST(q, id);
+        n->back   = q->back[id] >= 0
+                ? d_node_by_id(graph, q->back[id])
+                : NULL;
+        n->flags |= FLAG_NODE_REACHED;
+        graph->pub[i] = id;
+    }
+    graph->pub_n = q->settled;
+    graph->stats = q->stats;
+#if D_STATS
+    graph->stats.t_publish = d_stats_now() - t0;
+#endif
+    return res;
+} /* query_dijkstra */
+
+int
+d_dijkstra(
+        struct d_graph   *graph,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+    if ((dest && graph->search != D_SEARCH_DIJKSTRA)
+            || (!dest && graph->d_threads > 1) || graph->cache) {
+        /* only the query engine does other strategies, and has
+         * the cache */
+        d_freeze(graph, flags);
+        return query_dijkstra(graph, orig, dest, NULL, NULL, flags);
+    }
+    if (graph->csr && (graph->frontier != D_FRONTIER_LIST || graph->ro))
+        return query_dijkstra(graph, orig, dest, NULL, NULL, flags);
+
+    memset(&graph->stats, 0, sizeof graph->stats);
+#if D_STATS
+    double t0 = d_stats_now();
+#endif
+    d_reset(graph, flags);
+    graph->pub_n = -1; /* all nodes may have been touched */
+#if D_STATS
+    double t1 = d_stats_now();
+#endif
+    int res = graph->frontier == D_FRONTIER_LIST
+            ? list_dijkstra(graph, orig, dest, flags)
+            : heap_dijkstra(graph, orig, dest, flags);
+#if D_STATS
+    graph->stats.queries  = 1;
+    graph->stats.t_setup  = t1 - t0;
+    graph->stats.t_search = d_stats_now() - t1;
+#endif
+    return res;
 } /* d_dijkstra */
 
+int
+d_astar(
+        struct d_graph   *graph,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int             (*heuristic)(
+                                struct d_node *,
+                                struct d_node *,
+                                void *),
+        void             *calldata,
+        int               flags)
+{
+    d_freeze(graph, flags);
+    return query_dijkstra(graph, orig, dest, heuristic, calldata, flags);
+} /* d_astar */
+
+/* the routes are walked back from their end, so the steps are
+ * stacked to print them from the origin, without recursion (a
+ * route can be as long as the graph) */
+#define ROUTE_STACK         64
+
 ssize_t
 d_print_route(
         FILE             *file,
         struct d_node    *nod)
 {
+    struct d_node *stk[ROUTE_STACK], **path = stk, *p;
+    size_t n = 0, cap = ROUTE_STACK;
     ssize_t res = 0;
-    if (nod->back) {
-        res += d_print_route(file, nod->back);
-        res += fprintf(file, "->");
+
+    for (p = nod; p; p = p->back) {
+        if (n == cap) {
+            struct d_node **np = malloc(2 * cap * sizeof *np);
+            assert(np != NULL);
+            memcpy(np, path, n * sizeof *np);
+            if (path != stk) free(path);
+            path = np;
+            cap *= 2;
+        }
+        path[n++] = p;
     }
-    res += fprintf(file, "[%s:c=%d]",
-            nod->name, nod->cost);
+    while (n-- > 0)
+        res += fprintf(file, "[%s:c=%lld]%s",
+                path[n]->name, (long long)path[n]->cost, n ? "->" : "");
+    if (path != stk) free(path);
     return res;
 } /* d_print_route */
 
+static ssize_t
+print_tree_node(
+        FILE             *file,
+        struct d_node    *n,
+        int               format)
+{
+    if (format == D_TREE_BINARY) {
+        struct d_tree_rec r = {
+            .node   = n->id,
+            .parent = n->back ? (uint32_t)n->back->id : D_TREE_ROOT,
+            .cost   = n->cost,
+        };
+        return fwrite(&r, sizeof r, 1, file) * sizeof r;
+    }
+    return fprintf(file, "%s %s %lld\n",
+            n->name, n->back ? n->back->name : "-", (long long)n->cost);
+} /* print_tree_node */
+
+ssize_t
+d_print_tree(
+        FILE             *file,
+        struct d_graph   *graph,
+        int               format)
+{
+    ssize_t res = 0;
+    int i;
+
+    if (format == D_TREE_BINARY) {
+        struct d_tree_header h;
+        memcpy(h.magic, D_TREE_MAGIC, sizeof h.magic);
+        h.version = D_TREE_VERSION;
+        h.nodes   = graph->nodes;
+        h.reached = 0;
+        if (graph->pub_n >= 0) {
+            h.reached = graph->pub_n;
+        } else {
+            for (i = 0; i < graph->nodes; ++i)
+                if (graph->tab[i]->flags & FLAG_NODE_REACHED)
+                    h.reached++;
+        }
+        res += fwrite(&h, sizeof h, 1, file) * sizeof h;
+    }
+    if (graph->pub_n >= 0) {
+        /* published by a query, in the order they were settled, so
+         * every parent goes before its children */
+        for (i = 0; i < graph->pub_n; ++i)
+            res += print_tree_node(file,
+                    d_node_by_id(graph, graph->pub[i]), format);
+    } else {
+        for (i = 0; i < graph->nodes; ++i)
+            if (graph->tab[i]->flags & FLAG_NODE_REACHED)
+                res += print_tree_node(file, graph->tab[i], format);
+    }
+    return res;
+} /* d_print_tree */
+
+static int
+cmp_name(const void *a, const void *b)
+{
+    const struct d_node
+        *A = *(struct d_node * const *)a,
+        *B = *(struct d_node * const *)b;
+    return strcmp(A->name, B->name);
+} /* cmp_name */
+
 int
 d_foreach_node(
         struct d_graph         *g,
         int                   (*callback)(struct d_node *, void *),
         void                   *calldata)
 {
-    AVL_ITERATOR it;
-    for (it = avl_tree_first(g->db);
-         it != NULL;
-         it = avl_iterator_next(it))
-    {
-        struct d_node *nod = avl_iterator_data(it);
+    if (g->csr) {
+        /* frozen, go through the name ordered table */
+        uint32_t i;
+        for (i = 0; i < g->csr->n; ++i) {
+            int res;
+            if (callback
+                    && (res = callback(
+                                d_node_by_id(g, g->csr->by_name[i]),
+                                calldata)))
+                return res;
+        }
+        return 0;
+    }
+    /* the index of nodes is not ordered, so we sort the nodes by
+     * name on demand.  The sort is only repeated if nodes have
+     * been added since. */
+    if (g->sorted_n != g->nodes) {
+        g->sorted = realloc(g->sorted, g->nodes * sizeof *g->sorted);
+        assert(g->nodes == 0 || g->sorted != NULL);
+        memcpy(g->sorted, g->tab, g->nodes * sizeof *g->sorted);
+        qsort(g->sorted, g->nodes, sizeof *g->sorted, cmp_name);
+        g->sorted_n = g->nodes;
+    }
+    int i;
+    for (i = 0; i < g->sorted_n; ++i) {
         int res;
-        if (callback && (res = callback(nod, calldata)))
+        if (callback && (res = callback(g->sorted[i], calldata)))
             return res;
     }
     return 0;
@@ -9,6 +9,7 @@
 #ifndef _DIJKSTRA_H
 #define _DIJKSTRA_H
 
+#include <stdint.h>
 #include <stdio.h>
 
 #define D_FLAG_DEBUG                (1 << 0)
@@ -29,8 +30,66 @@
 #define D_FLAG_PASS_NODE_EXHAUSTED  (1 << 15)
 #define D_FLAG_PASS_ADD_CANDIDATE   (1 << 16)
 #define D_FLAG_PASS_END             (1 << 17)
+#define D_FLAG_FREEZE               (1 << 18)
+
+/* frontier engines available to d_dijkstra(), see d_set_frontier() */
+#define D_FRONTIER_LIST             0  /* doubly linked list, full scan */
+#define D_FRONTIER_BINARY           1  /* indexed binary heap */
+#define D_FRONTIER_PAIRING          2  /* pairing heap */
+#define D_FRONTIER_RADIX            3  /* monotone radix heap */
+#define D_FRONTIER_DIAL             4  /* bucket queue, one per cost */
+#define D_FRONTIER_AUTO             5  /* dial for small weights, else
+                                        * binary */
+#define D_FRONTIER_DEFAULT          D_FRONTIER_AUTO
+
+/* biggest weight of a graph for D_FRONTIER_AUTO to use the dial */
+#define D_DIAL_MAX_WEIGHT           1024
+
+/* search strategies of point to point queries, see d_set_search() */
+#define D_SEARCH_DIJKSTRA           0  /* one search from the origin */
+#define D_SEARCH_BIDIR              1  /* bidirectional search */
+#define D_SEARCH_ASTAR              2  /* A*, see d_set_heuristic() */
+#define D_SEARCH_CH                 3  /* contraction hierarchy, see ch.h */
+#define D_SEARCH_CRP                4  /* partition and overlay, see crp.h */
+#define D_SEARCH_DEFAULT            D_SEARCH_DIJKSTRA
+
+/* arithmetic of the costs of the searches, see d_set_costs() */
+#define D_COSTS_INT                 0  /* plain int, no checks */
+#define D_COSTS_CHECKED             1  /* paths costing more than INT_MAX
+                                        * are dropped */
+#define D_COSTS_AUTO                2  /* 64 bit only if the weights
+                                        * allow such paths */
+#define D_COSTS_INT64               3  /* 64 bit costs */
+#define D_COSTS_DEFAULT             D_COSTS_AUTO
+
+/* orders of the nodes of a frozen graph, see d_set_order() */
+#define D_ORDER_NONE                0  /* as the names first appeared */
+#define D_ORDER_BFS                 1  /* breadth first */
+#define D_ORDER_RCM                 2  /* reverse Cuthill-McKee */
+#define D_ORDER_DEFAULT             D_ORDER_NONE
+
+/* formats of the shortest path tree, see d_print_tree() */
+#define D_TREE_TEXT                 0  /* node parent cost, by name */
+#define D_TREE_BINARY               1  /* struct d_tree_header and
+                                        * records, by id */
+#define D_TREE_MAGIC                "DIJKTREE"
+#define D_TREE_VERSION              2
+#define D_TREE_ROOT                 0xffffffffU  /* parent of the origin */
+
+/* counters of the searches (see struct d_stats) are compiled in
+ * unless this is defined as 0 (make stats=0) */
+#ifndef D_STATS
+#define D_STATS                     1
+#endif
+
+/* arenas of a graph, see d_graph_mem_stats() */
+#define D_ARENA_NODES               0  /* d_node structures */
+#define D_ARENA_NAMES               1  /* node names */
+#define D_ARENA_LINKS               2  /* arrays of links */
+#define D_ARENA_N                   3
 
 struct d_graph;                /* opaque */
+struct d_query;                /* opaque */
 
 struct d_link;                 /* link between nodes */
 struct d_node;                 /* nodes of a graph */
@@ -53,8 +112,27 @@ struct d_node {
     int             next_n;    /* number of next nodes */
     int             next_cap;  /* capacity of next array */
     int             flags;     /* flags for this node */
+    int             id;        /* dense id, in order of creation */
     struct d_link  *next_l;    /* next i to probe */
-    int             cost;      /* cost to reach this node */
+    int64_t         cost;      /* cost to reach this node */
+    uint64_t        hash;      /* hash of the name, cached */
+};
+
+/* header of the binary shortest path tree, followed by reached
+ * records, in host byte order.  The ids are those of the frozen
+ * graph (and of a snapshot saved from it). */
+struct d_tree_header {
+    char            magic[8];  /* D_TREE_MAGIC, no nul */
+    uint32_t        version;   /* D_TREE_VERSION */
+    uint32_t        nodes;     /* nodes of the graph, ids are less */
+    uint32_t        reached;   /* number of records that follow */
+};
+
+struct d_tree_rec {
+    uint32_t        node;      /* id of the node */
+    uint32_t        parent;    /* id of its parent, D_TREE_ROOT for
+                                * the origin */
+    int64_t         cost;      /* cost of the node */
 };
 
 /**
@@ -73,6 +151,99 @@ d_new_graph(
         char       *name,
         int         flags);
 
+/**
+ * Free a graph.
+ *
+ * All the memory of the graph (nodes, names, links, frozen
+ * layout...) is released.  Nodes, names and links are allocated
+ * from arenas owned by the graph, so they are released at once,
+ * without visiting them.  No reference to the graph or its nodes
+ * can be used after this call.
+ *
+ * @param graph is the graph to free.
+ */
+void
+d_free_graph(
+        struct d_graph   *graph);
+
+struct d_arena_stats {
+    size_t          used;      /* bytes in use */
+    size_t          reserved;  /* bytes allocated from the system */
+    size_t          recycled;  /* bytes freed, waiting to be reused */
+};
+
+/**
+ * Get the memory used by each arena of a graph.
+ *
+ * @param graph is the graph to get the stats of.
+ * @param stats is an array indexed by D_ARENA_* to fill.
+ */
+void
+d_graph_mem_stats(
+        struct d_graph        *graph,
+        struct d_arena_stats   stats[D_ARENA_N]);
+
+/**
+ * Print the memory used by each arena of a graph.
+ *
+ * @return the number of characters printed.
+ */
+ssize_t
+d_print_mem_stats(
+        struct d_graph   *graph,
+        FILE             *out);
+
+/* counters of the searches, see d_query_stats() and d_get_stats().
+ * They are all zero if the library is built with D_STATS 0. */
+struct d_stats {
+    long            queries;   /* searches run */
+    long            passes;    /* nodes taken from the frontiers */
+    long            settled;   /* nodes with their minimum cost found */
+    long            scanned;   /* links scanned */
+    long            visited;   /* links skipped, going to settled nodes */
+    long            improved;  /* links that lowered the cost of a node */
+    long            overflows; /* links dropped, as the cost of the path
+                                * would not fit in an int (see
+                                * d_set_costs()) */
+    long            frontier_max; /* most nodes in a frontier at once */
+    double          t_setup;   /* seconds preparing the searches */
+    double          t_search;  /* seconds searching */
+    double          t_publish; /* seconds copying the results to the
+                                * nodes, in d_dijkstra() */
+};
+
+/**
+ * Get the counters of the last d_dijkstra() (or d_astar()) run
+ * on a graph.
+ *
+ * @param graph is the graph.
+ * @param stats gets the counters.
+ */
+void
+d_get_stats(
+        struct d_graph   *graph,
+        struct d_stats   *stats);
+
+/**
+ * Add the counters of a search to others.  Counts and times are
+ * added, and frontier_max keeps the maximum.
+ */
+void
+d_stats_add(
+        struct d_stats       *to,
+        const struct d_stats *from);
+
+/**
+ * Print search counters.
+ *
+ * @return the number of characters printed.
+ */
+ssize_t
+d_print_stats(
+        const char           *title,
+        const struct d_stats *stats,
+        FILE                 *out);
+
 /**
  * Add link to the graph.
  *
@@ -84,10 +255,10 @@ d_new_graph(
  * @param a_name is the source node of the link.
  * @param b_name is the destination node of the link.
  * @param weight is the weight associated to this link in the
- *               direction from a to b.
- * @return 0 if successful, or != 0 on error.  Error can happen
- *           if no memory is available or a link already exists
- *           for the requested source and destination.
+ *               direction from a to b.  It cannot be negative.
+ * @return the link, or NULL on error, with errno set to EINVAL if
+ *           the weight is negative, or to EROFS if the graph is a
+ *           read only snapshot.
  */
 struct d_link *
 d_add_link(
@@ -100,7 +271,9 @@ d_add_link(
  * Lookup a named node in graph.
  *
  * This function searches for a node named as 'name', and
- * creates a new node in case it does not find one.
+ * creates a new node in case it does not find one.  Nodes are
+ * indexed by name in a hash table, so the lookup doesn't depend
+ * on the number of nodes of the graph.
  * @param graph is the graph on which we want to finde the node.
  * @param name is the name of the node we are searching for.
  * @return a reference to the just located node.
@@ -111,6 +284,21 @@ d_lookup_node(
         const char       *name,
         int               flags);
 
+/**
+ * Find a named node in graph.
+ *
+ * Same as d_lookup_node(), but it doesn't create the node if it
+ * doesn't exist, so the graph is not modified, and can be called
+ * concurrently from several threads.
+ * @param graph is the graph on which we want to find the node.
+ * @param name is the name of the node we are searching for.
+ * @return a reference to the node, or NULL if not found.
+ */
+struct d_node *
+d_find_node(
+        struct d_graph   *graph,
+        const char       *name);
+
 /**
  * Sorts the links of the nodes from lower weight to larger.
  *
@@ -122,6 +310,9 @@ d_lookup_node(
  * has been added or deleted, as the vector of links on each node
  * needs to be sorted for use in dijkstra algorithm.
  *
+ * It also drops the duplicate links left by the bulk mode (see
+ * d_begin_bulk()).
+ *
  * @param graph is the graph to be navigated.
  */
 void
@@ -129,6 +320,65 @@ d_sort(
         struct d_graph   *graph,
         int               flags);
 
+/**
+ * Start the bulk mode of building a graph.
+ *
+ * d_add_link() looks for a link between the same nodes before
+ * adding one, so adding d links to a node costs O(d^2).  In bulk
+ * mode it just appends the link, and the duplicates are dropped
+ * (keeping the weight of the last one added, as d_add_link() does
+ * out of bulk mode) by d_end_bulk(), or the next d_sort() or
+ * d_freeze().  The links returned by d_add_link() in bulk mode
+ * may not be valid after that.
+ *
+ * @param graph is the graph to build.
+ * @return 0 on success, -1 if the graph is read only.
+ */
+int
+d_begin_bulk(
+        struct d_graph   *graph);
+
+/**
+ * End the bulk mode of building a graph.
+ *
+ * Drops the duplicate links added since d_begin_bulk() and sorts
+ * the links of every node (as d_sort() does), with the nodes
+ * split among nthreads threads.
+ *
+ * @param graph is the graph being built.
+ * @param nthreads is the number of threads to use.
+ */
+void
+d_end_bulk(
+        struct d_graph   *graph,
+        int               nthreads,
+        int               flags);
+
+/**
+ * Freeze the graph in a compressed sparse row layout.
+ *
+ * This function sorts the graph (as d_sort() does) and builds a
+ * read only copy of it, optimized for traversal: nodes are
+ * identified by dense 32 bit ids, the links of all the nodes are
+ * packed in two arrays (targets and weights) indexed by an
+ * offsets array, and the node names are stored in a single
+ * string pool (the nodes are renumbered before, if an order was
+ * selected with d_set_order()).  Once frozen, d_dijkstra() runs
+ * on this layout (unless the D_FRONTIER_LIST engine is selected)
+ * and d_foreach_node() iterates it, in name order.
+ *
+ * Adding a node or a link to a frozen graph discards the frozen
+ * layout, so the graph must be frozen again to profit from it.
+ * Freezing an already frozen graph does nothing.
+ *
+ * @param graph is the graph to freeze.
+ * @return 0 on success.
+ */
+int
+d_freeze(
+        struct d_graph   *graph,
+        int               flags);
+
 /**
  * Reset the node to start a new Dijkstra.
  *
@@ -146,6 +396,172 @@ d_reset(
         struct d_graph   *graph,
         int               flags);
 
+/**
+ * Select the frontier engine used by d_dijkstra().
+ *
+ * D_FRONTIER_LIST is the original engine, that maintains the
+ * set of frontier nodes in a doubly linked list and scans it
+ * completely on each pass to select the cheapest link.  The
+ * rest of engines maintain the tentative cost of the nodes
+ * adjacent to the visited ones in a priority queue, so each
+ * pass only has to extract the minimum.  All of them give the
+ * same costs.  The radix heap needs all weights to be non
+ * negative (as the algorithm itself does).
+ *
+ * D_FRONTIER_DIAL is a bucket queue with one bucket per cost, in
+ * a ring as wide as the biggest weight of the graph, so pushing
+ * and extracting are O(1) (extracting skips the empty buckets up
+ * to the next cost).  It is the best engine when the weights are
+ * small integers.  D_FRONTIER_AUTO (the default) selects it if
+ * the biggest weight of the graph (tracked by d_add_link()) is
+ * at most D_DIAL_MAX_WEIGHT, and the binary heap otherwise.
+ *
+ * @param graph is the graph to configure.
+ * @param kind is one of the D_FRONTIER_* constants.
+ * @return 0 on success, -1 if kind is not a valid engine.
+ */
+int
+d_set_frontier(
+        struct d_graph   *graph,
+        int               kind);
+
+/**
+ * Select the search strategy used when a destination is given.
+ *
+ * D_SEARCH_DIJKSTRA grows a single search from the origin until
+ * the destination is settled.  D_SEARCH_BIDIR searches at the
+ * same time forward from the origin and backward from the
+ * destination (over the reverse links, built the first time they
+ * are needed) expanding each time the side with the cheapest
+ * frontier, and stops when the sum of both frontier minima
+ * reaches the cost of the best path found between both sides.
+ * This settles far less nodes on big sparse graphs.  The route
+ * and cost reported for the destination are the same (if there
+ * are several paths of minimum cost, any of them can be
+ * reported), but only the nodes in the forward search and in the
+ * route get a cost.
+ *
+ * D_SEARCH_ASTAR guides the search from the origin with the
+ * heuristic set by d_set_heuristic(), see d_astar().
+ * D_SEARCH_CH searches the contraction hierarchy of the graph,
+ * see d_ch_build() in ch.h (graphs without one use
+ * D_SEARCH_DIJKSTRA).  Only the nodes of the route get a cost.
+ * D_SEARCH_CRP searches the overlay of the partition of the graph,
+ * see d_crp_build() in crp.h (graphs without one, or whose overlay
+ * is not customized for the current weights, use
+ * D_SEARCH_DIJKSTRA).  Only the nodes of the route get a cost.
+ *
+ * Queries without destination always use D_SEARCH_DIJKSTRA (see
+ * also d_set_delta()).
+ *
+ * @param graph is the graph to configure.
+ * @param kind is one of the D_SEARCH_* constants.
+ * @return 0 on success, -1 if kind is not a valid strategy.
+ */
+int
+d_set_search(
+        struct d_graph   *graph,
+        int               kind);
+
+/**
+ * Select the arithmetic of the costs of the searches from a node.
+ *
+ * Weights are ints.  With D_COSTS_INT costs are ints too, and the
+ * sums of the weights are not checked, so a path costing more than
+ * INT_MAX wraps around and gets a wrong (maybe negative) cost.
+ * With D_COSTS_CHECKED such paths are dropped, as if their last
+ * link didn't exist (and counted in the overflows of struct
+ * d_stats), at the price of a wider sum per link.  With
+ * D_COSTS_INT64 costs are 64 bit, so no path overflows, at the
+ * price of a cost array twice as big, and of relaxing the links
+ * one by one (the kernels of relax.h sum ints).  D_COSTS_AUTO uses
+ * 64 bit costs only if some path could cost more than an int
+ * holds, that is, if the sum of the biggest weight of the links
+ * of each node doesn't fit in an int, so most graphs run with
+ * plain ints.
+ *
+ * The variant of the search run is chosen once per query, so the
+ * inner loop has no test for this (nor for the debug traces, nor
+ * for the destination, see forward.h).  Only the one directional
+ * search has 64 bit costs: the other strategies (see
+ * d_set_search()), the cache of searches and the delta-stepping of
+ * d_set_delta() are still run with 64 bit costs selected, but
+ * with checked ints, and a warning is printed on stderr (once per
+ * graph).
+ *
+ * @param graph is the graph to configure.
+ * @param kind is one of the D_COSTS_* constants.
+ * @return 0 on success, -1 if kind is not valid.
+ */
+int
+d_set_costs(
+        struct d_graph   *graph,
+        int               kind);
+
+/**
+ * Select the order of the nodes in the frozen layout.
+ *
+ * Nodes get their ids in the order their names first appear, so
+ * the neighbours of a node are usually far from it in the arrays
+ * the searches use.  With D_ORDER_BFS, d_freeze() renumbers the
+ * nodes in breadth first order (starting each component at its
+ * oldest node), and with D_ORDER_RCM in reverse Cuthill-McKee
+ * order (starting at a node of minimum degree, and visiting the
+ * neighbours of each node in increasing degree), so neighbours get
+ * near ids and a search has less cache misses.  The ids of the
+ * nodes change, their names, links and costs don't.
+ *
+ * It only applies when the graph is frozen, after this call.
+ *
+ * @param graph is the graph to configure.
+ * @param kind is one of the D_ORDER_* constants.
+ * @return 0 on success, -1 if kind is not valid.
+ */
+int
+d_set_order(
+        struct d_graph   *graph,
+        int               kind);
+
+/**
+ * Select the parallel delta-stepping algorithm for the queries
+ * without destination.
+ *
+ * With more than one thread, the searches from a node to all
+ * the nodes of the graph (d_dijkstra() or d_query_run() with a
+ * NULL destination) run d_query_delta() (see delta.h) with the
+ * given number of threads and bucket width (0 to choose one
+ * from the weights of the links).  The costs are the same, but
+ * when several paths have the minimum cost the route reported
+ * can be a different one.
+ *
+ * @param graph is the graph to configure.
+ * @param threads is the number of threads, 1 (or less) to use
+ *        the serial algorithm.
+ * @param delta is the width of the buckets, or 0.
+ * @return 0 on success, -1 if delta is negative.
+ */
+int
+d_set_delta(
+        struct d_graph   *graph,
+        int               threads,
+        int               delta);
+
+/**
+ * Set the heuristic used by D_SEARCH_ASTAR (see d_set_search())
+ * and its calldata pointer.  See d_astar() for the requirements
+ * of the heuristic.
+ *
+ * @return 0.
+ */
+int
+d_set_heuristic(
+        struct d_graph   *graph,
+        int             (*heuristic)(
+                                struct d_node *,
+                                struct d_node *,
+                                void *),
+        void             *calldata);
+
 /**
  * Print a graph.
  *
@@ -182,11 +598,197 @@ d_dijkstra(
         struct d_node    *dest,
         int               flags);
 
+/**
+ * Executes the A* algorithm on the graph given.
+ *
+ * Same as d_dijkstra(), but the frontier is ordered by the cost
+ * to reach each node plus the estimation of the cost from it to
+ * dest given by the heuristic, so the search goes first in the
+ * direction of dest.  The heuristic is called as
+ * heuristic(nod, dest, calldata) once per node reached, and it
+ * must not overestimate the real cost (it must be 0 at dest) and
+ * be consistent (the estimation from a node cannot be greater
+ * than the weight of a link from it plus the estimation from the
+ * other end).  A heuristic value of INT_MAX means that dest
+ * cannot be reached from the node, which is not explored any
+ * further.  The straight line distance between geographical
+ * nodes, or d_alt_heuristic() (see alt.h) are consistent.  A
+ * heuristic that always returns 0 makes this a plain Dijkstra
+ * search.
+ *
+ * @param graph is the graph we are calculating for.
+ * @param orig is the origin node of paths.
+ * @param dest is the destination node.
+ * @param heuristic is the heuristic function.
+ * @param calldata is passed to every call of heuristic.
+ * @return the number of nodes settled.  Comparing it with the
+ *         value returned by d_dijkstra() measures the benefit of
+ *         the heuristic.
+ */
+int
+d_astar(
+        struct d_graph   *graph,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int             (*heuristic)(
+                                struct d_node *,
+                                struct d_node *,
+                                void *),
+        void             *calldata,
+        int               flags);
+
+/**
+ * Create a new query context for a graph.
+ *
+ * A query holds all the state of a run of the algorithm (costs,
+ * parents, visited marks and the frontier) outside of the graph,
+ * so the graph is not modified by the queries, and as many
+ * queries as needed can run concurrently on the same graph (one
+ * per thread).  The graph is frozen (see d_freeze()) if it was
+ * not already, and it must not be modified while queries are
+ * running on it.
+ *
+ * Resetting the query for a new run is done in constant time,
+ * by means of an epoch counter, so the cost of a run depends only
+ * on the part of the graph explored.
+ *
+ * @param graph is the graph to run the queries on.
+ * @return the new query context.
+ */
+struct d_query *
+d_query_new(
+        struct d_graph   *graph,
+        int               flags);
+
+/**
+ * Free a query context.
+ */
+void
+d_query_free(
+        struct d_query   *query);
+
+/**
+ * @return the counters of the searches run with a query since it
+ *         was created (or since d_query_stats_reset()).  Each
+ *         query has its own, so threads don't share them.
+ */
+const struct d_stats *
+d_query_stats(
+        const struct d_query *query);
+
+/**
+ * Set the counters of a query to zero.
+ */
+void
+d_query_stats_reset(
+        struct d_query   *query);
+
+/**
+ * Run the algorithm with a query context.
+ *
+ * Same as d_dijkstra(), but the results are stored in the query,
+ * and the d_node structures of the graph are not touched.  Use
+ * d_query_cost(), d_query_back() and d_query_print_route() to get
+ * them.  The search strategy of the graph (see d_set_search())
+ * is used when a destination is given.
+ *
+ * @param query is the query context.
+ * @param orig is the origin node of paths.
+ * @param dest is the destination node, or NULL to calculate the
+ * minimum cost paths to all the nodes.
+ * @return the number of nodes settled (by both searches, in a
+ *         bidirectional one).
+ */
+int
+d_query_run(
+        struct d_query   *query,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags);
+
+/**
+ * Run the A* algorithm with a query context.
+ *
+ * Same as d_astar(), but the results are stored in the query,
+ * as d_query_run() does.
+ *
+ * @return the number of nodes settled.
+ */
+int
+d_query_astar(
+        struct d_query   *query,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int             (*heuristic)(
+                                struct d_node *,
+                                struct d_node *,
+                                void *),
+        void             *calldata,
+        int               flags);
+
+/**
+ * @return nonzero if the node was reached (its minimum cost is
+ *         known) in the last run of the query.
+ */
+int
+d_query_reached(
+        const struct d_query *query,
+        const struct d_node  *nod);
+
+/**
+ * @return the minimum cost to reach nod in the last run of the
+ *         query, or -1 if it was not reached.
+ */
+int64_t
+d_query_cost(
+        const struct d_query *query,
+        const struct d_node  *nod);
+
+/**
+ * @return the previous node in the minimum cost path to nod, or
+ *         NULL if nod is the origin or it was not reached.
+ */
+struct d_node *
+d_query_back(
+        const struct d_query *query,
+        const struct d_node  *nod);
+
+/**
+ * Print the route to nod found by the last run of the query.
+ *
+ * Same as d_print_route(), but with the results of a query.
+ *
+ * @return the number of characters written to the output
+ *         stream.
+ */
+ssize_t
+d_query_print_route(
+        FILE                 *file,
+        const struct d_query *query,
+        const struct d_node  *nod);
+
+/**
+ * Print the shortest path tree found by the last run of the query.
+ *
+ * Same as d_print_tree(), but with the results of a query.  The
+ * nodes are printed in id order.
+ *
+ * @return the number of bytes written to the output stream.
+ */
+ssize_t
+d_query_print_tree(
+        FILE                 *file,
+        const struct d_query *query,
+        int                   format);
+
 /**
  * Executes the callback function for each node.
  *
  * The callback function receives a reference to the involved
- * node, plus a per call unspecified pointer.
+ * node, plus a per call unspecified pointer.  Nodes are visited
+ * in name order.  As the index of nodes is not ordered, they are
+ * sorted on demand, the first time this function is called after
+ * nodes have been added to the graph.
  *
  * @param g is the graph to execute the callback on.
  * @param callback is the callback routine to call.
@@ -226,4 +828,27 @@ d_print_route(
         FILE             *file,
         struct d_node    *destination);
 
+/**
+ * Print the shortest path tree found by the last d_dijkstra().
+ *
+ * Printing the route to every node costs as much as the sum of
+ * the lengths of the routes, the tree is printed once, one line
+ * (or record) per reached node, with the node, its parent in the
+ * tree and its cost.  In D_TREE_TEXT format, the lines are the
+ * names of the node and of the parent ("-" for the origin) and the
+ * cost.  In D_TREE_BINARY format, a struct d_tree_header followed
+ * by the records of ids.  When the search ran on the frozen graph,
+ * the nodes are in the order they were settled, so a parent goes
+ * before its children.
+ *
+ * @param file is the output stream to print the tree to.
+ * @param format is D_TREE_TEXT or D_TREE_BINARY.
+ * @return the number of bytes written to the output stream.
+ */
+ssize_t
+d_print_tree(
+        FILE             *file,
+        struct d_graph   *graph,
+        int               format);
+
 #endif /* _DIJKSTRA_H */
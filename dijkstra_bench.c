@@ -0,0 +1,355 @@
+/* dijkstra_bench.c -- benchmark of the library on graph files.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Mon Oct 19 13:02:16 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * Times the phases of the life of a graph (loading, sorting,
+ * freezing, looking up nodes, single queries, searches to all
+ * the nodes and batches of queries) and writes, for each one, the
+ * median and 99th percentile of the times measured, the average
+ * of nodes settled and the peak resident memory so far, as CSV or
+ * JSON, to compare versions of the library.  The graphs can be
+ * run with several orders of the nodes (see d_set_order()), and
+ * each row has the mean distance between the ids of the ends of
+ * the links, to see how the order changes the cache misses (and
+ * so the times) of the searches.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "graph.h"
+#include "batch.h"
+#include "loader.h"
+#include "order.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+#define LOOKUP_BATCH        1000   /* lookups timed together */
+#define MAX_ORDERS          8
+
+/* a random node id.  It is drawn in name order, so the same seed
+ * gives the same nodes whatever the order of the ids */
+#define RANDOM_ID(_csr, _n) ((_csr)->by_name[rand() % (_n)])
+
+int queries = 100;
+int reps    = 3;
+int threads = 1;
+unsigned seed = 1;
+int json;
+int frontier = D_FRONTIER_DEFAULT;
+int rows;           /* rows already written, for json */
+int orders[MAX_ORDERS] = { D_ORDER_NONE };
+int orders_n = 1;
+int order;          /* order of the graph being run */
+double gap;         /* mean link gap of the graph being run */
+
+static struct frontier_name {
+    char   *name;
+    int     kind;
+} frontier_names[] = {
+    { "list",    D_FRONTIER_LIST },
+    { "binary",  D_FRONTIER_BINARY },
+    { "pairing", D_FRONTIER_PAIRING },
+    { "radix",   D_FRONTIER_RADIX },
+    { "dial",    D_FRONTIER_DIAL },
+    { "auto",    D_FRONTIER_AUTO },
+    { NULL,      0 },
+}, order_names[] = {
+    { "none",    D_ORDER_NONE },
+    { "bfs",     D_ORDER_BFS },
+    { "rcm",     D_ORDER_RCM },
+    { NULL,      0 },
+};
+
+static const char *
+order_name(int kind)
+{
+    struct frontier_name *p;
+    for (p = order_names; p->name; p++)
+        if (p->kind == kind)
+            return p->name;
+    return "?";
+} /* order_name */
+
+/* times (in microseconds) and nodes settled of a phase */
+struct samples {
+    double         *t;
+    long            settled;
+    int             n;
+    int             cap;
+};
+
+static double
+now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+} /* now */
+
+static void
+add(struct samples *s, double t0, double t1, long settled)
+{
+    if (s->n == s->cap) {
+        s->cap = s->cap ? 2 * s->cap : 64;
+        s->t = realloc(s->t, s->cap * sizeof *s->t);
+        if (!s->t) {
+            fprintf(stderr, F("%s\n"), strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    }
+    s->t[s->n++] = (t1 - t0) * 1e6;
+    s->settled += settled;
+} /* add */
+
+static int
+cmp_double(const void *a, const void *b)
+{
+    double A = *(const double *)a, B = *(const double *)b;
+    return (A > B) - (A < B);
+} /* cmp_double */
+
+/* writes the row of a phase, and empties the samples */
+static void
+report(const char *graph, const char *phase, struct samples *s)
+{
+    struct rusage ru;
+    double med = 0.0, p99 = 0.0;
+
+    if (s->n > 0) {
+        qsort(s->t, s->n, sizeof *s->t, cmp_double);
+        med = s->t[s->n / 2];
+        p99 = s->t[(s->n * 99) / 100 < s->n ? (s->n * 99) / 100 : s->n - 1];
+    }
+    getrusage(RUSAGE_SELF, &ru);
+    if (json)
+        printf("%s\n  { \"graph\": \"%s\", \"order\": \"%s\", "
+                "\"phase\": \"%s\", "
+                "\"samples\": %d, \"median_us\": %.3f, "
+                "\"p99_us\": %.3f, \"settled\": %.1f, "
+                "\"peak_rss_kb\": %ld, \"link_gap\": %.1f }",
+                rows ? "," : "[",
+                graph, order_name(order), phase, s->n, med, p99,
+                s->n ? (double)s->settled / s->n : 0.0,
+                ru.ru_maxrss, gap);
+    else
+        printf("%s,%s,%s,%d,%.3f,%.3f,%.1f,%ld,%.1f\n",
+                graph, order_name(order), phase, s->n, med, p99,
+                s->n ? (double)s->settled / s->n : 0.0,
+                ru.ru_maxrss, gap);
+    fflush(stdout);
+    rows++;
+    s->n = 0;
+    s->settled = 0;
+} /* report */
+
+static struct d_graph *
+load(const char *path, struct samples *ld, struct samples *so,
+        struct samples *fr)
+{
+    double t0 = now();
+    struct d_graph *g = d_new_graph((char *)path, 0);
+    d_set_frontier(g, frontier);
+    d_set_order(g, order);
+    d_begin_bulk(g);
+    long links = d_load_file(g, path, threads, 0);
+    if (links < 0) {
+        fprintf(stderr, F("LOAD: %s: %s\n"), path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    double t1 = now();
+    d_end_bulk(g, threads, 0);
+    double t2 = now();
+    d_freeze(g, 0);
+    double t3 = now();
+    add(ld, t0, t1, 0);
+    add(so, t1, t2, 0);
+    add(fr, t2, t3, 0);
+    return g;
+} /* load */
+
+static void
+bench(const char *path)
+{
+    struct samples s1 = { 0 }, s2 = { 0 }, s3 = { 0 };
+    struct d_graph *g = NULL;
+    int i, j;
+
+    gap = 0.0; /* not known until frozen */
+    for (i = 0; i < reps; ++i) {
+        if (g) d_free_graph(g);
+        g = load(path, &s1, &s2, &s3);
+    }
+    gap = d_order_gap(g->csr);
+    report(path, "load", &s1);
+    report(path, "sort", &s2);
+    report(path, "freeze", &s3);
+
+    const struct d_csr *csr = g->csr;
+    int n = csr->n;
+    if (n == 0) {
+        d_free_graph(g);
+        return;
+    }
+    srand(seed);
+
+    for (i = 0; i < queries; ++i) {
+        const char *names[LOOKUP_BATCH];
+        for (j = 0; j < LOOKUP_BATCH; ++j)
+            names[j] = d_csr_name(csr, RANDOM_ID(csr, n));
+        double t0 = now();
+        for (j = 0; j < LOOKUP_BATCH; ++j)
+            d_lookup_node(g, names[j], 0);
+        double t1 = now();
+        add(&s1, t0, t0 + (t1 - t0) / LOOKUP_BATCH, 0);
+    }
+    report(path, "lookup", &s1);
+
+    for (i = 0; i < queries; ++i) {
+        struct d_node *src = d_node_by_id(g, RANDOM_ID(csr, n)),
+                      *dst = d_node_by_id(g, RANDOM_ID(csr, n));
+        double t0 = now();
+        int settled = d_dijkstra(g, src, dst, 0);
+        add(&s1, t0, now(), settled);
+    }
+    report(path, "query", &s1);
+
+    for (i = 0; i < reps; ++i) {
+        struct d_node *src = d_node_by_id(g, RANDOM_ID(csr, n));
+        double t0 = now();
+        int settled = d_dijkstra(g, src, NULL, 0);
+        add(&s1, t0, now(), settled);
+    }
+    report(path, "all_nodes", &s1);
+
+    /* the batch, as text, in memory */
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    FILE *null = fopen("/dev/null", "w");
+    if (!out || !null) {
+        fprintf(stderr, F("%s\n"), strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < queries; ++i)
+        fprintf(out, "%s %s\n",
+                d_csr_name(csr, RANDOM_ID(csr, n)),
+                d_csr_name(csr, RANDOM_ID(csr, n)));
+    fclose(out);
+    for (i = 0; i < reps; ++i) {
+        FILE *in = fmemopen(text, len, "r");
+        struct d_batch_stats st;
+        double t0 = now();
+        if (!in || d_batch_run(g, in, null, threads, 0, 0, &st) < 0) {
+            fprintf(stderr, F("batch failed\n"));
+            exit(EXIT_FAILURE);
+        }
+        add(&s1, t0, now(), (long)st.settled);
+        fclose(in);
+    }
+    report(path, "batch", &s1);
+    fclose(null);
+    free(text);
+    free(s1.t);
+    free(s2.t);
+    free(s3.t);
+    d_free_graph(g);
+} /* bench */
+
+void do_help(char *prg, int code)
+{
+    fprintf(stderr,
+        "Usage: %s [ -hJ ] [ -f engine ] [ -j threads ] [ -o orders ]\n"
+        "       [ -q queries ] [ -r reps ] [ -s seed ] file ...\n"
+        "Times loading, sorting and querying each graph file, and\n"
+        "writes one line per phase: graph, order of the nodes, phase,\n"
+        "samples, median and 99th percentile times (in microseconds),\n"
+        "nodes settled, peak resident memory (in kilobytes) and mean\n"
+        "distance between the ids of the ends of the links.\n"
+        "Options:\n"
+        " -f engine selects the frontier engine, one of 'list',\n"
+        "    'binary', 'pairing', 'radix', 'dial' or 'auto'.\n"
+        "    Default is 'auto'.\n"
+        " -h help.  Shows this help screen.\n"
+        " -J writes JSON instead of CSV.\n"
+        " -j threads are the threads used to load and for batches.\n"
+        "    Default is 1.\n"
+        " -o orders is a comma separated list of orders of the\n"
+        "    nodes, each graph is run with each of them, of 'none',\n"
+        "    'bfs' or 'rcm' (see dijkstra -r).  Default is 'none'.\n"
+        " -q queries is the number of queries (and of batches of\n"
+        "    lookups) timed, and the size of the batches.\n"
+        "    Default is 100.\n"
+        " -r reps is the number of loads, searches to all nodes and\n"
+        "    batches timed.  Default is 3.\n"
+        " -s seed is the seed of the random queries.  Default is 1.\n",
+        prg);
+    exit(code);
+} /* do_help */
+
+int main(int argc, char **argv)
+{
+    int opt, i, j;
+
+    while ((opt = getopt(argc, argv, "f:hJj:o:q:r:s:")) >= 0) {
+        struct frontier_name *p;
+        char *q;
+        switch (opt) {
+        case 'f':
+            for (p = frontier_names; p->name; p++)
+                if (strcmp(p->name, optarg) == 0)
+                    break;
+            if (!p->name) {
+                fprintf(stderr,
+                        F("invalid frontier engine '%s'\n"),
+                        optarg);
+                do_help(argv[0], EXIT_FAILURE);
+            }
+            frontier = p->kind;
+            break;
+        case 'h': do_help(argv[0], EXIT_SUCCESS); break;
+        case 'J': json = 1; break;
+        case 'j': threads = atoi(optarg); break;
+        case 'o':
+            orders_n = 0;
+            for (q = strtok(optarg, ","); q; q = strtok(NULL, ",")) {
+                for (p = order_names; p->name; p++)
+                    if (strcmp(p->name, q) == 0)
+                        break;
+                if (!p->name || orders_n == MAX_ORDERS) {
+                    fprintf(stderr, F("invalid order '%s'\n"), q);
+                    do_help(argv[0], EXIT_FAILURE);
+                }
+                orders[orders_n++] = p->kind;
+            }
+            break;
+        case 'q': queries = atoi(optarg); break;
+        case 'r': reps = atoi(optarg); break;
+        case 's': seed = atoi(optarg); break;
+        default: do_help(argv[0], EXIT_FAILURE); break;
+        }
+    }
+    if (optind == argc || queries < 1 || reps < 1 || threads < 1
+            || orders_n < 1)
+        do_help(argv[0], EXIT_FAILURE);
+
+    if (!json)
+        puts("graph,order,phase,samples,median_us,p99_us,settled,"
+                "peak_rss_kb,link_gap");
+    for (i = optind; i < argc; ++i)
+        for (j = 0; j < orders_n; ++j) {
+            order = orders[j];
+            bench(argv[i]);
+        }
+    if (json)
+        puts(rows ? "\n]" : "[]");
+    exit(EXIT_SUCCESS);
+} /* main */
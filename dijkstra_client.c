@@ -0,0 +1,376 @@
+/* dijkstra_client.c -- client and load generator of the query
+ *                      server (dijkstra -L).
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Thu Oct 22 13:05:51 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * Sends the queries of a file to the server, pipelined up to a
+ * number of them in flight per connection, and prints the replies.
+ * In load mode, the queries are sent over several connections at
+ * once (a thread each), cycling over the file, and only the
+ * throughput and the latencies seen by the client are printed.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "server.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+#define STDIN_TOKEN     "-"
+#define SEP_STRING      ", \t\n"
+
+char *sock_path;
+int binary;         /* use the binary protocol */
+int mode = D_SRV_COST;
+char *graph = "0";  /* graph of the queries, index or path */
+int conns;          /* connections of load mode, 0 for client mode */
+long total;         /* queries of load mode, 0 for those of the file */
+int depth = 16;     /* queries in flight per connection */
+
+struct query {
+    char           *src;
+    char           *dst;
+};
+
+struct query *queries;
+long nqueries;
+
+/* the queries of a connection are first, first + step, ... (modulo
+ * nqueries), count of them */
+struct client {
+    pthread_t       th;
+    long            first;
+    long            step;
+    long            count;
+    int             print;     /* print the replies */
+    double         *lat;       /* latency of each query, in us */
+    long            unreached;
+    long            errors;    /* invalid requests, lost replies */
+};
+
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0E-9;
+} /* now */
+
+void do_help(char *prg, int code)
+{
+    fprintf(stderr,
+        "Usage: %s [ -bhR ] [ -c conns ] [ -g graph ] [ -n queries ]\n"
+        "       [ -p depth ] socket [ file ]\n"
+        "Sends the queries of file (source and destination nodes, one\n"
+        "pair per line, '-' or no file for standard input) to the\n"
+        "server listening on the unix socket (see dijkstra -L), and\n"
+        "prints the replies.\n"
+        "Options:\n"
+        " -b uses the binary protocol, with node ids instead of\n"
+        "    names in the file.\n"
+        " -c conns runs in load mode, sending the queries on the\n"
+        "    given number of connections at once, and printing the\n"
+        "    throughput and latencies instead of the replies.\n"
+        " -g graph is the index or the path of the graph of the\n"
+        "    queries in the server.  Default is 0.\n"
+        " -h help.  Shows this help screen.\n"
+        " -n queries is the number of queries sent in load mode,\n"
+        "    cycling over the file.  Default is those in the file.\n"
+        " -p depth is the number of queries in flight on each\n"
+        "    connection.  Default is 16.\n"
+        " -R asks for the route of each query.\n",
+        prg);
+    exit(code);
+} /* do_help */
+
+void read_queries(char *path)
+{
+    int is_stdin = strcmp(path, STDIN_TOKEN) == 0;
+    FILE *in = is_stdin ? stdin : fopen(path, "r");
+    if (!in) {
+        fprintf(stderr, F("FOPEN: %s: %s\n"), path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    long qcap = 0;
+    while (getline(&line, &cap, in) >= 0) {
+        char *save;
+        char *src = strtok_r(line, SEP_STRING, &save);
+        if (!src || src[0] == '#') continue;
+        char *dst = strtok_r(NULL, SEP_STRING, &save);
+        if (!dst) {
+            fprintf(stderr, F("WARNING: no destination node for "
+                    "'%s'.  Skipping this entry.\n"),
+                    src);
+            continue;
+        }
+        if (nqueries == qcap) {
+            qcap = qcap ? 2 * qcap : 1024;
+            queries = realloc(queries, qcap * sizeof *queries);
+            assert(queries != NULL);
+        }
+        queries[nqueries].src = strdup(src);
+        queries[nqueries].dst = strdup(dst);
+        assert(queries[nqueries].src && queries[nqueries].dst);
+        nqueries++;
+    }
+    free(line);
+    if (!is_stdin)
+        fclose(in);
+} /* read_queries */
+
+static int
+connect_to(const char *path)
+{
+    struct sockaddr_un sa = { .sun_family = AF_UNIX };
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0) return -1;
+    strncpy(sa.sun_path, path, sizeof sa.sun_path - 1);
+    if (connect(fd, (struct sockaddr *)&sa, sizeof sa) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+} /* connect_to */
+
+static int
+write_all(int fd, const char *buf, size_t n)
+{
+    while (n > 0) {
+        ssize_t r = write(fd, buf, n);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += r;
+        n   -= r;
+    }
+    return 0;
+} /* write_all */
+
+/* appends the request of query q to the stream f */
+static void
+put_request(FILE *f, const struct query *q)
+{
+    if (binary) {
+        uint32_t len = sizeof(struct d_srv_request);
+        struct d_srv_request r = {
+            .src   = strtoul(q->src, NULL, 10),
+            .dst   = strtoul(q->dst, NULL, 10),
+            .mode  = mode,
+            .graph = atoi(graph),
+        };
+        fwrite(&len, sizeof len, 1, f);
+        fwrite(&r, sizeof r, 1, f);
+    } else {
+        fprintf(f, "%s %s %s %s\n", q->src, q->dst,
+                mode == D_SRV_ROUTE ? "route" : "cost", graph);
+    }
+} /* put_request */
+
+/* reads the next reply, returns its cost, or D_SRV_INVALID if the
+ * reply is lost or an error */
+static long long
+get_reply(FILE *in, struct client *c, char **line, size_t *cap)
+{
+    if (!binary) {
+        long long cost;
+        if (getline(line, cap, in) < 0)
+            return D_SRV_INVALID;
+        if (c->print)
+            fputs(*line, stdout);
+        if (sscanf(*line, "%*s %*s %lld", &cost) != 1)
+            return D_SRV_INVALID;
+        return cost;
+    }
+
+    uint32_t len, i;
+    struct d_srv_reply r;
+    if (fread(&len, sizeof len, 1, in) != 1 || len < sizeof r
+            || fread(&r, sizeof r, 1, in) != 1)
+        return D_SRV_INVALID;
+    len -= sizeof r;
+    if (len > *cap) {
+        *line = realloc(*line, len);
+        assert(*line != NULL);
+        *cap = len;
+    }
+    if (len > 0 && fread(*line, len, 1, in) != 1)
+        return D_SRV_INVALID;
+    if (c->print) {
+        const uint32_t *ids = (const uint32_t *)*line;
+        printf("%lld %u", (long long)r.cost, r.usec);
+        for (i = 0; i < r.nodes && i < len / sizeof *ids; ++i)
+            printf(" %u", ids[i]);
+        putchar('\n');
+    }
+    return r.cost;
+} /* get_reply */
+
+static void *
+run_client(void *arg)
+{
+    struct client *c = arg;
+    int fd = connect_to(sock_path);
+    if (fd < 0) {
+        fprintf(stderr, F("CONNECT: %s: %s\n"),
+                sock_path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    FILE *in = fdopen(fd, "r");
+    assert(in != NULL);
+    if (binary && write_all(fd, D_SRV_MAGIC, D_SRV_MAGIC_LEN) < 0) {
+        c->errors = c->count;
+        fclose(in);
+        return NULL;
+    }
+
+    /* send times of the queries in flight */
+    double *sent_at = malloc(depth * sizeof *sent_at);
+    char *buf = NULL, *line = NULL;
+    size_t buf_n, cap = 0;
+    long sent = 0, recvd = 0, k = c->first;
+    assert(sent_at != NULL);
+
+    while (recvd < c->count) {
+        if (sent < c->count && sent - recvd < depth) {
+            FILE *f = open_memstream(&buf, &buf_n);
+            assert(f != NULL);
+            double t = now();
+            for (; sent < c->count && sent - recvd < depth; ++sent) {
+                put_request(f, &queries[k]);
+                sent_at[sent % depth] = t;
+                k = (k + c->step) % nqueries;
+            }
+            fclose(f);
+            int r = write_all(fd, buf, buf_n);
+            free(buf);
+            if (r < 0) break;
+        }
+        long long cost = get_reply(in, c, &line, &cap);
+        c->lat[recvd] = (now() - sent_at[recvd % depth]) * 1.0E6;
+        if (cost == D_SRV_INVALID) c->errors++;
+        else if (cost < 0) c->unreached++;
+        recvd++;
+        if (cost == D_SRV_INVALID && feof(in)) break;
+    }
+    c->errors += c->count - recvd; /* lost with the connection */
+    c->count = recvd;
+    free(line);
+    free(sent_at);
+    fclose(in);
+    return NULL;
+} /* run_client */
+
+static int
+cmp_double(const void *a, const void *b)
+{
+    double A = *(const double *)a, B = *(const double *)b;
+    return (A > B) - (A < B);
+} /* cmp_double */
+
+/* the permil per thousand percentile of the n sorted latencies of
+ * lat, by nearest rank */
+static double
+percentile(const double *lat, long n, int permil)
+{
+    long k = (permil * n + 999) / 1000 - 1;
+    return lat[k < 0 ? 0 : k >= n ? n - 1 : k];
+} /* percentile */
+
+int main(int argc, char **argv)
+{
+    int opt, i;
+
+    while ((opt = getopt(argc, argv, "bc:g:hn:p:R")) >= 0) {
+        switch (opt) {
+        case 'b': binary = 1; break;
+        case 'c': conns = atoi(optarg); break;
+        case 'g': graph = optarg; break;
+        case 'h': do_help(argv[0], EXIT_SUCCESS); break;
+        case 'n': total = atol(optarg); break;
+        case 'p': depth = atoi(optarg); break;
+        case 'R': mode = D_SRV_ROUTE; break;
+        default: do_help(argv[0], EXIT_FAILURE); break;
+        }
+    }
+    if (argc - optind < 1 || argc - optind > 2 || conns < 0
+            || depth < 1 || total < 0)
+        do_help(argv[0], EXIT_FAILURE);
+    sock_path = argv[optind];
+    read_queries(optind + 1 < argc ? argv[optind + 1] : STDIN_TOKEN);
+    if (nqueries == 0)
+        exit(EXIT_SUCCESS);
+
+    int n = conns > 0 ? conns : 1;
+    if (total == 0) total = nqueries;
+    double *lat = malloc(total * sizeof *lat);
+    struct client *c = calloc(n, sizeof *c);
+    assert(lat != NULL && c != NULL);
+
+    long off = 0;
+    for (i = 0; i < n; ++i) {
+        c[i].first = i % nqueries;
+        c[i].step  = n;
+        c[i].count = total / n + (i < total % n);
+        c[i].print = conns == 0;
+        c[i].lat   = lat + off;
+        off += c[i].count;
+    }
+    double t0 = now();
+    for (i = 0; i < n; ++i)
+        if (pthread_create(&c[i].th, NULL, run_client, &c[i])) {
+            fprintf(stderr, F("cannot create client thread\n"));
+            exit(EXIT_FAILURE);
+        }
+
+    long done = 0, unreached = 0, errors = 0;
+    for (i = 0; i < n; ++i) {
+        pthread_join(c[i].th, NULL);
+        /* the latencies go together, for the percentiles */
+        memmove(lat + done, c[i].lat, c[i].count * sizeof *lat);
+        done      += c[i].count;
+        unreached += c[i].unreached;
+        errors    += c[i].errors;
+    }
+    double elapsed = now() - t0;
+
+    if (conns > 0 && done > 0) {
+        double sum = 0.0;
+        long k;
+        for (k = 0; k < done; ++k) sum += lat[k];
+        qsort(lat, done, sizeof *lat, cmp_double);
+        printf("%ld queries (%ld unreached, %ld errors) in %.3fs on "
+                "%d connections, %.0f queries/s\n"
+                "latency(us): avg=%.3f p50=%.3f p90=%.3f p99=%.3f "
+                "p99.9=%.3f max=%.3f\n",
+                done, unreached, errors, elapsed, conns,
+                elapsed > 0.0 ? done / elapsed : 0.0,
+                sum / done,
+                percentile(lat, done, 500),
+                percentile(lat, done, 900),
+                percentile(lat, done, 990),
+                percentile(lat, done, 999),
+                lat[done - 1]);
+    }
+    free(lat);
+    free(c);
+    exit(errors ? EXIT_FAILURE : EXIT_SUCCESS);
+} /* main */
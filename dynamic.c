@@ -0,0 +1,269 @@
+/* dynamic.c -- minimum cost paths kept up to date while the
+ *              weights of the links change.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sun Oct 18 12:40:18 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * The tree lives in a query, settled in its current epoch, that
+ * is never started again (unless the graph changes its layout),
+ * so the repairs only touch the nodes affected.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "graph.h"
+#include "dynamic.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+struct change {
+    int             from;
+    int             to;
+    int             weight;
+};
+
+struct d_dyn {
+    struct d_graph  *graph;
+    struct d_csr    *csr;      /* layout the tree was computed on */
+    struct d_query  *q;
+    int              orig;
+    struct change   *pend;     /* changes queued */
+    int              pend_n;
+    int              pend_cap;
+    int             *aff;      /* nodes affected by the changes */
+    int              n;        /* size of aff and mark */
+    uint32_t        *mark;     /* mark[v] == ep if v is in aff */
+    uint32_t         ep;
+};
+
+static void
+fit(struct d_dyn *dyn)
+{
+    struct d_graph *g = dyn->graph;
+    struct d_csr *csr = g->csr;
+
+    if (!__atomic_load_n(&csr->r_off, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&g->mtx);
+        d_csr_build_reverse(csr);
+        pthread_mutex_unlock(&g->mtx);
+    }
+    dyn->csr = csr;
+    if (dyn->mark && dyn->n == (int)csr->n)
+        return;
+    dyn->n    = csr->n;
+    dyn->aff  = realloc(dyn->aff,
+            (dyn->n ? dyn->n : 1) * sizeof *dyn->aff);
+    free(dyn->mark);
+    dyn->mark = calloc(dyn->n ? dyn->n : 1, sizeof *dyn->mark);
+    assert(dyn->aff && dyn->mark);
+    dyn->ep   = 0;
+} /* fit */
+
+struct d_dyn *
+d_dyn_new(
+        struct d_graph   *graph,
+        struct d_node    *orig,
+        int               flags)
+{
+    if (graph->ro) {
+        errno = EROFS;
+        return NULL;
+    }
+    d_freeze(graph, flags);
+
+    struct d_dyn *res = calloc(1, sizeof *res);
+    assert(res != NULL);
+    res->graph = graph;
+    res->orig  = orig->id;
+    res->q     = d_query_new(graph, flags);
+    fit(res);
+    d_query_forward(res->q, orig, NULL, flags);
+    return res;
+} /* d_dyn_new */
+
+void
+d_dyn_free(
+        struct d_dyn     *dyn)
+{
+    if (!dyn) return;
+    d_query_free(dyn->q);
+    free(dyn->pend);
+    free(dyn->aff);
+    free(dyn->mark);
+    free(dyn);
+} /* d_dyn_free */
+
+int
+d_dyn_set_weight(
+        struct d_dyn     *dyn,
+        struct d_node    *from,
+        struct d_node    *to,
+        int               weight)
+{
+    if (weight < 0) return -1;
+
+    struct d_link *l, *end = from->next + from->next_n;
+    for (l = from->next; l < end && l->to != to; ++l)
+        continue;
+    if (l == end) return -1;
+
+    if (dyn->pend_n == dyn->pend_cap) {
+        dyn->pend_cap = dyn->pend_cap ? 2 * dyn->pend_cap : 64;
+        dyn->pend = realloc(dyn->pend, dyn->pend_cap * sizeof *dyn->pend);
+        assert(dyn->pend != NULL);
+    }
+    struct change *c = &dyn->pend[dyn->pend_n++];
+    c->from   = from->id;
+    c->to     = to->id;
+    c->weight = weight;
+    return 0;
+} /* d_dyn_set_weight */
+
+/* weight of the link from u to v */
+static int
+weight(const struct d_csr *csr, int u, int v)
+{
+    uint32_t e;
+    for (e = csr->off[u]; e < csr->off[u + 1]; ++e)
+        if ((int)csr->tgt[e] == v)
+            return csr->wgt[e];
+    return -1;
+} /* weight */
+
+/* adds v and all the nodes under it in the tree to the affected
+ * ones, and returns the new number of them */
+static int
+add_subtree(struct d_dyn *dyn, int v, int n)
+{
+    const struct d_csr *csr = dyn->csr;
+    struct d_query *q = dyn->q;
+    int i = n;
+
+    if (dyn->mark[v] == dyn->ep) return n;
+    dyn->mark[v] = dyn->ep;
+    dyn->aff[n++] = v;
+    /* aff works as the queue of a breadth first traversal */
+    for (; i < n; ++i) {
+        int x = dyn->aff[i];
+        uint32_t e;
+        for (e = csr->off[x]; e < csr->off[x + 1]; ++e) {
+            int y = csr->tgt[e];
+            if (Q_SETTLED(q, y) && q->back[y] == x
+                    && dyn->mark[y] != dyn->ep) {
+                dyn->mark[y] = dyn->ep;
+                dyn->aff[n++] = y;
+            }
+        }
+    }
+    return n;
+} /* add_subtree */
+
+/* offers cost c, through u, to node v.  Costs are checked ints,
+ * as in d_query_forward(), so a c that doesn't fit is dropped. */
+static void
+offer(struct d_query *q, int u, int v, long long c)
+{
+    if (c > INT_MAX || (Q_SEEN(q, v) && c >= q->cost[v]))
+        return;
+    q->cost[v]  = c;
+    q->back[v]  = u;
+    q->stamp[v] = q->epoch;
+    d_heap_push(q->heap, v, c);
+} /* offer */
+
+int
+d_dyn_update(
+        struct d_dyn     *dyn,
+        int               flags)
+{
+    struct d_graph *g = dyn->graph;
+    struct d_query *q = dyn->q;
+    int i, n_aff = 0, res = 0;
+
+    if (g->csr != dyn->csr) {
+        /* the layout has been rebuilt, the tree is no longer valid */
+        d_freeze(g, flags);
+        for (i = 0; i < dyn->pend_n; ++i)
+            d_reweight_link(g, dyn->pend[i].from, dyn->pend[i].to,
+                    dyn->pend[i].weight, flags);
+        dyn->pend_n = 0;
+        fit(dyn);
+        res = d_query_forward(q, d_node_by_id(g, dyn->orig), NULL,
+                flags);
+        if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END))
+            printf(F("Graph %s changed, full search (%d nodes)\n"),
+                    g->name, res);
+        return res;
+    }
+
+    const struct d_csr *csr = dyn->csr;
+    uint32_t ep = q->epoch;
+
+    for (i = 0; i < dyn->pend_n; ++i)
+        d_reweight_link(g, dyn->pend[i].from, dyn->pend[i].to,
+                dyn->pend[i].weight, flags);
+
+    if (++dyn->ep == 0) {
+        memset(dyn->mark, 0, csr->n * sizeof *dyn->mark);
+        dyn->ep = 1;
+    }
+
+    /* links of the tree that got heavier: the nodes under them
+     * may get a better path by other way */
+    for (i = 0; i < dyn->pend_n; ++i) {
+        int u = dyn->pend[i].from, v = dyn->pend[i].to;
+        if (Q_SETTLED(q, u) && Q_SETTLED(q, v) && q->back[v] == u
+                && (long long)q->cost[u] + weight(csr, u, v) > q->cost[v])
+            n_aff = add_subtree(dyn, v, n_aff);
+    }
+    for (i = 0; i < n_aff; ++i)
+        q->stamp[dyn->aff[i]] = 0; /* not reached */
+
+    d_heap_clear(q->heap);
+    for (i = 0; i < n_aff; ++i) {
+        int x = dyn->aff[i];
+        uint32_t e;
+        for (e = csr->r_off[x]; e < csr->r_off[x + 1]; ++e) {
+            int p = csr->r_src[e];
+            if (Q_SETTLED(q, p))
+                offer(q, p, x, (long long)q->cost[p] + csr->r_wgt[e]);
+        }
+    }
+
+    /* links that got lighter */
+    for (i = 0; i < dyn->pend_n; ++i) {
+        int u = dyn->pend[i].from, v = dyn->pend[i].to;
+        if (Q_SETTLED(q, u))
+            offer(q, u, v, (long long)q->cost[u] + weight(csr, u, v));
+    }
+    dyn->pend_n = 0;
+
+    /* propagate the new costs, in order */
+    int u;
+    while ((u = d_heap_pop(q->heap, NULL)) >= 0) {
+        q->stamp[u] = ep + 1;
+        res++;
+        uint32_t e, end = csr->off[u + 1];
+        for (e = csr->off[u]; e < end; ++e)
+            offer(q, u, csr->tgt[e], (long long)q->cost[u] + csr->wgt[e]);
+    }
+    if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END))
+        printf(F("Graph %s updated, %d nodes affected, "
+                "%d nodes settled again\n"),
+                g->name, n_aff, res);
+    return res;
+} /* d_dyn_update */
+
+const struct d_query *
+d_dyn_query(
+        const struct d_dyn *dyn)
+{
+    return dyn->q;
+} /* d_dyn_query */
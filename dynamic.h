@@ -0,0 +1,100 @@
+/* dynamic.h -- minimum cost paths kept up to date while the
+ *              weights of the links change.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sun Oct 18 12:40:18 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _DYNAMIC_H
+#define _DYNAMIC_H
+
+#include "dijkstra.h"
+
+struct d_dyn;                  /* opaque */
+
+/**
+ * Create a dynamic tree of minimum cost paths from a node.
+ *
+ * The graph is frozen (see d_freeze()) and a full search from
+ * orig to all the nodes is run.  Then, the weights of the links
+ * can be changed with d_dyn_set_weight() and d_dyn_update(),
+ * that only repairs the part of the tree affected by the changes.
+ * Costs are checked ints (see D_COSTS_CHECKED), so the paths
+ * costing more than INT_MAX are dropped.
+ *
+ * @param graph is the graph, that cannot be a read only one
+ *        (opened from a snapshot).
+ * @param orig is the origin of the paths.
+ * @return the dynamic tree.
+ */
+struct d_dyn *
+d_dyn_new(
+        struct d_graph   *graph,
+        struct d_node    *orig,
+        int               flags);
+
+/**
+ * Free a dynamic tree.  The graph is not freed.
+ */
+void
+d_dyn_free(
+        struct d_dyn     *dyn);
+
+/**
+ * Queue a change of the weight of a link.
+ *
+ * The change is applied to the graph (and the tree repaired) by
+ * the next call to d_dyn_update(), with the rest of the changes
+ * queued, so a batch of changes repairs the tree once.  If the
+ * same link is changed several times, the last weight stays.
+ *
+ * @param from is the origin of the link.
+ * @param to is the target of the link.
+ * @param weight is the new weight, not negative.
+ * @return 0 on success, -1 if there's no link from from to to,
+ *         or the weight is negative.
+ */
+int
+d_dyn_set_weight(
+        struct d_dyn     *dyn,
+        struct d_node    *from,
+        struct d_node    *to,
+        int               weight);
+
+/**
+ * Apply the changes queued and repair the tree.
+ *
+ * The weights of the graph are changed in place, in the frozen
+ * layout and in the links of the nodes (the contraction
+ * hierarchy of the graph, if any, is dropped, and the landmark
+ * heuristics of alt.h must be computed again).  Then the tree is
+ * repaired as Ramalingam and Reps do: the nodes under a link of
+ * the tree that got heavier lose their cost, and get again the
+ * best one offered by the links arriving from the rest of the
+ * nodes, and a search, ordered by cost, is run from them and from
+ * the targets of the links that got lighter, that stops where
+ * costs don't improve.
+ *
+ * If the graph has been modified in other way (nodes or links
+ * added, which drops the frozen layout), a full search is run
+ * instead.  No query can run on the graph during the update.
+ *
+ * @return the number of nodes whose cost has been computed again.
+ */
+int
+d_dyn_update(
+        struct d_dyn     *dyn,
+        int               flags);
+
+/**
+ * @return the query holding the tree, to read it with
+ *         d_query_cost(), d_query_back() and
+ *         d_query_print_route().  Running other searches with it
+ *         is not allowed.
+ */
+const struct d_query *
+d_dyn_query(
+        const struct d_dyn *dyn);
+
+#endif /* _DYNAMIC_H */
@@ -0,0 +1,186 @@
+/* forward.h -- template of the one directional search of query.c
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Tue Oct 20 09:47:12 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * This file has no include guard.  It is included by query.c once
+ * per variant of the search, with these macros defined, and
+ * undefines them at the end:
+ *
+ * FW_NAME     name of the (static) function generated.
+ * FW_TRACE    1 to print the debug traces selected by the flags,
+ *             0 to compile them out.
+ * FW_DEST     1 to stop when the destination is settled, 0 to
+ *             search all the nodes (dest is ignored).
+ * FW_CHECKED  1 to drop the paths whose cost doesn't fit in an int
+ *             (see d_set_costs()), 0 to use plain int sums.
+ * FW_WIDE     1 to sum the costs in 64 bits, in q->wcost (the
+ *             weights are still ints), 0 to use q->cost.
+ *
+ * so each variant is a loop without tests for the features it
+ * doesn't have.  Called with no orig, the search left in the query
+ * (settled nodes and frontier) goes on, see d_query_forward().
+ */
+
+#if FW_WIDE
+#define FW_COST             int64_t
+#define FW_SUM(_c, _w)      ((_c) + (_w))
+#define FW_FITS(_s)         1
+#elif FW_CHECKED
+/* sum of a cost and a weight, as wide as needed to check it */
+#define FW_COST             int
+#define FW_SUM(_c, _w)      ((long long)(_c) + (_w))
+#define FW_FITS(_s)         ((_s) <= INT_MAX)
+#else
+#define FW_COST             int
+#define FW_SUM(_c, _w)      ((_c) + (_w))
+#define FW_FITS(_s)         1
+#endif
+
+static int
+FW_NAME(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+    const struct d_csr *csr   = q->graph->csr;
+    int                 s0    = orig ? 0 : q->settled;
+
+    /* with no orig, go on with the search left in q */
+    if (orig)
+        d_query_start(q);
+
+    const uint32_t     *off   = csr->off;
+    const uint32_t     *tgt   = csr->tgt;
+    const int32_t      *wgt   = csr->wgt;
+#if FW_WIDE
+    int64_t            *cost  = q->wcost;
+#else
+    int                *cost  = q->cost;
+#endif
+    int                *back  = q->back;
+    uint32_t           *stamp = q->stamp;
+    uint32_t            ep    = q->epoch;
+    struct d_stats     *st    = &q->stats;
+#if FW_DEST
+    int                 d     = dest->id;
+#else
+    (void)dest;
+#endif
+#if !FW_TRACE
+    (void)flags;
+#endif
+
+    if (orig) {
+#if FW_TRACE
+        if (flags & (D_FLAG_DEBUG | D_FLAG_ADD_NODE_FRONTIER))
+            printf(F("Add start node %s to the frontier\n"),
+                    orig->name);
+#endif
+        q->orig         = orig->id;
+        q->wide         = FW_WIDE;
+        cost[orig->id]  = 0;
+        back[orig->id]  = -1;
+        stamp[orig->id] = ep;
+        d_heap_push(q->heap, orig->id, 0);
+    }
+
+    int u;
+    while ((u = d_heap_pop(q->heap, NULL)) >= 0) {
+        stamp[u] = ep + 1;
+        q->order[q->settled++] = u;
+#if FW_TRACE
+        if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_START))
+            printf(F("Pass #%d START, node %s(c=%lld) "
+                    "(%d nodes in the frontier)\n"),
+                    q->settled, d_csr_name(csr, u), (long long)cost[u],
+                    d_heap_size(q->heap));
+#endif
+#if FW_DEST
+        if (u == d) break;
+#endif
+
+        uint32_t e, end = off[u + 1];
+        FW_COST cu = cost[u];
+        STAT(st->scanned += end - off[u]);
+#if !FW_WIDE
+        /* the kernel sums in int, so with checked costs it is only
+         * used if the heaviest link of u cannot overflow (and it is
+         * not used with 64 bit costs) */
+        if (end - off[u] >= D_RELAX_MIN
+                && FW_FITS(FW_SUM(cu, wgt[end - 1]))) {
+            /* select the links that improve with the kernel, and
+             * then update their targets */
+            int sel[D_RELAX_CHUNK];
+            for (e = off[u]; e < end; e += D_RELAX_CHUNK) {
+                int i, n = end - e < D_RELAX_CHUNK
+                    ? end - e
+                    : D_RELAX_CHUNK;
+                int hits;
+                /* d_relax changes on the first call, maybe from
+                 * other thread */
+                int m = __atomic_load_n(&d_relax, __ATOMIC_RELAXED)(
+                        tgt + e, wgt + e, n, cu, cost, stamp,
+                        ep, sel, &hits);
+                STAT(st->visited += hits);
+                for (i = 0; i < m; ++i) {
+                    uint32_t v = tgt[e + sel[i]];
+                    int new_cost = cu + wgt[e + sel[i]];
+                    /* other link may have reached v already */
+                    if (stamp[v] != ep)
+                        stamp[v] = ep;
+                    else if (new_cost >= cost[v])
+                        continue;
+                    cost[v] = new_cost;
+                    back[v] = u;
+                    d_heap_push(q->heap, v, new_cost);
+                    STAT(st->improved++);
+                }
+            }
+        } else
+#endif
+        {
+            for (e = off[u]; e < end; ++e) {
+                uint32_t v = tgt[e];
+                if (stamp[v] == ep + 1) {
+                    STAT(st->visited++);
+                    continue; /* already settled */
+                }
+                if (!FW_FITS(FW_SUM(cu, wgt[e]))) {
+                    STAT(st->overflows++);
+                    continue;
+                }
+                FW_COST new_cost = cu + wgt[e];
+                if (stamp[v] != ep)
+                    stamp[v] = ep;
+                else if (new_cost >= cost[v])
+                    continue;
+                cost[v] = new_cost;
+                back[v] = u;
+                d_heap_push(q->heap, v, new_cost);
+                STAT(st->improved++);
+            }
+        }
+        STAT(d_stats_frontier(st, d_heap_size(q->heap)));
+    }
+#if FW_TRACE
+    if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END)) {
+        printf(F("Pass #%d END (%d nodes in the frontier)\n"),
+                q->settled, d_heap_size(q->heap));
+    }
+#endif
+    STAT(st->passes += q->settled - s0);
+    STAT(st->settled += q->settled - s0);
+    return q->settled - s0;
+} /* FW_NAME */
+
+#undef FW_COST
+#undef FW_SUM
+#undef FW_FITS
+#undef FW_NAME
+#undef FW_TRACE
+#undef FW_DEST
+#undef FW_CHECKED
+#undef FW_WIDE
@@ -0,0 +1,296 @@
+/* gen_graph.c -- generator of synthetic graphs, to benchmark the
+ * library.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Mon Oct 19 13:02:16 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * Graphs are written as 'from to weight' lines, the format the
+ * dijkstra program reads.  The random numbers come from a
+ * generator of our own, so a kind, size and seed give the same
+ * graph on any platform.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+char *kind   = "grid";
+long  nodes  = 10000;
+int   degree = 8;     /* average degree, random kinds */
+int   max_w  = 100;   /* max weight */
+uint64_t seed = 1;
+
+static uint64_t rng_state;
+
+/* xorshift64* */
+static uint64_t
+rnd(void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+} /* rnd */
+
+/* uniform in [0, n) */
+static long
+rnd_n(long n)
+{
+    return (long)((rnd() >> 11) % (uint64_t)n);
+} /* rnd_n */
+
+/* uniform in [0, 1) */
+static double
+rnd_d(void)
+{
+    return (rnd() >> 11) * (1.0 / 9007199254740992.0);
+} /* rnd_d */
+
+static void
+link2(const char *p, long a, long b, int w)
+{
+    printf("%s%ld %s%ld %d\n", p, a, p, b, w);
+    printf("%s%ld %s%ld %d\n", p, b, p, a, w);
+} /* link2 */
+
+/* square grid, links to the four neighbours in both directions */
+static void
+gen_grid(void)
+{
+    long side = (long)ceil(sqrt((double)nodes)), r, c;
+
+    for (r = 0; r < side; ++r) {
+        for (c = 0; c < side; ++c) {
+            long id = r * side + c;
+            if (c + 1 < side)
+                link2("g", id, id + 1, 1 + rnd_n(max_w));
+            if (r + 1 < side)
+                link2("g", id, id + side, 1 + rnd_n(max_w));
+        }
+    }
+} /* gen_grid */
+
+struct point {
+    double          x, y;
+};
+
+/* cell grid to find the points near another */
+struct cells {
+    long            side;
+    long           *head;      /* first point of each cell, or -1 */
+    long           *next;      /* next point in the same cell */
+};
+
+static void
+cells_build(struct cells *c, const struct point *p, long n, double r)
+{
+    long i;
+
+    c->side = (long)(1.0 / r);
+    if (c->side < 1) c->side = 1;
+    if (c->side > 4096) c->side = 4096;
+    c->head = malloc(c->side * c->side * sizeof *c->head);
+    c->next = malloc(n * sizeof *c->next);
+    if (!c->head || !c->next) {
+        fprintf(stderr, F("out of memory\n"));
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < c->side * c->side; ++i)
+        c->head[i] = -1;
+    for (i = 0; i < n; ++i) {
+        long cx = (long)(p[i].x * c->side), cy = (long)(p[i].y * c->side);
+        long k = cy * c->side + cx;
+        c->next[i] = c->head[k];
+        c->head[k] = i;
+    }
+} /* cells_build */
+
+/* random geometric: points in the unit square, linked (both ways)
+ * to the ones closer than a radius that gives the degree asked,
+ * with weights proportional to the distance */
+static void
+gen_geo(void)
+{
+    struct point *p = malloc(nodes * sizeof *p);
+    struct cells c;
+    double r = sqrt(degree / (M_PI * nodes));
+    long i;
+
+    if (!p) {
+        fprintf(stderr, F("out of memory\n"));
+        exit(EXIT_FAILURE);
+    }
+    for (i = 0; i < nodes; ++i) {
+        p[i].x = rnd_d();
+        p[i].y = rnd_d();
+    }
+    cells_build(&c, p, nodes, r);
+    for (i = 0; i < nodes; ++i) {
+        long cx = (long)(p[i].x * c.side), cy = (long)(p[i].y * c.side);
+        long x, y, j;
+        for (y = cy - 1; y <= cy + 1; ++y) {
+            for (x = cx - 1; x <= cx + 1; ++x) {
+                if (x < 0 || y < 0 || x >= c.side || y >= c.side)
+                    continue;
+                for (j = c.head[y * c.side + x]; j >= 0; j = c.next[j]) {
+                    if (j <= i) continue; /* each pair once */
+                    double dx = p[i].x - p[j].x, dy = p[i].y - p[j].y;
+                    double d = sqrt(dx * dx + dy * dy);
+                    if (d < r)
+                        link2("p", i, j, 1 + (int)(d / r * (max_w - 1)));
+                }
+            }
+        }
+    }
+    free(c.head);
+    free(c.next);
+    free(p);
+} /* gen_geo */
+
+/* R-MAT power law: each link falls in one quadrant of the
+ * adjacency matrix, recursively, with probabilities a, b, c, d */
+static void
+gen_rmat(void)
+{
+    const double a = 0.57, b = 0.19, c = 0.19;
+    long n = 1, m = nodes * degree, i;
+    int bits = 0;
+
+    while (n < nodes) {
+        n <<= 1;
+        bits++;
+    }
+    for (i = 0; i < m; ++i) {
+        long from = 0, to = 0;
+        int k;
+        for (k = 0; k < bits; ++k) {
+            double x = rnd_d();
+            from <<= 1;
+            to <<= 1;
+            if (x < a) {
+                /* top left */
+            } else if (x < a + b) {
+                to |= 1;
+            } else if (x < a + b + c) {
+                from |= 1;
+            } else {
+                from |= 1;
+                to |= 1;
+            }
+        }
+        /* nodes past the size asked fold back */
+        from %= nodes;
+        to %= nodes;
+        if (from != to)
+            printf("r%ld r%ld %ld\n", from, to, 1 + rnd_n(max_w));
+    }
+} /* gen_rmat */
+
+/* road like: a grid of jittered crossings, where some streets are
+ * missing, the rest go both ways with weights by length, and every
+ * eighth row and column is a faster highway */
+static void
+gen_road(void)
+{
+    long side = (long)ceil(sqrt((double)nodes)), r, c;
+    struct point *p = malloc(side * side * sizeof *p);
+
+    if (!p) {
+        fprintf(stderr, F("out of memory\n"));
+        exit(EXIT_FAILURE);
+    }
+    for (r = 0; r < side; ++r)
+        for (c = 0; c < side; ++c) {
+            p[r * side + c].x = c + 0.8 * (rnd_d() - 0.5);
+            p[r * side + c].y = r + 0.8 * (rnd_d() - 0.5);
+        }
+    for (r = 0; r < side; ++r) {
+        for (c = 0; c < side; ++c) {
+            long id = r * side + c, nb[2] = { -1, -1 };
+            int k;
+            if (c + 1 < side) nb[0] = id + 1;
+            if (r + 1 < side) nb[1] = id + side;
+            for (k = 0; k < 2; ++k) {
+                if (nb[k] < 0) continue;
+                int highway = k == 0 ? r % 8 == 0 : c % 8 == 0;
+                if (!highway && rnd_n(100) < 15)
+                    continue; /* missing street */
+                double dx = p[id].x - p[nb[k]].x,
+                       dy = p[id].y - p[nb[k]].y;
+                double len = sqrt(dx * dx + dy * dy) * max_w / 2;
+                link2("x", id, nb[k],
+                        1 + (int)(highway ? len / 3 : len));
+            }
+        }
+    }
+    free(p);
+} /* gen_road */
+
+static struct generator {
+    char   *name;
+    void  (*gen)(void);
+} generators[] = {
+    { "grid", gen_grid },
+    { "geo",  gen_geo },
+    { "rmat", gen_rmat },
+    { "road", gen_road },
+    { NULL,   NULL },
+};
+
+void do_help(char *prg, int code)
+{
+    fprintf(stderr,
+        "Usage: %s [ -h ] [ -t kind ] [ -n nodes ] [ -d degree ]\n"
+        "       [ -w weight ] [ -s seed ]\n"
+        "Writes a synthetic graph to standard output.\n"
+        "Options:\n"
+        " -d degree is the average degree of 'geo' and 'rmat' graphs.\n"
+        "    Default is 8.\n"
+        " -h help.  Shows this help screen.\n"
+        " -n nodes is the number of nodes (rounded up to a square\n"
+        "    for 'grid' and 'road').  Default is 10000.\n"
+        " -s seed is the seed of the random numbers.  Default is 1.\n"
+        " -t kind is one of 'grid', 'geo' (random geometric), 'rmat'\n"
+        "    (power law) or 'road' (road like).  Default is 'grid'.\n"
+        " -w weight is the maximum weight of links.  Default is 100.\n",
+        prg);
+    exit(code);
+} /* do_help */
+
+int main(int argc, char **argv)
+{
+    struct generator *g;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:hn:s:t:w:")) >= 0) {
+        switch (opt) {
+        case 'd': degree = atoi(optarg); break;
+        case 'h': do_help(argv[0], EXIT_SUCCESS); break;
+        case 'n': nodes = atol(optarg); break;
+        case 's': seed = strtoull(optarg, NULL, 0); break;
+        case 't': kind = optarg; break;
+        case 'w': max_w = atoi(optarg); break;
+        default: do_help(argv[0], EXIT_FAILURE); break;
+        }
+    }
+    if (nodes < 2 || degree < 1 || max_w < 1)
+        do_help(argv[0], EXIT_FAILURE);
+    for (g = generators; g->name; ++g)
+        if (strcmp(g->name, kind) == 0)
+            break;
+    if (!g->name) {
+        fprintf(stderr, F("invalid kind of graph '%s'\n"), kind);
+        do_help(argv[0], EXIT_FAILURE);
+    }
+    rng_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+    if (!rng_state)
+        rng_state = 1; /* the state cannot be zero */
+    g->gen();
+    exit(EXIT_SUCCESS);
+} /* main */
@@ -0,0 +1,385 @@
+/* graph.h -- internal definition of the graph and query
+ *            structures.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 13:05:44 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * This is an internal header, shared by the modules of the
+ * library.  Users of the library should only use the functions
+ * in dijkstra.h, as these structures are opaque to them.
+ */
+
+#ifndef _GRAPH_H
+#define _GRAPH_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "dijkstra.h"
+#include "arena.h"
+#include "csr.h"
+#include "heap.h"
+#include "hindex.h"
+
+struct d_graph {
+    struct d_hindex  idx;      /* database of nodes, by name */
+    struct d_arena   a_nodes;  /* arena of d_node structures */
+    struct d_arena   a_names;  /* arena of node names */
+    struct d_arena   a_links;  /* arena (slab) of link arrays */
+    char            *name;     /* name of this graph */
+    struct d_node   *fr_start; /* the list of nodes in the frontier */
+    struct d_node   *fr_end;   /* the last node of the frontier */
+    struct d_node  **tab;      /* nodes indexed by id */
+    struct d_node  **sorted;   /* nodes in name order, on demand */
+    struct d_heap   *heap;     /* priority queue for the frontier */
+    struct d_csr    *csr;      /* frozen layout, or NULL */
+    struct d_ch     *ch;       /* contraction hierarchy, or NULL */
+    struct d_crp    *crp;      /* partition and overlay, or NULL */
+    struct d_cache  *cache;    /* searches by origin, or NULL */
+    struct d_query  *query;    /* query used by d_dijkstra() when frozen */
+    int             *pub;      /* ids of nodes published by last query */
+    int              pub_n;    /* number of entries in pub */
+    int              nodes;    /* num of nodes of this graph */
+    int              sorted_n; /* num of nodes in sorted */
+    int              tab_cap;  /* capacity of tab */
+    int              frontier; /* frontier engine, D_FRONTIER_* */
+    int              search;   /* search strategy, D_SEARCH_* */
+    int              costs;    /* arithmetic of the costs, D_COSTS_* */
+    int              order;    /* order of the nodes, D_ORDER_* */
+    int              max_wgt;  /* biggest weight added, see
+                                * d_graph_heap_new() */
+    int            (*heuristic)(struct d_node *, struct d_node *, void *);
+                               /* heuristic of D_SEARCH_ASTAR */
+    void            *h_data;   /* calldata of heuristic */
+    int              delta;    /* bucket width of delta-stepping */
+    int              d_threads;/* threads of delta-stepping, it is
+                                * used if more than one */
+    int              ro;       /* read only (opened from a snapshot) */
+    int              narrowed; /* a strategy with int costs was run
+                                * with 64 bit costs selected, and
+                                * warned about it */
+    int              bulk;     /* d_add_link() appends without looking
+                                * for duplicates, see d_begin_bulk() */
+    struct d_stats   stats;    /* counters of the last d_dijkstra() */
+    pthread_mutex_t  mtx;      /* protects the creation of node handles
+                                * in read only graphs, and of the
+                                * reverse adjacency */
+}; /* struct d_graph */
+
+/* query state.  A node id v has a valid cost[v] and back[v] only
+ * if stamp[v] is epoch (queued) or epoch + 1 (settled), so
+ * starting a new query only needs to increment the epoch.  Searches
+ * with 64 bit costs (see d_set_costs()) leave them in wcost instead
+ * of cost, and set wide. */
+struct d_query {
+    struct d_graph  *graph;    /* graph we run on */
+    struct d_heap   *heap;     /* priority queue for the frontier */
+    int             *cost;     /* tentative cost of each node */
+    int             *back;     /* parent id of each node, or -1 */
+    uint32_t        *stamp;    /* epoch of last update of each node */
+    int             *order;    /* settled node ids, in order */
+    uint32_t         epoch;    /* current epoch (always even) */
+    int              cap;      /* capacity of the arrays */
+    int              settled;  /* number of entries in order */
+    int              orig;     /* origin of last query, or -1 */
+    int              wide;     /* the last run left its costs in wcost */
+    int64_t         *wcost;    /* 64 bit costs, allocated on the first
+                                * search that uses them */
+
+    /* backward search of bidirectional queries, allocated on the
+     * first one.  Same meaning as above, costs are to the
+     * destination and rback[v] is the next node towards it. */
+    struct d_heap   *rheap;
+    int             *rcost;
+    int             *rback;
+    uint32_t        *rstamp;
+    int              r_settled;/* nodes settled by the backward search */
+
+    /* A* searches, allocated on the first one */
+    int64_t         *hval;     /* heuristic of each seen node,
+                                * D_ALT_INF if dest is not reached
+                                * from it */
+
+    /* contraction hierarchy searches */
+    int             *path;     /* stack of nodes of the path to unpack */
+    int              path_n;
+    int              path_cap;
+
+    /* overlay searches, allocated on the first one */
+    int             *jump;     /* level + 1 of the overlay link that
+                                * reached each node, 0 for a link of
+                                * the graph */
+
+    struct d_stats   stats;    /* counters, see d_query_stats() */
+}; /* struct d_query */
+
+#define Q_QUEUED(_q, _v)    ((_q)->stamp[_v] == (_q)->epoch)
+#define Q_SETTLED(_q, _v)   ((_q)->stamp[_v] == (_q)->epoch + 1)
+#define Q_SEEN(_q, _v)      ((_q)->stamp[_v] - (_q)->epoch < 2)
+#define Q_COST(_q, _v)      ((_q)->wide \
+                                ? (_q)->wcost[_v] \
+                                : (int64_t)(_q)->cost[_v])
+#define Q_R_SEEN(_q, _v)    ((_q)->rstamp[_v] - (_q)->epoch < 2)
+
+/* STAT(x) evaluates x only if the counters are compiled in (the
+ * sizeof keeps the variables of x used, without evaluating it) */
+#if D_STATS
+#define STAT(_x)            ((void)(_x))
+#else
+#define STAT(_x)            ((void)sizeof(_x))
+#endif
+
+/* seconds from an arbitrary point, to time the phases of the
+ * searches (0.0 if the counters are compiled out) */
+double
+d_stats_now(void);
+
+/* updates the high water mark of the frontier with its size, and
+ * returns it */
+static inline long
+d_stats_frontier(
+        struct d_stats   *st,
+        int               size)
+{
+    if (size > st->frontier_max)
+        st->frontier_max = size;
+    return st->frontier_max;
+} /* d_stats_frontier */
+
+/* creates a heap of capacity ids for the searches on a graph, of
+ * the kind of its frontier engine (D_FRONTIER_LIST gives the
+ * default heap, D_FRONTIER_AUTO chooses one from the biggest
+ * weight), with the span of a dial heap fit to the weights */
+struct d_heap *
+d_graph_heap_new(
+        struct d_graph   *graph,
+        int               capacity);
+
+/* starts a new run of the query: fits the arrays to the graph and
+ * moves to a new epoch, so no node has a cost. */
+void
+d_query_start(
+        struct d_query   *q);
+
+/* one directional search from orig, as d_query_run() does with
+ * D_SEARCH_DIJKSTRA, but with int costs (checked if the graph has
+ * 64 bit costs), for the modules that use them.  If orig is NULL,
+ * the search left in q (its settled nodes and its frontier) is
+ * resumed instead.  Returns the number of nodes settled by this
+ * run. */
+int
+d_query_forward(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags);
+
+/* d_query_forward() with checked int costs, whatever the arithmetic
+ * of the graph, for the modules that keep them (as the cache). */
+int
+d_query_forward_checked(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags);
+
+/* the search of d_query_forward_checked() through the cache of the
+ * graph, see cache.h */
+int
+d_cache_run(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags);
+
+/* drops the entries of a cache (that can be NULL), as the graph
+ * changed */
+void
+d_cache_invalidate(
+        struct d_cache   *cache);
+
+void
+d_cache_free(
+        struct d_cache   *cache);
+
+/* landmark heuristic data, see alt.h.  Costs are 64 bit, and
+ * D_ALT_INF for unreachable nodes. */
+#define D_ALT_INF           INT64_MAX
+
+struct d_alt {
+    struct d_graph  *graph;    /* graph of the landmarks */
+    int              k;        /* number of landmarks */
+    int             *lm;       /* landmark node ids */
+    int64_t         *from;     /* from[v * k + i], cost from landmark
+                                * i to node v */
+    int64_t         *to;       /* to[v * k + i], cost from node v to
+                                * landmark i */
+};
+
+/* lower bound of the cost from node v to node t, by the triangle
+ * inequality on the costs to and from the landmarks.  Returns
+ * D_ALT_INF if t cannot be reached from v (t is reached from a
+ * landmark that doesn't reach v, or reaches a landmark that v
+ * doesn't reach) */
+static inline int64_t
+d_alt_bound(
+        const struct d_alt *alt,
+        int                 v,
+        int                 t)
+{
+    int i, k = alt->k;
+    int64_t res = 0;
+    const int64_t *fv = alt->from + (size_t)v * k;
+    const int64_t *ft = alt->from + (size_t)t * k;
+    const int64_t *tv = alt->to   + (size_t)v * k;
+    const int64_t *tt = alt->to   + (size_t)t * k;
+
+    for (i = 0; i < k; ++i) {
+        if (ft[i] == D_ALT_INF) {
+            if (fv[i] != D_ALT_INF) return D_ALT_INF;
+        } else if (fv[i] != D_ALT_INF && ft[i] - fv[i] > res) {
+            res = ft[i] - fv[i];
+        }
+        if (tv[i] == D_ALT_INF) {
+            if (tt[i] != D_ALT_INF) return D_ALT_INF;
+        } else if (tt[i] != D_ALT_INF && tv[i] - tt[i] > res) {
+            res = tv[i] - tt[i];
+        }
+    }
+    return res;
+} /* d_alt_bound */
+
+/* contraction hierarchy of a frozen graph, see ch.h.  Links
+ * going up from node i are the entries [up_off[i], up_off[i+1])
+ * of the up_* arrays, and links coming down to node i (from a
+ * node of higher rank) are the entries [dn_off[i], dn_off[i+1])
+ * of the dn_* arrays.  via is the node a shortcut goes through,
+ * or -1 for the links of the graph. */
+struct d_ch {
+    uint32_t         n;        /* number of nodes */
+    uint32_t         up_m;     /* number of up links */
+    uint32_t         dn_m;     /* number of down links */
+    uint32_t        *rank;     /* order of contraction of each node */
+    uint32_t        *up_off;
+    uint32_t        *up_tgt;   /* target of each up link */
+    int32_t         *up_wgt;
+    int32_t         *up_via;
+    uint32_t        *dn_off;
+    uint32_t        *dn_src;   /* origin of each down link */
+    int32_t         *dn_wgt;
+    int32_t         *dn_via;
+    int              mapped;   /* arrays point into a snapshot map */
+};
+
+void
+d_ch_free(
+        struct d_ch      *ch);
+
+/* multilevel partition and overlay of a frozen graph, see crp.h.
+ * The cells of a level are unions of cells of the level below.
+ * The entries of a cell are its nodes reached by a link from out
+ * of the cell, and the exits the nodes with a link going out of
+ * it.  The overlay of cell c has the minimum cost, inside the
+ * cell, from each entry i to each exit j at
+ * mat[mat_off[c] + i * (ext_off[c + 1] - ext_off[c]) + j]
+ * (D_CRP_INF if there's no path). */
+#define D_CRP_INF           INT32_MAX
+
+struct d_crp_level {
+    uint32_t         ncells;
+    uint32_t        *cell;     /* cell of each node */
+    int32_t         *ent_idx;  /* index of each node among the entries
+                                * of its cell, or -1 */
+    int32_t         *ext_idx;  /* same, among the exits */
+    uint32_t        *ent_off;  /* ncells + 1 offsets into ent */
+    uint32_t        *ent;      /* entries of the cells */
+    uint32_t        *ext_off;  /* ncells + 1 offsets into ext */
+    uint32_t        *ext;      /* exits of the cells */
+    size_t          *mat_off;  /* ncells + 1 offsets into mat */
+    int32_t         *mat;      /* costs from entries to exits */
+};
+
+struct d_crp {
+    uint32_t         n;        /* number of nodes */
+    int              levels;   /* number of levels */
+    int              customized; /* mat has the costs of the current
+                                  * weights of the graph */
+    struct d_crp_level *lvl;   /* the levels, finest first */
+};
+
+void
+d_crp_free(
+        struct d_crp     *crp);
+
+/* state of a search inside a cell of the overlay, see
+ * d_crp_cell_search().  Arrays are indexed by node id, and valid
+ * for the nodes with stamp[v] == ep (seen) or ep + 1 (settled). */
+struct d_crp_search {
+    int             *dist;
+    int             *back;
+    int             *jump;     /* as in struct d_query */
+    uint32_t        *stamp;
+    uint32_t         ep;
+    struct d_heap   *heap;
+};
+
+/* search from node src to the nodes of its cell of the given
+ * level, on the overlay of the level below (on the links of the
+ * graph at level 0), until node dst is settled (all the nodes
+ * that can be reached, if dst is -1).  src must be an entry of
+ * its cell at the level below.  s->ep must be a new epoch, and
+ * the heap empty.  Returns the number of nodes settled. */
+int
+d_crp_cell_search(
+        const struct d_crp  *crp,
+        const struct d_csr  *csr,
+        int                  level,
+        int                  src,
+        int                  dst,
+        struct d_crp_search *s);
+
+/* same as d_lookup_node(), for a name of len bytes (not nul
+ * terminated) whose hash has been already calculated with
+ * d_hash_name() */
+struct d_node *
+d_lookup_node_hashed(
+        struct d_graph   *graph,
+        const char       *name,
+        size_t            len,
+        uint64_t          hash,
+        int               flags);
+
+/* changes the weight of the link from node id from to node id to
+ * of a graph, keeping its frozen layout (if any) updated, instead
+ * of dropping it as d_add_link() does.  The contraction hierarchy
+ * is dropped, and the overlay of the partition must be customized
+ * again.  Returns the old weight, or -1 if there's no such
+ * link, the weight is negative or the graph is read only. */
+int
+d_reweight_link(
+        struct d_graph   *graph,
+        int               from,
+        int               to,
+        int               weight,
+        int               flags);
+
+/* creates the d_node structure of node id of a read only graph,
+ * where nodes only exist in the frozen layout until they are
+ * needed. */
+struct d_node *
+d_node_materialize(
+        struct d_graph   *graph,
+        int               id);
+
+/* the node of a given id */
+static inline struct d_node *
+d_node_by_id(
+        struct d_graph   *graph,
+        int               id)
+{
+    struct d_node *res = __atomic_load_n(&graph->tab[id], __ATOMIC_ACQUIRE);
+    return res ? res : d_node_materialize(graph, id);
+} /* d_node_by_id */
+
+#endif /* _GRAPH_H */
@@ -0,0 +1,547 @@
+/* heap.c -- priority queues used as the frontier of the Dijkstra
+ *           algorithm.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 10:12:31 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * All the heaps here store integer ids, and are indexed by id,
+ * so a decrease-key operation can locate the item in O(1).
+ * Membership is controlled by a generation counter, so emptying
+ * the heap between runs doesn't need to touch all the ids.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heap.h"
+
+#define RADIX_BUCKETS       65  /* one per bit, plus bucket 0 */
+#define DIAL_SPAN           256 /* default span of a Dial heap */
+#define DIAL_MAX_SPAN       (1 << 16)
+
+struct d_heap {
+    int              kind;     /* one of D_HEAP_* */
+    int              cap;      /* capacity in ids */
+    int              size;     /* number of items in the heap */
+    unsigned         gen;      /* current generation */
+    unsigned        *in;       /* in[id] == gen iff id is in the heap */
+    int64_t         *key;      /* key of each id */
+
+    /* binary heap */
+    int             *arr;      /* the heap array (of ids) */
+    int             *pos;      /* position of id in arr */
+
+    /* pairing heap */
+    int             *child;    /* first child of id */
+    int             *sib;      /* next sibling of id (also radix next) */
+    int             *prev;     /* left sibling or parent (also radix prev) */
+    int             *tmp;      /* scratch for the two pass pairing */
+    int              root;     /* root of the pairing heap */
+
+    /* radix heap */
+    int             *bkt;      /* bucket of each id */
+    int              head[RADIX_BUCKETS]; /* bucket lists */
+    uint64_t         last;     /* last key extracted (also Dial) */
+
+    /* Dial heap, uses also sib, prev and bkt */
+    int             *ring;     /* span + 1 bucket lists, the last one
+                                * is the overflow list */
+    unsigned         span;     /* buckets of the ring, a power of 2 */
+    uint64_t         ovf_min;  /* lower bound of the overflow keys */
+    int              ovf_n;    /* items in the overflow list */
+}; /* struct d_heap */
+
+static void *
+xrealloc(void *p, size_t n)
+{
+    p = realloc(p, n);
+    assert(p != NULL);
+    return p;
+} /* xrealloc */
+
+void
+d_heap_grow(
+        struct d_heap    *h,
+        int               capacity)
+{
+    assert(h->size == 0);
+    if (capacity <= h->cap) return;
+
+    h->in  = xrealloc(h->in,  capacity * sizeof *h->in);
+    memset(h->in + h->cap, 0, (capacity - h->cap) * sizeof *h->in);
+    h->key = xrealloc(h->key, capacity * sizeof *h->key);
+    switch (h->kind) {
+    case D_HEAP_BINARY:
+        h->arr   = xrealloc(h->arr,   capacity * sizeof *h->arr);
+        h->pos   = xrealloc(h->pos,   capacity * sizeof *h->pos);
+        break;
+    case D_HEAP_PAIRING:
+        h->child = xrealloc(h->child, capacity * sizeof *h->child);
+        h->tmp   = xrealloc(h->tmp,   capacity * sizeof *h->tmp);
+        /* FALLTHROUGH */
+    case D_HEAP_RADIX:
+    case D_HEAP_DIAL:
+        h->sib   = xrealloc(h->sib,   capacity * sizeof *h->sib);
+        h->prev  = xrealloc(h->prev,  capacity * sizeof *h->prev);
+        if (h->kind != D_HEAP_PAIRING)
+            h->bkt = xrealloc(h->bkt, capacity * sizeof *h->bkt);
+        break;
+    }
+    h->cap = capacity;
+} /* d_heap_grow */
+
+struct d_heap *
+d_heap_new(
+        int               kind,
+        int               capacity)
+{
+    if (kind != D_HEAP_BINARY
+            && kind != D_HEAP_PAIRING
+            && kind != D_HEAP_RADIX
+            && kind != D_HEAP_DIAL)
+        return NULL;
+
+    struct d_heap *res = calloc(1, sizeof *res);
+    assert(res != NULL);
+    res->kind = kind;
+    res->gen  = 1;
+    d_heap_grow(res, capacity > 0 ? capacity : 1);
+    if (kind == D_HEAP_DIAL)
+        d_heap_set_span(res, DIAL_SPAN);
+    d_heap_clear(res);
+    return res;
+} /* d_heap_new */
+
+void
+d_heap_set_span(
+        struct d_heap    *h,
+        int               span)
+{
+    assert(h->size == 0);
+    if (h->kind != D_HEAP_DIAL) return;
+
+    unsigned n = 1;
+    while (n < (unsigned)span && n < DIAL_MAX_SPAN)
+        n <<= 1;
+    if (n == h->span) return;
+    h->ring = xrealloc(h->ring, (n + 1) * sizeof *h->ring);
+    memset(h->ring, 0xff, (n + 1) * sizeof *h->ring); /* all -1 */
+    h->span = n;
+} /* d_heap_set_span */
+
+void
+d_heap_free(
+        struct d_heap    *h)
+{
+    if (!h) return;
+    free(h->in);    free(h->key);
+    free(h->arr);   free(h->pos);
+    free(h->child); free(h->sib);
+    free(h->prev);  free(h->tmp);
+    free(h->bkt);   free(h->ring);
+    free(h);
+} /* d_heap_free */
+
+void
+d_heap_clear(
+        struct d_heap    *h)
+{
+    int i;
+
+    if (h->ring && h->size > 0) {
+        /* items left in the ring (e.g. the search stopped at its
+         * destination) */
+        memset(h->ring, 0xff, (h->span + 1) * sizeof *h->ring);
+    }
+    if (++h->gen == 0) {
+        /* wrapped around, we need to clean everything */
+        memset(h->in, 0, h->cap * sizeof *h->in);
+        h->gen = 1;
+    }
+    h->size = 0;
+    h->root = -1;
+    h->last = 0;
+    h->ovf_min = UINT64_MAX;
+    h->ovf_n = 0;
+    for (i = 0; i < RADIX_BUCKETS; ++i)
+        h->head[i] = -1;
+} /* d_heap_clear */
+
+int
+d_heap_size(
+        struct d_heap    *h)
+{
+    return h->size;
+} /* d_heap_size */
+
+int
+d_heap_kind(
+        struct d_heap    *h)
+{
+    return h->kind;
+} /* d_heap_kind */
+
+/*
+ * Binary heap.
+ */
+
+static void
+bin_up(struct d_heap *h, int i)
+{
+    int id = h->arr[i];
+    int64_t k = h->key[id];
+    while (i > 0) {
+        int p = (i - 1) >> 1;
+        if (h->key[h->arr[p]] <= k) break;
+        h->arr[i] = h->arr[p];
+        h->pos[h->arr[i]] = i;
+        i = p;
+    }
+    h->arr[i] = id;
+    h->pos[id] = i;
+} /* bin_up */
+
+static void
+bin_down(struct d_heap *h, int i)
+{
+    int id = h->arr[i];
+    int64_t k = h->key[id];
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= h->size) break;
+        if (c + 1 < h->size
+                && h->key[h->arr[c + 1]] < h->key[h->arr[c]])
+            c++;
+        if (h->key[h->arr[c]] >= k) break;
+        h->arr[i] = h->arr[c];
+        h->pos[h->arr[i]] = i;
+        i = c;
+    }
+    h->arr[i] = id;
+    h->pos[id] = i;
+} /* bin_down */
+
+/*
+ * Pairing heap.  Roots always have sib and prev set to -1.
+ */
+
+static int
+pair_meld(struct d_heap *h, int a, int b)
+{
+    if (a < 0) return b;
+    if (b < 0) return a;
+    if (h->key[b] < h->key[a]) {
+        int t = a; a = b; b = t;
+    }
+    /* b becomes the first child of a */
+    h->sib[b]  = h->child[a];
+    if (h->child[a] >= 0) h->prev[h->child[a]] = b;
+    h->prev[b]  = a;
+    h->child[a] = b;
+    return a;
+} /* pair_meld */
+
+static void
+pair_cut(struct d_heap *h, int id)
+{
+    int p = h->prev[id];
+    if (h->child[p] == id)
+        h->child[p] = h->sib[id];
+    else
+        h->sib[p] = h->sib[id];
+    if (h->sib[id] >= 0)
+        h->prev[h->sib[id]] = p;
+    h->sib[id] = h->prev[id] = -1;
+} /* pair_cut */
+
+static int
+pair_pop(struct d_heap *h)
+{
+    int res = h->root, n = 0, c = h->child[res];
+
+    /* first pass, meld the children in pairs, left to right */
+    while (c >= 0) {
+        int a = c, b = h->sib[a];
+        c = b >= 0 ? h->sib[b] : -1;
+        h->sib[a] = h->prev[a] = -1;
+        if (b >= 0) h->sib[b] = h->prev[b] = -1;
+        h->tmp[n++] = pair_meld(h, a, b);
+    }
+    /* second pass, right to left */
+    h->root = -1;
+    while (n > 0)
+        h->root = pair_meld(h, h->tmp[--n], h->root);
+    return res;
+} /* pair_pop */
+
+/*
+ * Radix heap.  Bucket 0 holds the keys equal to the last
+ * extracted one, bucket i holds keys that differ from it first
+ * at bit i - 1.
+ */
+
+static int
+radix_bucket(struct d_heap *h, uint64_t k)
+{
+    return k == h->last
+        ? 0
+        : 64 - __builtin_clzll(k ^ h->last);
+} /* radix_bucket */
+
+static void
+radix_link(struct d_heap *h, int id)
+{
+    int b = radix_bucket(h, h->key[id]);
+    h->bkt[id]  = b;
+    h->prev[id] = -1;
+    h->sib[id]  = h->head[b];
+    if (h->head[b] >= 0) h->prev[h->head[b]] = id;
+    h->head[b]  = id;
+} /* radix_link */
+
+static void
+radix_unlink(struct d_heap *h, int id)
+{
+    if (h->prev[id] >= 0)
+        h->sib[h->prev[id]] = h->sib[id];
+    else
+        h->head[h->bkt[id]] = h->sib[id];
+    if (h->sib[id] >= 0)
+        h->prev[h->sib[id]] = h->prev[id];
+} /* radix_unlink */
+
+/* makes bucket 0 hold the minimum keys, and returns its first
+ * item */
+static int
+radix_min(struct d_heap *h)
+{
+    if (h->head[0] < 0) {
+        int b = 1, id;
+        while (h->head[b] < 0) b++;
+
+        /* the new last is the minimum of bucket b */
+        uint64_t min = UINT64_MAX;
+        for (id = h->head[b]; id >= 0; id = h->sib[id])
+            if ((uint64_t)h->key[id] < min)
+                min = h->key[id];
+        h->last = min;
+
+        /* redistribute, all go to lower buckets */
+        id = h->head[b];
+        h->head[b] = -1;
+        while (id >= 0) {
+            int next = h->sib[id];
+            radix_link(h, id);
+            id = next;
+        }
+    }
+    return h->head[0];
+} /* radix_min */
+
+static int
+radix_pop(struct d_heap *h)
+{
+    int res = radix_min(h);
+    radix_unlink(h, res);
+    return res;
+} /* radix_pop */
+
+/*
+ * Dial heap.  The ring holds the keys in [last, last + span),
+ * bucket k & (span - 1) holds the key k, and bucket span is the
+ * overflow list.  All the keys in the ring are lower than all the
+ * keys in the overflow list (ovf_min is a lower bound of them), so
+ * the minimum is found scanning the ring from last, and only when
+ * the ring gets empty the overflow list is spread into it.
+ */
+
+static void
+dial_link(struct d_heap *h, int id)
+{
+    uint64_t k = h->key[id];
+    int b;
+    if (k - h->last < h->span && k < h->ovf_min) {
+        b = k & (h->span - 1);
+    } else {
+        b = h->span;
+        if (k < h->ovf_min) h->ovf_min = k;
+        h->ovf_n++;
+    }
+    h->bkt[id]  = b;
+    h->prev[id] = -1;
+    h->sib[id]  = h->ring[b];
+    if (h->ring[b] >= 0) h->prev[h->ring[b]] = id;
+    h->ring[b]  = id;
+} /* dial_link */
+
+static void
+dial_unlink(struct d_heap *h, int id)
+{
+    if (h->prev[id] >= 0)
+        h->sib[h->prev[id]] = h->sib[id];
+    else
+        h->ring[h->bkt[id]] = h->sib[id];
+    if (h->sib[id] >= 0)
+        h->prev[h->sib[id]] = h->prev[id];
+    if (h->bkt[id] == (int)h->span)
+        h->ovf_n--;
+} /* dial_unlink */
+
+/* moves last to the minimum key, and returns its first item */
+static int
+dial_min(struct d_heap *h)
+{
+    if (h->size == h->ovf_n) {
+        /* the ring is empty, spread the overflow list from its
+         * minimum (ovf_min can be lower, if the item that set it
+         * left the list) */
+        int id;
+        h->last = UINT64_MAX;
+        for (id = h->ring[h->span]; id >= 0; id = h->sib[id])
+            if ((uint64_t)h->key[id] < h->last)
+                h->last = h->key[id];
+        id = h->ring[h->span];
+        h->ovf_min = UINT64_MAX;
+        h->ovf_n = 0;
+        h->ring[h->span] = -1;
+        while (id >= 0) {
+            int next = h->sib[id];
+            dial_link(h, id);
+            id = next;
+        }
+    }
+    while (h->ring[h->last & (h->span - 1)] < 0)
+        h->last++;
+    return h->ring[h->last & (h->span - 1)];
+} /* dial_min */
+
+static int
+dial_pop(struct d_heap *h)
+{
+    int res = dial_min(h);
+    dial_unlink(h, res);
+    return res;
+} /* dial_pop */
+
+int
+d_heap_push(
+        struct d_heap    *h,
+        int               id,
+        int64_t           key)
+{
+    assert(id >= 0 && id < h->cap);
+    assert(key >= 0); /* d_add_link() takes no negative weights */
+
+    if (h->in[id] == h->gen) {
+        if (key >= h->key[id]) return 0;
+        h->key[id] = key;
+        switch (h->kind) {
+        case D_HEAP_BINARY:
+            bin_up(h, h->pos[id]);
+            break;
+        case D_HEAP_PAIRING:
+            if (id != h->root) {
+                pair_cut(h, id);
+                h->root = pair_meld(h, h->root, id);
+            }
+            break;
+        case D_HEAP_RADIX:
+            assert((uint64_t)key >= h->last);
+            radix_unlink(h, id);
+            radix_link(h, id);
+            break;
+        case D_HEAP_DIAL:
+            assert((uint64_t)key >= h->last);
+            dial_unlink(h, id);
+            dial_link(h, id);
+            break;
+        }
+        return 1;
+    }
+
+    h->in[id]  = h->gen;
+    h->key[id] = key;
+    switch (h->kind) {
+    case D_HEAP_BINARY:
+        h->arr[h->size] = id;
+        bin_up(h, h->size);
+        break;
+    case D_HEAP_PAIRING:
+        h->child[id] = h->sib[id] = h->prev[id] = -1;
+        h->root = pair_meld(h, h->root, id);
+        break;
+    case D_HEAP_RADIX:
+        assert((uint64_t)key >= h->last);
+        radix_link(h, id);
+        break;
+    case D_HEAP_DIAL:
+        assert((uint64_t)key >= h->last);
+        dial_link(h, id);
+        break;
+    }
+    h->size++;
+    return 1;
+} /* d_heap_push */
+
+int
+d_heap_pop(
+        struct d_heap    *h,
+        int64_t          *key)
+{
+    int res;
+
+    if (h->size == 0) return -1;
+    switch (h->kind) {
+    case D_HEAP_BINARY:
+        res = h->arr[0];
+        if (--h->size > 0) {
+            h->arr[0] = h->arr[h->size];
+            bin_down(h, 0);
+        }
+        break;
+    case D_HEAP_PAIRING:
+        res = pair_pop(h);
+        h->size--;
+        break;
+    case D_HEAP_RADIX:
+        res = radix_pop(h);
+        h->size--;
+        break;
+    default: /* D_HEAP_DIAL */
+        res = dial_pop(h);
+        h->size--;
+        break;
+    }
+    h->in[res] = 0;
+    if (key) *key = h->key[res];
+    return res;
+} /* d_heap_pop */
+
+int
+d_heap_peek(
+        struct d_heap    *h,
+        int64_t          *key)
+{
+    int res;
+
+    if (h->size == 0) return -1;
+    switch (h->kind) {
+    case D_HEAP_BINARY:
+        res = h->arr[0];
+        break;
+    case D_HEAP_PAIRING:
+        res = h->root;
+        break;
+    case D_HEAP_RADIX:
+        res = radix_min(h);
+        break;
+    default: /* D_HEAP_DIAL */
+        res = dial_min(h);
+        break;
+    }
+    if (key) *key = h->key[res];
+    return res;
+} /* d_heap_peek */
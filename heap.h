@@ -0,0 +1,139 @@
+/* heap.h -- priority queues used as the frontier of the Dijkstra
+ *           algorithm.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 10:12:31 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _HEAP_H
+#define _HEAP_H
+
+#include <stdint.h>
+
+/* kinds of heap available.  The numbering is shared with the
+ * D_FRONTIER_* constants in dijkstra.h */
+#define D_HEAP_BINARY       1   /* indexed binary heap */
+#define D_HEAP_PAIRING      2   /* pairing heap */
+#define D_HEAP_RADIX        3   /* monotone radix heap */
+#define D_HEAP_DIAL         4   /* monotone bucket queue (Dial) */
+
+struct d_heap;                 /* opaque */
+
+/**
+ * Create a new heap.
+ *
+ * The heap stores items identified by a dense integer id (in the
+ * range [0, capacity)) keyed by a non negative 64 bit key, so it
+ * holds the costs of searches with int and with 64 bit costs.  An
+ * item can be only once in the heap, pushing an already present
+ * item just decreases its key (if the new key is lower).
+ *
+ * @param kind is one of the D_HEAP_* constants above.
+ * @param capacity is the number of ids the heap can hold.
+ * @return the new heap, or NULL if kind is not valid.
+ */
+struct d_heap *
+d_heap_new(
+        int               kind,
+        int               capacity);
+
+/**
+ * Grow the heap to accept ids up to capacity - 1.
+ *
+ * This is only allowed when the heap is empty.
+ */
+void
+d_heap_grow(
+        struct d_heap    *heap,
+        int               capacity);
+
+/**
+ * Set the span of keys of a Dial heap (rounded up to a power of
+ * two, at most 65536).  Items with keys from the minimum to the minimum plus the
+ * span are kept in a ring of buckets, one per key, so they are
+ * inserted and extracted in O(1) (extracting scans the empty
+ * buckets up to the next key).  Items with bigger keys wait in an
+ * overflow list, until the ring gets empty.  In a search, a span
+ * over the biggest weight keeps the overflow list empty.
+ *
+ * This is only allowed when the heap is empty, and does nothing
+ * to other kinds of heap.
+ */
+void
+d_heap_set_span(
+        struct d_heap    *heap,
+        int               span);
+
+/**
+ * Free all the resources associated to a heap.
+ */
+void
+d_heap_free(
+        struct d_heap    *heap);
+
+/**
+ * Empties the heap.  This is an O(1) operation, as membership is
+ * controlled by a generation counter.
+ */
+void
+d_heap_clear(
+        struct d_heap    *heap);
+
+/**
+ * Insert id with the given key, or decrease its key if it is
+ * already in the heap and the new key is lower.
+ *
+ * @return 1 if the item was inserted or its key decreased, 0
+ *         if the item was already present with a lower or equal
+ *         key.
+ */
+int
+d_heap_push(
+        struct d_heap    *heap,
+        int               id,
+        int64_t           key);
+
+/**
+ * Extract the item of minimum key.
+ *
+ * @param key if not NULL, gets the key of the extracted item.
+ * @return the id of the extracted item, or -1 if the heap is
+ *         empty.
+ */
+int
+d_heap_pop(
+        struct d_heap    *heap,
+        int64_t          *key);
+
+/**
+ * Look at the item of minimum key, without extracting it.
+ *
+ * In a radix or Dial heap, this moves the reference of the heap
+ * to the key of the item, so items pushed after this call must
+ * have keys not lower than it (as happens if the item is
+ * extracted).
+ *
+ * @param key if not NULL, gets the key of the item.
+ * @return the id of the item, or -1 if the heap is empty.
+ */
+int
+d_heap_peek(
+        struct d_heap    *heap,
+        int64_t          *key);
+
+/**
+ * @return the number of items in the heap.
+ */
+int
+d_heap_size(
+        struct d_heap    *heap);
+
+/**
+ * @return the kind of the heap, one of the D_HEAP_* constants.
+ */
+int
+d_heap_kind(
+        struct d_heap    *heap);
+
+#endif /* _HEAP_H */
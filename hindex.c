@@ -0,0 +1,187 @@
+/* hindex.c -- open addressing hash index of node names.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 15:31:27 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hindex.h"
+
+#define CTRL_EMPTY          0x80    /* slot is free */
+#define INITIAL_CAP         16      /* must be >= HINDEX_GROUP */
+
+#define H1(_h)              ((_h) >> 7)
+#define H2(_h)              ((uint8_t)((_h) & 0x7f))
+
+uint64_t
+d_hash_name(
+        const char       *s,
+        size_t            len)
+{
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ len, w;
+
+    while (len >= sizeof w) {
+        memcpy(&w, s, sizeof w);
+        h  = (h ^ w) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+        s   += sizeof w;
+        len -= sizeof w;
+    }
+    w = 0;
+    memcpy(&w, s, len);
+    h  = (h ^ w) * 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 29;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 32;
+    return h;
+} /* d_hash_name */
+
+/* bit mask of the slots of the group starting at ctrl whose
+ * control byte is c */
+static unsigned
+group_match(const uint8_t *ctrl, uint8_t c)
+{
+#ifdef __SSE2__
+    __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c)));
+#else
+    unsigned res = 0;
+    int i;
+    for (i = 0; i < HINDEX_GROUP; ++i)
+        if (ctrl[i] == c) res |= 1U << i;
+    return res;
+#endif
+} /* group_match */
+
+static void
+set_ctrl(struct d_hindex *idx, uint32_t i, uint8_t c)
+{
+    idx->ctrl[i] = c;
+    /* the first group is mirrored after the last slot, so groups
+     * can be loaded at any position without wrapping */
+    if (i < HINDEX_GROUP)
+        idx->ctrl[idx->cap + i] = c;
+} /* set_ctrl */
+
+static void
+alloc_slots(struct d_hindex *idx, uint32_t cap)
+{
+    idx->cap   = cap;
+    idx->count = 0;
+    idx->ctrl  = malloc(cap + HINDEX_GROUP);
+    idx->slot  = malloc(cap * sizeof *idx->slot);
+    assert(idx->ctrl != NULL && idx->slot != NULL);
+    memset(idx->ctrl, CTRL_EMPTY, cap + HINDEX_GROUP);
+} /* alloc_slots */
+
+void
+d_hindex_init(
+        struct d_hindex  *idx)
+{
+    alloc_slots(idx, INITIAL_CAP);
+} /* d_hindex_init */
+
+void
+d_hindex_destroy(
+        struct d_hindex  *idx)
+{
+    free(idx->ctrl);
+    free(idx->slot);
+    idx->ctrl  = NULL;
+    idx->slot  = NULL;
+    idx->cap   = 0;
+    idx->count = 0;
+} /* d_hindex_destroy */
+
+int
+d_hindex_find(
+        const struct d_hindex *idx,
+        struct d_node * const *tab,
+        const char            *name,
+        size_t                 len,
+        uint64_t               hash)
+{
+    uint32_t mask   = idx->cap - 1;
+    uint32_t pos    = H1(hash) & mask;
+    uint32_t stride = 0;
+    uint8_t  h2     = H2(hash);
+
+    for (;;) {
+        unsigned m = group_match(idx->ctrl + pos, h2);
+        while (m) {
+            uint32_t i = (pos + __builtin_ctz(m)) & mask;
+            const struct d_node *n = tab[idx->slot[i]];
+            if (n->hash == hash
+                    && memcmp(n->name, name, len) == 0
+                    && n->name[len] == '\0')
+                return idx->slot[i];
+            m &= m - 1;
+        }
+        if (group_match(idx->ctrl + pos, CTRL_EMPTY))
+            return -1; /* an empty slot ends the probe sequence */
+        stride += HINDEX_GROUP;
+        pos = (pos + stride) & mask;
+    }
+} /* d_hindex_find */
+
+static void
+place(struct d_hindex *idx, uint32_t id, uint64_t hash)
+{
+    uint32_t mask   = idx->cap - 1;
+    uint32_t pos    = H1(hash) & mask;
+    uint32_t stride = 0;
+
+    for (;;) {
+        unsigned m = group_match(idx->ctrl + pos, CTRL_EMPTY);
+        if (m) {
+            uint32_t i = (pos + __builtin_ctz(m)) & mask;
+            set_ctrl(idx, i, H2(hash));
+            idx->slot[i] = id;
+            idx->count++;
+            return;
+        }
+        stride += HINDEX_GROUP;
+        pos = (pos + stride) & mask;
+    }
+} /* place */
+
+void
+d_hindex_insert(
+        struct d_hindex       *idx,
+        struct d_node * const *tab,
+        const struct d_node   *nod)
+{
+    /* keep the load factor below 7/8 */
+    if ((uint64_t)(idx->count + 1) * 8 > (uint64_t)idx->cap * 7) {
+        struct d_hindex old = *idx;
+        uint32_t i;
+
+        alloc_slots(idx, old.cap << 1);
+        for (i = 0; i < old.cap; ++i)
+            if (old.ctrl[i] != CTRL_EMPTY)
+                place(idx, old.slot[i], tab[old.slot[i]]->hash);
+        d_hindex_destroy(&old);
+    }
+    place(idx, nod->id, nod->hash);
+} /* d_hindex_insert */
+
+void
+d_hindex_renumber(
+        struct d_hindex  *idx,
+        const uint32_t   *new_id)
+{
+    uint32_t i;
+
+    /* the hashes don't change, so the slots stay where they are */
+    for (i = 0; i < idx->cap; ++i)
+        if (idx->ctrl[i] != CTRL_EMPTY)
+            idx->slot[i] = new_id[idx->slot[i]];
+} /* d_hindex_renumber */
@@ -0,0 +1,95 @@
+/* hindex.h -- open addressing hash index of node names.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 15:31:27 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * This is an internal header.  The index maps names to node ids
+ * in the style of the swiss tables: a control byte per slot,
+ * holding 7 bits of the hash of the node stored in it (or a mark
+ * of empty slot) allows to probe a group of 16 slots at once
+ * (with SSE2, when available), and only compare the names of the
+ * slots whose control byte matches.  Nodes cache their full hash,
+ * so the index can grow without hashing the names again.
+ */
+
+#ifndef _HINDEX_H
+#define _HINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dijkstra.h"
+
+#define HINDEX_GROUP        16      /* slots probed at once */
+
+struct d_hindex {
+    uint8_t        *ctrl;      /* cap + HINDEX_GROUP control bytes */
+    uint32_t       *slot;      /* node id stored in each slot */
+    uint32_t        cap;       /* number of slots, a power of two */
+    uint32_t        count;     /* number of used slots */
+};
+
+/**
+ * Hash a name of len bytes.
+ */
+uint64_t
+d_hash_name(
+        const char       *name,
+        size_t            len);
+
+/**
+ * Initialize an empty index.
+ */
+void
+d_hindex_init(
+        struct d_hindex  *idx);
+
+/**
+ * Free the memory used by the index.
+ */
+void
+d_hindex_destroy(
+        struct d_hindex  *idx);
+
+/**
+ * Search the node named name (of len bytes, not necessarily nul
+ * terminated) in the index.
+ *
+ * @param tab is the table of nodes, indexed by id.
+ * @param hash is d_hash_name(name, len)
+ * @return the id of the node, or -1 if not found.
+ */
+int
+d_hindex_find(
+        const struct d_hindex *idx,
+        struct d_node * const *tab,
+        const char            *name,
+        size_t                 len,
+        uint64_t               hash);
+
+/**
+ * Insert a node in the index.  The node must not be already
+ * present, and its hash field must be already set.
+ *
+ * @param tab is the table of nodes, indexed by id, used to get
+ *            the hashes of the nodes when the index grows.
+ */
+void
+d_hindex_insert(
+        struct d_hindex       *idx,
+        struct d_node * const *tab,
+        const struct d_node   *nod);
+
+/**
+ * Change the ids stored in the index, when the nodes are
+ * renumbered.
+ *
+ * @param new_id gives the new id of each old id.
+ */
+void
+d_hindex_renumber(
+        struct d_hindex  *idx,
+        const uint32_t   *new_id);
+
+#endif /* _HINDEX_H */
@@ -0,0 +1,394 @@
+/* loader.c -- fast loader of graphs from edge list files.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sat Oct 17 09:14:52 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * The input is split in chunks, at line boundaries.  Worker
+ * threads parse the chunks in place, producing for each one an
+ * array of links (with pointers to the names in the input buffer
+ * and their hashes already calculated), while the calling thread
+ * merges the parsed chunks into the graph, in input order.
+ * Workers are not allowed to go too far ahead of the merge, so
+ * the memory used by the parsed chunks is bounded.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "graph.h"
+#include "loader.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+#define CHUNK_BYTES         (4 << 20) /* nominal size of a chunk */
+#define CHUNKS_AHEAD        2         /* chunks per thread ahead of merge */
+#define DEFAULT_WEIGHT      1
+
+/* a parsed link */
+struct edge {
+    const char     *a;         /* origin name (not nul terminated) */
+    const char     *b;         /* destination name */
+    uint64_t        ha;        /* hash of a */
+    uint64_t        hb;        /* hash of b */
+    uint32_t        alen;      /* length of a */
+    uint32_t        blen;      /* length of b */
+    int             weight;    /* weight of the link */
+};
+
+/* a line skipped */
+struct warn {
+    long            line;      /* line number, relative to the chunk */
+    const char     *why;       /* what is wrong with it */
+};
+
+struct chunk {
+    const char     *start;     /* first char of the chunk */
+    const char     *end;       /* one past the last char */
+    struct edge    *e;         /* parsed links */
+    size_t          n;         /* number of links */
+    size_t          cap;       /* capacity of e */
+    struct warn    *w;         /* warnings */
+    size_t          wn;        /* number of warnings */
+    size_t          wcap;      /* capacity of w */
+    long            lines;     /* lines in the chunk */
+    int             done;      /* parsed */
+};
+
+struct loader {
+    pthread_mutex_t mtx;
+    pthread_cond_t  cv;        /* a chunk parsed, or merged */
+    struct chunk   *ch;        /* the chunks */
+    int             nch;       /* number of chunks */
+    int             next;      /* next chunk to parse */
+    int             merged;    /* chunks already merged */
+    int             window;    /* chunks allowed ahead of the merge */
+};
+
+/* separators of the node names, and of the weight */
+static inline int
+is_sep(char c)
+{
+    return c == ' ' || c == ',' || c == '\t';
+} /* is_sep */
+
+static inline int
+is_final_sep(char c)
+{
+    return c == ' ' || c == '\t';
+} /* is_final_sep */
+
+/* parse an integer (as "%d" in scanf(3) would) in [p, end).
+ * Returns the default weight if there are no digits, and -1 if
+ * the weight is negative or doesn't fit in an int, as links
+ * cannot have such weights (see d_add_link()). */
+static int
+parse_weight(const char *p, const char *end)
+{
+    long long res = 0;
+
+    if (p < end && *p == '-'
+            && p + 1 < end && (unsigned)(p[1] - '0') <= 9)
+        return -1;
+    if (p < end && *p == '+')
+        p++;
+    if (p == end || (unsigned)(*p - '0') > 9)
+        return DEFAULT_WEIGHT;
+    while (p < end && (unsigned)(*p - '0') <= 9) {
+        res = res * 10 + (*p++ - '0');
+        if (res > INT_MAX) return -1;
+    }
+    return res;
+} /* parse_weight */
+
+static void
+add_warn(struct chunk *c, long line, const char *why)
+{
+    if (c->wn == c->wcap) {
+        c->wcap = c->wcap ? 2 * c->wcap : 16;
+        c->w = realloc(c->w, c->wcap * sizeof *c->w);
+        assert(c->w != NULL);
+    }
+    c->w[c->wn].line  = line;
+    c->w[c->wn++].why = why;
+} /* add_warn */
+
+static void
+parse_chunk(struct chunk *c)
+{
+    const char *p = c->start;
+    long line = 0;
+
+    while (p < c->end) {
+        const char *eol = memchr(p, '\n', c->end - p);
+        if (!eol) eol = c->end;
+        line++;
+
+        /* first field is the source node */
+        while (p < eol && is_sep(*p)) p++;
+        const char *a = p;
+        while (p < eol && !is_sep(*p)) p++;
+        const char *a_end = p;
+        if (a == a_end || *a == '#') {
+            p = eol + 1;
+            continue;
+        }
+
+        /* second field is the destination node */
+        while (p < eol && is_sep(*p)) p++;
+        const char *b = p;
+        while (p < eol && !is_sep(*p)) p++;
+        const char *b_end = p;
+        if (b == b_end) {
+            add_warn(c, line, "no 'to' node name");
+            p = eol + 1;
+            continue;
+        }
+
+        /* third field is the weight.  The separator after the
+         * destination is consumed, then only spaces and tabs are
+         * skipped, as the original loader did. */
+        if (p < eol) p++;
+        while (p < eol && is_final_sep(*p)) p++;
+        const char *w = p;
+        while (p < eol && !is_final_sep(*p)) p++;
+        int weight = parse_weight(w, p);
+        if (weight < 0) {
+            add_warn(c, line, "negative or too big weight");
+            p = eol + 1;
+            continue;
+        }
+
+        if (c->n == c->cap) {
+            c->cap = c->cap ? 2 * c->cap : 1024;
+            c->e = realloc(c->e, c->cap * sizeof *c->e);
+            assert(c->e != NULL);
+        }
+        struct edge *e = &c->e[c->n++];
+        e->a      = a;
+        e->alen   = a_end - a;
+        e->ha     = d_hash_name(a, e->alen);
+        e->b      = b;
+        e->blen   = b_end - b;
+        e->hb     = d_hash_name(b, e->blen);
+        e->weight = weight;
+
+        p = eol + 1;
+    }
+    c->lines = line;
+} /* parse_chunk */
+
+static void
+merge_chunk(
+        struct d_graph   *graph,
+        struct chunk     *c,
+        const char       *name,
+        long              line_base,
+        int               flags)
+{
+    size_t i, j = 0;
+
+    for (i = 0; i < c->n; ++i) {
+        struct edge *e = &c->e[i];
+        struct d_node *from = d_lookup_node_hashed(graph,
+                e->a, e->alen, e->ha, flags);
+        struct d_node *to   = d_lookup_node_hashed(graph,
+                e->b, e->blen, e->hb, flags);
+        d_add_link(from, to, e->weight, flags);
+    }
+    for (j = 0; j < c->wn; ++j)
+        fprintf(stderr, F("WARNING: %s:%ld: %s.  "
+                "Skipping this entry.\n"),
+                name, line_base + c->w[j].line, c->w[j].why);
+    free(c->e);
+    free(c->w);
+    c->e = NULL;
+    c->w = NULL;
+} /* merge_chunk */
+
+static void *
+worker(void *arg)
+{
+    struct loader *ld = arg;
+
+    pthread_mutex_lock(&ld->mtx);
+    for (;;) {
+        while (ld->next < ld->nch
+                && ld->next >= ld->merged + ld->window)
+            pthread_cond_wait(&ld->cv, &ld->mtx);
+        if (ld->next >= ld->nch) break;
+        int i = ld->next++;
+        pthread_mutex_unlock(&ld->mtx);
+
+        parse_chunk(&ld->ch[i]);
+
+        pthread_mutex_lock(&ld->mtx);
+        ld->ch[i].done = 1;
+        pthread_cond_broadcast(&ld->cv);
+    }
+    pthread_mutex_unlock(&ld->mtx);
+    return NULL;
+} /* worker */
+
+long
+d_load_buffer(
+        struct d_graph   *graph,
+        const char       *buf,
+        size_t            len,
+        const char       *name,
+        int               nthreads,
+        int               flags)
+{
+    struct loader ld = {
+        .mtx = PTHREAD_MUTEX_INITIALIZER,
+        .cv  = PTHREAD_COND_INITIALIZER,
+    };
+    const char *end = buf + len;
+    int i;
+
+    if (nthreads < 1) nthreads = 1;
+
+    /* split the buffer in chunks, at line boundaries */
+    ld.nch = len / CHUNK_BYTES + 1;
+    ld.ch  = calloc(ld.nch, sizeof *ld.ch);
+    assert(ld.ch != NULL);
+    const char *p = buf;
+    for (i = 0; i < ld.nch && p < end; ++i) {
+        const char *q = (size_t)(end - p) > CHUNK_BYTES
+                ? p + CHUNK_BYTES
+                : end;
+        if (q < end) {
+            const char *eol = memchr(q, '\n', end - q);
+            q = eol ? eol + 1 : end;
+        }
+        ld.ch[i].start = p;
+        ld.ch[i].end   = q;
+        p = q;
+    }
+    ld.nch    = i;
+    ld.window = CHUNKS_AHEAD * nthreads;
+
+    pthread_t *th = NULL;
+    int nth = 0;
+    if (nthreads > 1 && ld.nch > 1) {
+        th = malloc(nthreads * sizeof *th);
+        assert(th != NULL);
+        for (nth = 0; nth < nthreads; ++nth)
+            if (pthread_create(&th[nth], NULL, worker, &ld))
+                break;
+    }
+
+    long links = 0, line_base = 0;
+    for (i = 0; i < ld.nch; ++i) {
+        struct chunk *c = &ld.ch[i];
+        if (nth > 0) {
+            pthread_mutex_lock(&ld.mtx);
+            while (!c->done)
+                pthread_cond_wait(&ld.cv, &ld.mtx);
+            pthread_mutex_unlock(&ld.mtx);
+        } else {
+            parse_chunk(c);
+        }
+        links += c->n;
+        merge_chunk(graph, c, name, line_base, flags);
+        line_base += c->lines;
+        if (nth > 0) {
+            pthread_mutex_lock(&ld.mtx);
+            ld.merged++;
+            pthread_cond_broadcast(&ld.cv);
+            pthread_mutex_unlock(&ld.mtx);
+        }
+    }
+    for (i = 0; i < nth; ++i)
+        pthread_join(th[i], NULL);
+    free(th);
+    free(ld.ch);
+    return links;
+} /* d_load_buffer */
+
+long
+d_load_file(
+        struct d_graph   *graph,
+        const char       *path,
+        int               nthreads,
+        int               flags)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int e = errno;
+        close(fd);
+        errno = e;
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        /* cannot be mapped, read it as a stream */
+        FILE *f = fdopen(fd, "r");
+        if (!f) {
+            int e = errno;
+            close(fd);
+            errno = e;
+            return -1;
+        }
+        long res = d_load_stream(graph, f, path, nthreads, flags);
+        fclose(f);
+        return res;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    void *buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int e = errno;
+    close(fd);
+    if (buf == MAP_FAILED) {
+        errno = e;
+        return -1;
+    }
+    madvise(buf, st.st_size, MADV_SEQUENTIAL);
+    long res = d_load_buffer(graph, buf, st.st_size, path,
+            nthreads, flags);
+    munmap(buf, st.st_size);
+    return res;
+} /* d_load_file */
+
+long
+d_load_stream(
+        struct d_graph   *graph,
+        FILE             *in,
+        const char       *name,
+        int               nthreads,
+        int               flags)
+{
+    size_t cap = 1 << 16, len = 0, n;
+    char *buf = malloc(cap);
+    assert(buf != NULL);
+
+    while ((n = fread(buf + len, 1, cap - len, in)) > 0) {
+        len += n;
+        if (len == cap) {
+            cap <<= 1;
+            buf = realloc(buf, cap);
+            assert(buf != NULL);
+        }
+    }
+    if (ferror(in)) {
+        free(buf);
+        return -1;
+    }
+    long res = d_load_buffer(graph, buf, len, name, nthreads, flags);
+    free(buf);
+    return res;
+} /* d_load_stream */
@@ -0,0 +1,85 @@
+/* loader.h -- fast loader of graphs from edge list files.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sat Oct 17 09:14:52 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _LOADER_H
+#define _LOADER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "dijkstra.h"
+
+/**
+ * Load the links in a text buffer into a graph.
+ *
+ * The buffer has one link per line, with the origin node name,
+ * the destination node name (separated by spaces, tabs or
+ * commas) and optionally an integer weight (1 if not present).
+ * Lines with a negative weight, or one that doesn't fit in an int,
+ * are skipped with a warning.  Lines starting with a '#' are
+ * comments.  There's no limit on
+ * the length of the lines.
+ *
+ * The buffer is split in chunks, at line boundaries, that are
+ * parsed by nthreads worker threads in place (names are not
+ * copied until the node is created).  The parsed chunks are
+ * merged into the graph in order by the calling thread, so the
+ * result is the same as adding the links one by one.
+ *
+ * @param graph is the graph to add the links to.
+ * @param buf is the text to parse.  It is not modified.
+ * @param len is the length of buf.
+ * @param name is the name of the source, used in warnings.
+ * @param nthreads is the number of parsing threads.
+ * @return the number of links read.
+ */
+long
+d_load_buffer(
+        struct d_graph   *graph,
+        const char       *buf,
+        size_t            len,
+        const char       *name,
+        int               nthreads,
+        int               flags);
+
+/**
+ * Load the links in a file into a graph.
+ *
+ * The file is mapped into memory, and parsed with
+ * d_load_buffer().
+ *
+ * @param graph is the graph to add the links to.
+ * @param path is the name of the file.
+ * @param nthreads is the number of parsing threads.
+ * @return the number of links read, or -1 if the file cannot be
+ *         read (errno tells why).
+ */
+long
+d_load_file(
+        struct d_graph   *graph,
+        const char       *path,
+        int               nthreads,
+        int               flags);
+
+/**
+ * Load the links read from a stream into a graph.
+ *
+ * Same as d_load_file(), for streams that cannot be mapped into
+ * memory (e.g. pipes).  The stream is read completely into a
+ * buffer before parsing it.
+ *
+ * @return the number of links read, or -1 on read error.
+ */
+long
+d_load_stream(
+        struct d_graph   *graph,
+        FILE             *in,
+        const char       *name,
+        int               nthreads,
+        int               flags);
+
+#endif /* _LOADER_H */
@@ -8,109 +8,729 @@
 
 #include <errno.h>
 #include <getopt.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-#include <avl.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "dijkstra.h"
+#include "alt.h"
+#include "batch.h"
+#include "cache.h"
+#include "ch.h"
+#include "crp.h"
+#include "dynamic.h"
+#include "loader.h"
+#include "matrix.h"
+#include "server.h"
+#include "snapshot.h"
 
 #define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
 
-#define SEP_STRING      ", \t\n"
-#define FINALSEP_STRING " \t\n"
 #define STDIN_TOKEN     "-"
 #define STDIN_NAME      "stdin"
+#define SEP_STRING      ", \t\n"
 
 #define FLAG_PRINT_GRAPH    (1 << 0)
+#define FLAG_MEM_STATS      (1 << 1)
+#define FLAG_SEARCH_STATS   (1 << 2)
+
+int main_flags;
 
 int flags;
+int frontier = D_FRONTIER_DEFAULT;
+char *batch_file;   /* file of queries for batch mode, or NULL */
+int batch_opts;
+int search = D_SEARCH_DEFAULT;
+int costs = D_COSTS_DEFAULT;
+int order = D_ORDER_DEFAULT;
+int landmarks;      /* landmarks of the A* heuristic, 0 for none */
+bool use_ch;        /* use (and build if needed) the contraction
+                     * hierarchy */
+int threads;        /* worker threads, 0 for one per cpu */
+char *snapshot_file;/* file to save the graph to, or NULL */
+int delta = -1;     /* bucket width of delta-stepping, -1 to not
+                     * use it */
+char *changes_file; /* file of weight changes, or NULL */
+char *matrix_nodes; /* file of sources and targets of a matrix, or
+                     * NULL */
+char *matrix_file;  /* file to save the matrix to, or NULL */
+int crp_cells = -1; /* nodes of the finest cells of the partition
+                     * (0 for the default), -1 for no partition */
+char *metric_file;  /* file of weights to customize the partition
+                     * with, or NULL */
+char *sock_path;    /* unix socket to serve queries on, or NULL */
+int tree = -1;      /* format of the shortest path tree printed
+                     * without -d (D_TREE_*), or -1 to print the
+                     * route to each node */
+size_t cache_bytes; /* capacity of the cache of searches, 0 for
+                     * none */
+
+static struct kind_name {
+    char   *name;
+    int     kind;
+} frontier_names[] = {
+    { "list",    D_FRONTIER_LIST },
+    { "binary",  D_FRONTIER_BINARY },
+    { "pairing", D_FRONTIER_PAIRING },
+    { "radix",   D_FRONTIER_RADIX },
+    { "dial",    D_FRONTIER_DIAL },
+    { "auto",    D_FRONTIER_AUTO },
+    { NULL,      0 },
+}, costs_names[] = {
+    { "int",     D_COSTS_INT },
+    { "checked", D_COSTS_CHECKED },
+    { "auto",    D_COSTS_AUTO },
+    { "int64",   D_COSTS_INT64 },
+    { NULL,      0 },
+}, order_names[] = {
+    { "none",    D_ORDER_NONE },
+    { "bfs",     D_ORDER_BFS },
+    { "rcm",     D_ORDER_RCM },
+    { NULL,      0 },
+}, tree_names[] = {
+    { "text",    D_TREE_TEXT },
+    { "binary",  D_TREE_BINARY },
+    { NULL,      0 },
+};
+
+/* the kind named name in table, or -1 */
+static int
+kind_by_name(const struct kind_name *table, const char *name)
+{
+    const struct kind_name *p;
+    for (p = table; p->name; p++)
+        if (strcmp(p->name, name) == 0)
+            return p->kind;
+    return -1;
+} /* kind_by_name */
+
+/* a number of bytes, with an optional k, M or G suffix, or -1 */
+static long long
+bytes_by_name(const char *name)
+{
+    char *end;
+    long long res = strtoll(name, &end, 10);
+
+    if (end == name || res < 0) return -1;
+    switch (*end) {
+    case 'k': res <<= 10; end++; break;
+    case 'M': res <<= 20; end++; break;
+    case 'G': res <<= 30; end++; break;
+    }
+    return *end ? -1 : res;
+} /* bytes_by_name */
 
 void do_help(char *prg, int code)
 {
     fprintf(stderr,
-        "Usage: %s [ -Dh ] [ -s src ] [ -d dst ] [ file ... ]\n"
+        "Usage: %s [ -BCDhMRS ] [ -f engine ] [ -s src ] [ -d dst ]\n"
+        "       [ -A landmarks ] [ -b queries ] [ -c costs ]\n"
+        "       [ -j threads ] [ -K bytes ] [ -L socket ] [ -P cells ] [ -W metric ]\n"
+        "       [ -m nodes ] [ -O matrix ] [ -o snapshot ] [ -r order ]\n"
+        "       [ -t tree ] [ -u changes ] [ -w width ] [ file ... ]\n"
         "Where options are the options below and file is one file per\n"
         "graph.\n"
         "Options:\n"
+        " -b queries runs in batch mode, loading the graph once and\n"
+        "    running all the source/destination pairs read (one per\n"
+        "    line) from the queries file ('-' for standard input).\n"
+        "    Results are written in input order, with the cost and\n"
+        "    latency of each query, and a summary is written to\n"
+        "    standard error.\n"
+        " -A landmarks uses an A* search guided by the landmark\n"
+        "    heuristic, with the given number of landmarks, when a\n"
+        "    destination is given (also in batch mode).\n"
+        " -B uses a bidirectional search when a destination is\n"
+        "    given (also in batch mode).\n"
+        " -C uses the contraction hierarchy of the graph when a\n"
+        "    destination is given (also in batch mode).  It is\n"
+        "    built if the graph has none, and saved with it by -o.\n"
+        " -c costs selects the arithmetic of the costs of the\n"
+        "    searches from a node, one of 'int' (unchecked),\n"
+        "    'checked' (paths costing more than an int holds are\n"
+        "    dropped), 'int64' (64 bit costs, but -A, -B, -C, -K,\n"
+        "    -P, -w, -m and -u run with 'checked' costs) or 'auto'\n"
+        "    ('int64' only if the weights of the graph allow such\n"
+        "    paths, else 'int').\n"
+        "    Default is 'auto'.\n"
         " -D debug.  Activates debug traces on the algorithm.\n"
         " -d dst uses the named dst node as the destination of the\n"
         "    dijkstra algorithm.\n"
+        " -f engine selects the frontier engine, one of 'list' (the\n"
+        "    original linked list of frontier nodes), 'binary',\n"
+        "    'pairing' or 'radix' (heaps), 'dial' (buckets per\n"
+        "    cost) or 'auto' ('dial' if the weights are at most\n"
+        "    1024, else 'binary').  Default is 'auto'.\n"
         " -h help.  Shows this help screen.\n"
+        " -j threads is the number of worker threads used to load\n"
+        "    the graph and to run the queries of batch mode.\n"
+        "    Default is one per online cpu.\n"
+        " -K bytes keeps a cache of the searches of up to the given\n"
+        "    bytes (with an optional k, M or G suffix) per graph, so\n"
+        "    searches from the same source are restored, or resumed\n"
+        "    from where they stopped, instead of starting again.\n"
+        "    Only plain searches (no -A, -B, -C, -P or -w) use it.\n"
+        " -L socket runs as a server on the unix socket, loading the\n"
+        "    graph files once, and answering the queries ('src dst\n"
+        "    [cost|route [graph]]' lines, or binary requests, see\n"
+        "    server.h) of its clients with the threads of -j, until\n"
+        "    SIGINT or SIGTERM.  SIGHUP loads the graph files again,\n"
+        "    while the old ones keep answering.\n"
+        " -M prints the memory used by the arenas of each graph.\n"
+        " -m nodes computes the matrix of minimum costs from the\n"
+        "    sources to the targets read from the nodes file (one\n"
+        "    name per line, the sources first, then an empty line\n"
+        "    and the targets), with the threads of -j, and prints\n"
+        "    it as 'src dst cost' lines.  With -C the searches are\n"
+        "    shared by means of the contraction hierarchy.\n"
+        " -O matrix saves the matrix of -m to the binary matrix\n"
+        "    file, instead of printing it.\n"
+        " -o snapshot saves the graph, once loaded, to the binary\n"
+        "    snapshot file.  Snapshot files can be given as graph\n"
+        "    files, and are opened instantly.\n"
+        " -r order renumbers the nodes of the graph when it is\n"
+        "    frozen, so neighbours are stored near each other, one\n"
+        "    of 'none' (as they appear in the file), 'bfs' (breadth\n"
+        "    first) or 'rcm' (reverse Cuthill-McKee).  Default is\n"
+        "    'none'.\n"
+        " -P cells builds a partition of the graph in cells of up\n"
+        "    to the given number of nodes (0 for %d), grouped in\n"
+        "    %d levels of cells, and uses its overlay (of the minimum\n"
+        "    costs between the boundary nodes of each cell) when a\n"
+        "    destination is given (also in batch mode).\n"
+        " -R prints the route of each query in batch mode.\n"
+        " -S prints to standard error the counters of the searches\n"
+        "    (nodes settled, links scanned, frontier size, times),\n"
+        "    added up for all the queries in batch mode.\n"
         " -s src uses the named src node as start of the dijkstra\n"
         "    algorithm.\n"
-        "File can be any readable file or '-' to indicate standard input.\n",
-        prg);
+        " -t tree, with -s and without -d, prints the shortest path\n"
+        "    tree once, instead of the route to each node, as 'node\n"
+        "    parent cost' lines ('text', with '-' as parent of src)\n"
+        "    or as 'binary' records of node ids (see struct\n"
+        "    d_tree_header).  Only the nodes reached are printed.\n"
+        " -u changes, with -s and without -d, reads changes of the\n"
+        "    weights of links (as 'from to weight' lines) from the\n"
+        "    changes file, and repairs the minimum cost paths from\n"
+        "    src after each batch of them (batches are separated\n"
+        "    by empty lines), before printing them.\n"
+        " -W metric loads new weights for the links of the graph\n"
+        "    (as 'from to weight' lines) from the metric file, once\n"
+        "    the partition of -P (built with the default cells if\n"
+        "    -P is not given) is built, and computes its overlay\n"
+        "    again, as it is done when the weights change.\n"
+        " -w width runs the search without destination with the\n"
+        "    parallel delta-stepping algorithm, on the threads of\n"
+        "    -j, with buckets of the given width of costs (0 to\n"
+        "    choose it from the weights of the links).\n"
+        "File can be any readable file or '-' to indicate standard input.\n"
+        "Files starting as a snapshot are opened as snapshots.\n",
+        prg, D_CRP_CELL_SIZE, D_CRP_LEVELS);
     exit(code);
 } /* do_help */
 
 int pr_route(struct d_node *nod, void *not_used)
 {
-    printf("Node %s(c=%d): ", nod->name, nod->cost);
+    printf("Node %s(c=%lld): ", nod->name, (long long)nod->cost);
     d_print_route(stdout, nod);
     puts("");
     return 0;
 } /* pr_route */
 
-void process(FILE *f, char *name, char *start, char *end)
+int nthreads(void)
+{
+    return threads > 0
+        ? threads
+        : sysconf(_SC_NPROCESSORS_ONLN);
+} /* nthreads */
+
+void do_batch(struct d_graph *g)
+{
+    bool is_normal_file = strcmp(batch_file, STDIN_TOKEN) != 0;
+    FILE *in = is_normal_file
+            ? fopen(batch_file, "r")
+            : stdin;
+    if (!in) {
+        fprintf(stderr,
+                F("FOPEN: %s: %s\n"),
+                batch_file,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    int n = nthreads();
+
+    struct d_batch_stats st;
+    if (d_batch_run(g, in, stdout, n, batch_opts, flags, &st) < 0) {
+        fprintf(stderr, F("batch failed\n"));
+        exit(EXIT_FAILURE);
+    }
+    fprintf(stderr,
+            "%ld queries (%ld unreached) in %.3fs with %d threads, "
+            "%.0f queries/s\n"
+            "latency(us): avg=%.3f p50=%.3f p99=%.3f max=%.3f\n"
+            "settled nodes per query: %.1f\n",
+            st.queries, st.unreached, st.elapsed, n,
+            st.elapsed > 0.0 ? st.queries / st.elapsed : 0.0,
+            st.lat_avg, st.lat_p50, st.lat_p99, st.lat_max,
+            st.settled);
+    if (main_flags & FLAG_SEARCH_STATS)
+        d_print_stats("Batch searches", &st.search, stderr);
+    if ((main_flags & FLAG_SEARCH_STATS) && cache_bytes) {
+        struct d_cache_stats cst;
+        d_cache_stats(g, &cst);
+        d_cache_print_stats("Cache", &cst, stderr);
+    }
+    if (is_normal_file)
+        fclose(in);
+} /* do_batch */
+
+int pr_dyn_route(struct d_node *nod, void *dyn)
 {
-    char line[256];
-    int lineno = 0;
-    struct d_graph *g = d_new_graph(name, flags);
+    const struct d_query *q = d_dyn_query(dyn);
+    printf("Node %s(c=%lld): ", nod->name,
+            d_query_reached(q, nod) ? (long long)d_query_cost(q, nod) : 0);
+    d_query_print_route(stdout, q, nod);
+    puts("");
+    return 0;
+} /* pr_dyn_route */
+
+/* reads the changes of weights, and applies them in batches to
+ * the minimum cost paths from snod */
+void do_changes(struct d_graph *g, char *path, struct d_node *snod)
+{
+    bool is_normal_file = strcmp(changes_file, STDIN_TOKEN) != 0;
+    FILE *in = is_normal_file
+            ? fopen(changes_file, "r")
+            : stdin;
+    if (!in) {
+        fprintf(stderr,
+                F("FOPEN: %s: %s\n"),
+                changes_file,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    struct d_dyn *dyn = d_dyn_new(g, snod, flags);
+    if (!dyn) {
+        fprintf(stderr,
+                F("DYNAMIC: %s: %s\n"),
+                path,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    char *line = NULL;
+    size_t cap = 0;
+    int pending = 0;
+    long lineno = 0;
+    for (;;) {
+        bool eof = getline(&line, &cap, in) < 0;
+        char *save;
+        char *from = eof ? NULL : strtok_r(line, SEP_STRING, &save);
+        lineno++;
+        if (!from) {
+            /* end of a batch */
+            if (pending) {
+                int n = d_dyn_update(dyn, flags);
+                if (flags & D_FLAG_DEBUG)
+                    printf(F("%d changes applied, %d nodes updated\n"),
+                            pending, n);
+                pending = 0;
+            }
+            if (eof) break;
+            continue;
+        }
+        if (from[0] == '#') continue;
+        char *to = strtok_r(NULL, SEP_STRING, &save);
+        char *weight = strtok_r(NULL, SEP_STRING, &save);
+        char *end = NULL;
+        long w = -1;
+        if (weight) {
+            errno = 0;
+            w = strtol(weight, &end, 10);
+            if (errno || end == weight || *end || w < 0 || w > INT_MAX)
+                w = -1;
+        }
+        struct d_node *f = to ? d_find_node(g, from) : NULL;
+        struct d_node *t = f ? d_find_node(g, to) : NULL;
+        const char *why = !weight ? "missing fields"
+                : w < 0 ? "invalid, negative or too big weight"
+                : !t ? "no such nodes"
+                : d_dyn_set_weight(dyn, f, t, w) < 0 ? "no such link"
+                : NULL;
+        if (why) {
+            fprintf(stderr, F("WARNING: %s:%ld: %s.  "
+                    "Skipping this entry.\n"),
+                    changes_file, lineno, why);
+            continue;
+        }
+        pending++;
+    }
+    free(line);
+    if (is_normal_file)
+        fclose(in);
 
-    while (fgets(line, sizeof line, f)) {
-        ++lineno;
+    if (tree >= 0)
+        d_query_print_tree(stdout, d_dyn_query(dyn), tree);
+    else
+        d_foreach_node(g, pr_dyn_route, dyn);
+    d_dyn_free(dyn);
+} /* do_changes */
 
-        char *p = strtok(line, "\n");
-        /* first param is source node */
-        char *from = strtok(p, SEP_STRING);
-        if (!from || from[0] == '#') continue;
+/* find a node by name, and exit with an error if there's no such
+ * node (only nodes of snapshots, which are read only, can be
+ * missing) */
+struct d_node *find_node(struct d_graph *g, char *path, char *name)
+{
+    struct d_node *res = d_lookup_node(g, name, flags);
+    if (!res) {
+        fprintf(stderr, F("%s: no node named '%s'\n"),
+                path, name);
+        exit(EXIT_FAILURE);
+    }
+    return res;
+} /* find_node */
 
-        /* second param is destination node */
-        char *to = strtok(NULL, SEP_STRING);
-        if (!to) {
-            fprintf(stderr, F("WARNING: %s:%d: no 'to' node"
-                    " name.  Skipping this entry.\n"),
-                    name, lineno);
+/* reads the names of the nodes of a matrix, into *src and *dst,
+ * and returns the number of sources (the number of targets goes to
+ * *nt) */
+int read_matrix_nodes(struct d_graph *g, char *path,
+        struct d_node ***src, struct d_node ***dst, int *nt)
+{
+    bool is_normal_file = strcmp(matrix_nodes, STDIN_TOKEN) != 0;
+    FILE *in = is_normal_file
+            ? fopen(matrix_nodes, "r")
+            : stdin;
+    if (!in) {
+        fprintf(stderr,
+                F("FOPEN: %s: %s\n"),
+                matrix_nodes,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    struct d_node **set[2] = { NULL, NULL };
+    int n[2] = { 0, 0 }, cap[2] = { 0, 0 }, k = 0;
+    char *line = NULL;
+    size_t lcap = 0;
+    while (getline(&line, &lcap, in) >= 0) {
+        char *save;
+        char *name = strtok_r(line, SEP_STRING, &save);
+        if (!name) {
+            /* the targets follow the first empty line */
+            if (n[0] > 0) k = 1;
             continue;
         }
+        if (name[0] == '#') continue;
+        if (n[k] == cap[k]) {
+            cap[k] = cap[k] ? 2 * cap[k] : 64;
+            set[k] = realloc(set[k], cap[k] * sizeof *set[k]);
+            if (!set[k]) {
+                fprintf(stderr, F("MATRIX: %s\n"), strerror(errno));
+                exit(EXIT_FAILURE);
+            }
+        }
+        set[k][n[k]++] = find_node(g, path, name);
+    }
+    free(line);
+    if (is_normal_file)
+        fclose(in);
+
+    *src = set[0];
+    *dst = set[1];
+    *nt  = n[1];
+    return n[0];
+} /* read_matrix_nodes */
+
+/* computes the matrix of minimum costs among the nodes of the
+ * matrix_nodes file, and prints or saves it */
+void do_matrix(struct d_graph *g, char *path)
+{
+    struct d_node **src, **dst;
+    int nt, ns = read_matrix_nodes(g, path, &src, &dst, &nt);
+    int n = nthreads(), i, j;
+
+    size_t cells = (size_t)ns * nt;
+    int32_t *res = malloc((cells > 0 ? cells : 1) * sizeof *res);
+    if (!res) {
+        fprintf(stderr, F("MATRIX: %d x %d: %s\n"),
+                ns, nt, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    long settled = d_matrix(g, src, ns, dst, nt, res, n, flags);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    fprintf(stderr,
+            "%d x %d matrix in %.3fs with %d threads, "
+            "%ld nodes settled\n",
+            ns, nt,
+            (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9,
+            n, settled);
+
+    if (matrix_file) {
+        if (d_matrix_save(matrix_file, src, ns, dst, nt, res) < 0) {
+            fprintf(stderr,
+                    F("MATRIX: %s: %s\n"),
+                    matrix_file,
+                    strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        for (i = 0; i < ns; ++i)
+            for (j = 0; j < nt; ++j)
+                printf("%s %s %d\n", src[i]->name, dst[j]->name,
+                        res[(size_t)i * nt + j]);
+    }
+    free(res);
+    free(src);
+    free(dst);
+} /* do_matrix */
+
+/* loads a graph file, or returns NULL if it cannot be read */
+struct d_graph *try_load(char *path)
+{
+    bool is_normal_file = strcmp(path, STDIN_TOKEN) != 0;
+    char *name = is_normal_file ? path : STDIN_NAME;
+    struct d_graph *g;
 
-        /* now, the weight of the arc */
-        int weight = 1; /* default weight */
-        char *rest = strtok(NULL, FINALSEP_STRING);
-        if (rest) {
-            sscanf(rest, "%d", &weight);
+    if (is_normal_file && d_is_snapshot(path)) {
+        g = d_open_snapshot(path, 0, flags);
+        if (!g) {
+            fprintf(stderr,
+                    F("SNAPSHOT: %s: %s\n"),
+                    path,
+                    strerror(errno));
+            return NULL;
         }
-        d_add_link(
-                d_lookup_node(g, from, flags),
-                d_lookup_node(g, to, flags),
-                weight,
-                flags);
+        d_set_frontier(g, frontier);
+        d_set_search(g, search);
+        d_set_costs(g, costs);
+        if (delta >= 0)
+            d_set_delta(g, nthreads(), delta);
+        return g;
     }
-    d_sort(g, flags);
+
+    g = d_new_graph(name, flags);
+    d_set_frontier(g, frontier);
+    d_set_search(g, search);
+    d_set_costs(g, costs);
+    d_set_order(g, order);
+    if (delta >= 0)
+        d_set_delta(g, nthreads(), delta);
+
+    d_begin_bulk(g); /* duplicates are dropped after loading */
+    long links = is_normal_file
+            ? d_load_file(g, path, nthreads(), flags)
+            : d_load_stream(g, stdin, name, nthreads(), flags);
+    if (links < 0) {
+        fprintf(stderr,
+                F("LOAD: %s: %s\n"),
+                name,
+                strerror(errno));
+        d_free_graph(g);
+        return NULL;
+    }
+    if (flags & D_FLAG_DEBUG)
+        printf(F("%ld links read from %s\n"), links, name);
+    d_end_bulk(g, nthreads(), flags);
     if (flags & D_FLAG_DEBUG)
         d_print_graph(g, stdout);
     d_sort(g, flags); /* just to show that a second sort just
                        * does nothing. You can eliminate this
                        * call */
-    if (start) {
-        struct d_node *snod = d_lookup_node(g, start, flags);
+    d_freeze(g, flags); /* queries run on the frozen layout */
+    return g;
+} /* try_load */
+
+struct d_graph *load(char *path)
+{
+    struct d_graph *g = try_load(path);
+    if (!g) exit(EXIT_FAILURE);
+    return g;
+} /* load */
+
+/* builds the partition of the graph, and computes its overlay
+ * again for the weights of the metric file, if any.  Returns -1 on
+ * errors. */
+int do_crp(struct d_graph *g, char *path)
+{
+    struct timespec t0, t1;
+    int n = nthreads();
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    long cells = d_crp_build(g, 0, crp_cells, n, flags);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (cells < 0) {
+        fprintf(stderr, F("PARTITION: %s: invalid cell size %d\n"),
+                path, crp_cells);
+        return -1;
+    }
+    fprintf(stderr, "partition of %ld cells in %.3fs\n", cells,
+            (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9);
+    if (metric_file) {
+        long w = d_crp_load_metric(g, metric_file, flags);
+        if (w < 0) {
+            fprintf(stderr,
+                    F("METRIC: %s: %s\n"),
+                    metric_file,
+                    strerror(errno));
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        long links = d_crp_customize(g, n, flags);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        fprintf(stderr,
+                "%ld weights changed, %ld overlay links customized "
+                "in %.3fs with %d threads\n",
+                w, links,
+                (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9,
+                n);
+    }
+    d_set_search(g, D_SEARCH_CRP);
+    return 0;
+} /* do_crp */
+
+/* prints the counters of the last search, if asked to */
+void print_stats(struct d_graph *g)
+{
+    struct d_stats st;
+
+    if (!(main_flags & FLAG_SEARCH_STATS)) return;
+    d_get_stats(g, &st);
+    d_print_stats("Search", &st, stderr);
+    if (cache_bytes) {
+        struct d_cache_stats cst;
+        d_cache_stats(g, &cst);
+        d_cache_print_stats("Cache", &cst, stderr);
+    }
+} /* print_stats */
+
+/* prepares the searches of a loaded graph as the options say, and
+ * leaves in *alt the landmarks of A*, if any.  Returns -1 on
+ * errors. */
+int prepare(struct d_graph *g, char *path, struct d_alt **alt)
+{
+    *alt = NULL;
+    if (cache_bytes)
+        d_cache_set(g, cache_bytes);
+    if (use_ch) {
+        if (!d_ch_present(g))
+            d_ch_build(g, flags);
+        d_set_search(g, D_SEARCH_CH);
+    }
+    if (crp_cells >= 0 && do_crp(g, path) < 0)
+        return -1;
+    if (landmarks > 0) {
+        *alt = d_alt_new(g, landmarks, flags);
+        d_set_heuristic(g, d_alt_heuristic, *alt);
+        d_set_search(g, D_SEARCH_ASTAR);
+    }
+    return 0;
+} /* prepare */
+
+/* loads the graphs of the server, see struct d_srv_ops */
+struct d_graph *srv_load(const char *path, void **data, void *arg)
+{
+    struct d_graph *g = try_load((char *)path);
+    if (g && prepare(g, (char *)path, (struct d_alt **)data) < 0) {
+        d_free_graph(g);
+        g = NULL;
+    }
+    return g;
+} /* srv_load */
+
+void srv_unload(struct d_graph *g, void *alt, void *arg)
+{
+    d_alt_free(alt);
+    d_free_graph(g);
+} /* srv_unload */
+
+/* serves the queries on the graphs of the files, until a signal
+ * stops the server */
+void do_server(char **paths, int n)
+{
+    static const struct d_srv_ops ops = {
+        .load   = srv_load,
+        .unload = srv_unload,
+    };
+    int i;
+
+    for (i = 0; i < n; ++i) {
+        if (strcmp(paths[i], STDIN_TOKEN) == 0) {
+            /* it could not be loaded again */
+            fprintf(stderr, F("the server cannot read graphs from "
+                    "standard input\n"));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    struct d_srv_stats st;
+    if (d_srv_run(sock_path, paths, n, &ops, nthreads(), flags, &st) < 0) {
+        fprintf(stderr,
+                F("SERVER: %s: %s\n"),
+                sock_path,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    fprintf(stderr,
+            "%ld queries (%ld unreached, %ld invalid) on %ld "
+            "connections, %ld graphs loaded again\n"
+            "latency(us): avg=%.3f max=%.3f\n",
+            st.queries, st.unreached, st.invalid, st.conns,
+            st.reloads, st.lat_avg, st.lat_max);
+} /* do_server */
+
+void process(char *path, char *start, char *end)
+{
+    struct d_graph *g = load(path);
+    struct d_alt *alt;
+
+    if (prepare(g, path, &alt) < 0)
+        exit(EXIT_FAILURE);
+    if (snapshot_file
+            && d_save_snapshot(g, snapshot_file, flags) < 0) {
+        fprintf(stderr,
+                F("SNAPSHOT: %s: %s\n"),
+                snapshot_file,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (batch_file) {
+        do_batch(g);
+    } else if (matrix_nodes) {
+        do_matrix(g, path);
+    } else if (start) {
+        struct d_node *snod = find_node(g, path, start);
         if (end) {
-            struct d_node *enod = d_lookup_node(g, end, flags);
+            struct d_node *enod = find_node(g, path, end);
             int iter = d_dijkstra(g, snod, enod, flags);
             if (flags & D_FLAG_DEBUG)
-                printf(F("%d Iterations\n"), iter);
+                printf(F("%d Iterations (nodes settled)\n"), iter);
+            print_stats(g);
             d_print_route(stdout, enod);
             puts("");
+        } else if (changes_file) {
+            do_changes(g, path, snod);
         } else {
             int iter = d_dijkstra(g, snod, NULL, flags);
             if (flags & D_FLAG_DEBUG)
                 printf(F("%d Iterations\n"), iter);
-            d_foreach_node(g, pr_route, NULL);
+            print_stats(g);
+            if (tree >= 0)
+                d_print_tree(stdout, g, tree);
+            else
+                d_foreach_node(g, pr_route, NULL);
         }
     }
+    if (main_flags & FLAG_MEM_STATS)
+        d_print_mem_stats(g, stdout);
+    d_alt_free(alt);
+    d_free_graph(g);
 } /* process */
 
 
@@ -121,46 +741,96 @@ int main(int argc, char **argv)
     char *source = NULL;
     char *destination = NULL;
 
-    while ((opt = getopt(argc, argv, "Dd:hs:")) >= 0) {
+    while ((opt = getopt(argc, argv, "A:BCb:c:Dd:f:hj:K:L:Mm:O:o:P:Rr:Ss:t:u:W:w:")) >= 0) {
         switch (opt) {
+        case 'A': landmarks = atoi(optarg); break;
+        case 'B': search = D_SEARCH_BIDIR; break;
+        case 'C': use_ch = true; break;
+        case 'b': batch_file = optarg; break;
         case 'D': flags |= D_FLAG_DEBUG; break;
         case 'd': destination = optarg; break;
+        case 'c':
+            costs = kind_by_name(costs_names, optarg);
+            if (costs < 0) {
+                fprintf(stderr,
+                        F("invalid arithmetic of costs '%s'\n"),
+                        optarg);
+                do_help(prog, EXIT_FAILURE);
+            }
+            break;
+        case 'f':
+            frontier = kind_by_name(frontier_names, optarg);
+            if (frontier < 0) {
+                fprintf(stderr,
+                        F("invalid frontier engine '%s'\n"),
+                        optarg);
+                do_help(prog, EXIT_FAILURE);
+            }
+            break;
         case 'h': do_help(prog, EXIT_SUCCESS); break;
+        case 'j': threads = atoi(optarg); break;
+        case 'K': {
+                long long b = bytes_by_name(optarg);
+                if (b < 0) {
+                    fprintf(stderr,
+                            F("invalid size of cache '%s'\n"),
+                            optarg);
+                    do_help(prog, EXIT_FAILURE);
+                }
+                cache_bytes = b;
+            }
+            break;
+        case 'L': sock_path = optarg; break;
+        case 'M': main_flags |= FLAG_MEM_STATS; break;
+        case 'm': matrix_nodes = optarg; break;
+        case 'O': matrix_file = optarg; break;
+        case 'o': snapshot_file = optarg; break;
+        case 'P': crp_cells = atoi(optarg); break;
+        case 'R': batch_opts |= D_BATCH_ROUTES; break;
+        case 'r':
+            order = kind_by_name(order_names, optarg);
+            if (order < 0) {
+                fprintf(stderr,
+                        F("invalid order of nodes '%s'\n"),
+                        optarg);
+                do_help(prog, EXIT_FAILURE);
+            }
+            break;
+        case 'S': main_flags |= FLAG_SEARCH_STATS; break;
         case 's': source = optarg; break;
+        case 't':
+            tree = kind_by_name(tree_names, optarg);
+            if (tree < 0) {
+                fprintf(stderr,
+                        F("invalid format of tree '%s'\n"),
+                        optarg);
+                do_help(prog, EXIT_FAILURE);
+            }
+            break;
+        case 'u': changes_file = optarg; break;
+        case 'W':
+            metric_file = optarg;
+            if (crp_cells < 0) crp_cells = 0;
+            break;
+        case 'w': delta = atoi(optarg); break;
         }
     }
 
     argc -= optind; argv += optind;
 
-    if (argc > 0) {
-        int i;
-        for (i = 0; i < argc; ++i) {
-            bool is_normal_file = strcmp(
-                    argv[i],
-                    STDIN_TOKEN) != 0;
-            FILE *f = is_normal_file
-                    ? fopen(argv[i], "r")
-                    : stdin;
-
-            if (!f) {
-                fprintf(stderr,
-                        F("FOPEN: %s: %s\n"),
-                        argv[i],
-                        strerror(errno));
-                exit(EXIT_FAILURE);
-            }
-            process(f, is_normal_file
-                    ? argv[i]
-                    : STDIN_NAME,
-                    source,
-                    destination);
-            if (is_normal_file) {
-                fclose(f);
-            }
+    if (sock_path) {
+        if (argc > 0) {
+            do_server(argv, argc);
+        } else {
+            fprintf(stderr, F("no graph files to serve\n"));
+            do_help(prog, EXIT_FAILURE);
         }
+    } else if (argc > 0) {
+        int i;
+        for (i = 0; i < argc; ++i)
+            process(argv[i], source, destination);
     } else {
-        process(stdin, STDIN_NAME,
-            source, destination);
+        process(STDIN_TOKEN, source, destination);
     }
     exit(EXIT_SUCCESS);
 } /* main */
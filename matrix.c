@@ -0,0 +1,421 @@
+/* matrix.c -- matrices of minimum costs between sets of nodes.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sun Oct 18 15:07:52 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "graph.h"
+#include "matrix.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+#define MATRIX_MAGIC        "DIJKMTRX"
+#define MATRIX_BYTE_ORDER   0x01020304U
+
+struct matrix_header {
+    char            magic[8];  /* MATRIX_MAGIC, no nul */
+    uint32_t        version;   /* D_MATRIX_VERSION */
+    uint32_t        byte_order;/* MATRIX_BYTE_ORDER */
+    uint64_t        rows;
+    uint64_t        cols;
+};
+
+/* entry of a bucket: the cost from the node to target j */
+struct entry {
+    int             node;
+    int             j;
+    int             cost;
+};
+
+struct entries {
+    struct entry   *a;
+    int             n;
+    int             cap;
+};
+
+struct job {
+    struct d_graph  *graph;
+    struct d_node  **src;
+    int              ns;
+    struct d_node  **dst;
+    int              nt;
+    int32_t         *res;
+    int              flags;
+    int              next;     /* next source (or target) to run */
+    long             settled;  /* nodes settled by all the searches */
+    char            *is_dst;   /* nonzero for the targets */
+    int              n_dst;    /* number of different targets */
+
+    /* buckets of the nodes, as a CSR of the entries */
+    struct entries  *found;    /* entries found by each thread */
+    int             *b_off;
+    int             *b_j;
+    int             *b_cost;
+};
+
+struct worker {
+    struct job      *job;
+    int              id;
+    pthread_t        thr;
+};
+
+static void
+push_entry(struct entries *l, int node, int j, int cost)
+{
+    if (l->n == l->cap) {
+        l->cap = l->cap ? 2 * l->cap : 256;
+        l->a = realloc(l->a, l->cap * sizeof *l->a);
+        assert(l->a != NULL);
+    }
+    l->a[l->n].node = node;
+    l->a[l->n].j    = j;
+    l->a[l->n].cost = cost;
+    l->n++;
+} /* push_entry */
+
+/* upward search in the hierarchy from node s, forward (up links)
+ * or backward (down links, to the node).  Calls visit() for each
+ * node settled and not stalled, and returns the number of nodes
+ * settled.  Costs are checked ints, as with D_COSTS_CHECKED. */
+static int
+ch_search(
+        struct d_query   *q,
+        int               s,
+        int               fwd,
+        void            (*visit)(int node, int cost, void *arg),
+        void             *arg)
+{
+    const struct d_ch *ch = q->graph->ch;
+    const uint32_t *off   = fwd ? ch->up_off : ch->dn_off;
+    const uint32_t *nod   = fwd ? ch->up_tgt : ch->dn_src;
+    const int32_t  *wgt   = fwd ? ch->up_wgt : ch->dn_wgt;
+    const uint32_t *s_off = fwd ? ch->dn_off : ch->up_off;
+    const uint32_t *s_nod = fwd ? ch->dn_src : ch->up_tgt;
+    const int32_t  *s_wgt = fwd ? ch->dn_wgt : ch->up_wgt;
+    int            *cost  = q->cost;
+    uint32_t       *stamp = q->stamp;
+    uint32_t        ep, e;
+    int             u, n = 0;
+
+    d_query_start(q);
+    ep = q->epoch;
+    cost[s]  = 0;
+    stamp[s] = ep;
+    d_heap_push(q->heap, s, 0);
+    while ((u = d_heap_pop(q->heap, NULL)) >= 0) {
+        stamp[u] = ep + 1;
+        n++;
+        /* stalled if a higher node reaches it cheaper */
+        for (e = s_off[u]; e < s_off[u + 1]; ++e) {
+            int x = s_nod[e];
+            if (Q_SEEN(q, x)
+                    && (long long)cost[x] + s_wgt[e] < cost[u])
+                break;
+        }
+        if (e < s_off[u + 1]) continue;
+        visit(u, cost[u], arg);
+        for (e = off[u]; e < off[u + 1]; ++e) {
+            if ((long long)cost[u] + wgt[e] > INT_MAX)
+                continue; /* the path doesn't fit in a cost */
+            int v = nod[e], nc = cost[u] + wgt[e];
+            if (stamp[v] != ep) {
+                if (stamp[v] == ep + 1) continue;
+                stamp[v] = ep;
+            } else if (nc >= cost[v]) {
+                continue;
+            }
+            cost[v] = nc;
+            d_heap_push(q->heap, v, nc);
+        }
+    }
+    return n;
+} /* ch_search */
+
+struct visit_arg {
+    struct job      *job;
+    struct entries  *found;    /* backward, where to leave entries */
+    int              j;        /* backward, the target */
+    int32_t         *row;      /* forward, the row of the source */
+};
+
+static void
+visit_bwd(int node, int cost, void *arg)
+{
+    struct visit_arg *a = arg;
+    push_entry(a->found, node, a->j, cost);
+} /* visit_bwd */
+
+static void
+visit_fwd(int node, int cost, void *arg)
+{
+    struct visit_arg *a = arg;
+    const struct job *job = a->job;
+    int e;
+    for (e = job->b_off[node]; e < job->b_off[node + 1]; ++e) {
+        int32_t *r = &a->row[job->b_j[e]];
+        long long c = (long long)cost + job->b_cost[e];
+        if (c <= INT_MAX && (*r < 0 || c < *r))
+            *r = c;
+    }
+} /* visit_fwd */
+
+static void *
+ch_backward(void *arg)
+{
+    struct worker *w = arg;
+    struct job *job = w->job;
+    struct d_query *q = d_query_new(job->graph, job->flags);
+    struct visit_arg a = { .job = job, .found = &job->found[w->id] };
+    long n = 0;
+
+    while ((a.j = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED))
+            < job->nt)
+        n += ch_search(q, job->dst[a.j]->id, 0, visit_bwd, &a);
+    __atomic_fetch_add(&job->settled, n, __ATOMIC_RELAXED);
+    d_query_free(q);
+    return NULL;
+} /* ch_backward */
+
+static void *
+ch_forward(void *arg)
+{
+    struct worker *w = arg;
+    struct job *job = w->job;
+    struct d_query *q = d_query_new(job->graph, job->flags);
+    struct visit_arg a = { .job = job };
+    long n = 0;
+    int i, j;
+
+    while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED))
+            < job->ns) {
+        a.row = job->res + (size_t)i * job->nt;
+        for (j = 0; j < job->nt; ++j)
+            a.row[j] = -1;
+        n += ch_search(q, job->src[i]->id, 1, visit_fwd, &a);
+    }
+    __atomic_fetch_add(&job->settled, n, __ATOMIC_RELAXED);
+    d_query_free(q);
+    return NULL;
+} /* ch_forward */
+
+/* search from s until all the targets are settled, with checked
+ * int costs */
+static int
+plain_search(struct job *job, struct d_query *q, int s)
+{
+    const struct d_csr *csr = q->graph->csr;
+    int            *cost  = q->cost;
+    uint32_t       *stamp = q->stamp;
+    uint32_t        ep, e;
+    int             u, n = 0, found = 0;
+
+    d_query_start(q);
+    ep = q->epoch;
+    cost[s]  = 0;
+    stamp[s] = ep;
+    d_heap_push(q->heap, s, 0);
+    while ((u = d_heap_pop(q->heap, NULL)) >= 0) {
+        stamp[u] = ep + 1;
+        n++;
+        if (job->is_dst[u] && ++found == job->n_dst)
+            break;
+        for (e = csr->off[u]; e < csr->off[u + 1]; ++e) {
+            if ((long long)cost[u] + csr->wgt[e] > INT_MAX)
+                continue; /* the path doesn't fit in a cost */
+            int v = csr->tgt[e], nc = cost[u] + csr->wgt[e];
+            if (stamp[v] != ep) {
+                if (stamp[v] == ep + 1) continue;
+                stamp[v] = ep;
+            } else if (nc >= cost[v]) {
+                continue;
+            }
+            cost[v] = nc;
+            d_heap_push(q->heap, v, nc);
+        }
+    }
+    return n;
+} /* plain_search */
+
+static void *
+plain(void *arg)
+{
+    struct worker *w = arg;
+    struct job *job = w->job;
+    struct d_query *q = d_query_new(job->graph, job->flags);
+    long n = 0;
+    int i, j;
+
+    while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED))
+            < job->ns) {
+        int32_t *row = job->res + (size_t)i * job->nt;
+        n += plain_search(job, q, job->src[i]->id);
+        for (j = 0; j < job->nt; ++j)
+            row[j] = d_query_cost(q, job->dst[j]);
+    }
+    __atomic_fetch_add(&job->settled, n, __ATOMIC_RELAXED);
+    d_query_free(q);
+    return NULL;
+} /* plain */
+
+/* runs fn on threads workers, the calling thread being one of
+ * them */
+static void
+run(struct job *job, struct worker *w, int threads, void *(*fn)(void *))
+{
+    int i;
+
+    job->next = 0;
+    for (i = 1; i < threads; ++i) {
+        int res = pthread_create(&w[i].thr, NULL, fn, &w[i]);
+        assert(res == 0);
+    }
+    fn(&w[0]);
+    for (i = 1; i < threads; ++i)
+        pthread_join(w[i].thr, NULL);
+} /* run */
+
+long
+d_matrix(
+        struct d_graph   *graph,
+        struct d_node   **src,
+        int               ns,
+        struct d_node   **dst,
+        int               nt,
+        int32_t          *res,
+        int               threads,
+        int               flags)
+{
+    d_freeze(graph, flags);
+
+    int n = graph->csr->n, i, j;
+    struct job job = {
+        .graph = graph,
+        .src   = src,
+        .ns    = ns,
+        .dst   = dst,
+        .nt    = nt,
+        .res   = res,
+        .flags = flags,
+    };
+    if (threads < 1) threads = 1;
+    struct worker *w = calloc(threads, sizeof *w);
+    assert(w != NULL);
+    for (i = 0; i < threads; ++i) {
+        w[i].job = &job;
+        w[i].id  = i;
+    }
+
+    if (!graph->ch) {
+        job.is_dst = calloc(n ? n : 1, 1);
+        assert(job.is_dst != NULL);
+        for (j = 0; j < nt; ++j)
+            if (!job.is_dst[dst[j]->id]++)
+                job.n_dst++;
+        run(&job, w, threads, plain);
+        free(job.is_dst);
+    } else {
+        job.found = calloc(threads, sizeof *job.found);
+        job.b_off = calloc(n + 1, sizeof *job.b_off);
+        assert(job.found && job.b_off);
+        run(&job, w, threads, ch_backward);
+
+        /* sort the entries found by node, into the buckets */
+        long total = 0;
+        for (i = 0; i < threads; ++i) {
+            for (j = 0; j < job.found[i].n; ++j)
+                job.b_off[job.found[i].a[j].node + 1]++;
+            total += job.found[i].n;
+        }
+        assert(total <= INT32_MAX);
+        for (i = 0; i < n; ++i)
+            job.b_off[i + 1] += job.b_off[i];
+        job.b_j    = malloc((total ? total : 1) * sizeof *job.b_j);
+        job.b_cost = malloc((total ? total : 1) * sizeof *job.b_cost);
+        assert(job.b_j && job.b_cost);
+        for (i = 0; i < threads; ++i) {
+            for (j = 0; j < job.found[i].n; ++j) {
+                const struct entry *e = &job.found[i].a[j];
+                int p = --job.b_off[e->node + 1];
+                job.b_j[p]    = e->j;
+                job.b_cost[p] = e->cost;
+            }
+            free(job.found[i].a);
+        }
+        /* the decrements above left b_off[v + 1] at the start of
+         * the bucket of v, move them back in place */
+        memmove(job.b_off, job.b_off + 1, n * sizeof *job.b_off);
+        job.b_off[n] = total;
+        if (flags & D_FLAG_DEBUG)
+            printf(F("%ld bucket entries from %d targets\n"),
+                    total, nt);
+
+        run(&job, w, threads, ch_forward);
+        free(job.found);
+        free(job.b_off);
+        free(job.b_j);
+        free(job.b_cost);
+    }
+    free(w);
+    if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END))
+        printf(F("%d x %d matrix computed, %ld nodes settled\n"),
+                ns, nt, job.settled);
+    return job.settled;
+} /* d_matrix */
+
+int
+d_matrix_save(
+        const char       *path,
+        struct d_node   **src,
+        int               ns,
+        struct d_node   **dst,
+        int               nt,
+        const int32_t    *res)
+{
+    struct matrix_header h;
+    int i;
+
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, MATRIX_MAGIC, sizeof h.magic);
+    h.version    = D_MATRIX_VERSION;
+    h.byte_order = MATRIX_BYTE_ORDER;
+    h.rows       = ns;
+    h.cols       = nt;
+
+    /* write to a temporary file, and rename it at the end */
+    size_t plen = strlen(path);
+    char *tmp = malloc(plen + sizeof ".tmp");
+    assert(tmp != NULL);
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", sizeof ".tmp");
+
+    FILE *out = fopen(tmp, "wb");
+    if (!out) {
+        free(tmp);
+        return -1;
+    }
+    int ok = fwrite(&h, sizeof h, 1, out) == 1
+        && fwrite(res, sizeof *res, (size_t)ns * nt, out)
+                == (size_t)ns * nt;
+    for (i = 0; ok && i < ns; ++i)
+        ok = fwrite(src[i]->name, strlen(src[i]->name) + 1, 1, out) == 1;
+    for (i = 0; ok && i < nt; ++i)
+        ok = fwrite(dst[i]->name, strlen(dst[i]->name) + 1, 1, out) == 1;
+    if (fclose(out) != 0) ok = 0;
+    int r = ok ? rename(tmp, path) : -1;
+
+    int e = errno;
+    if (r < 0) unlink(tmp);
+    free(tmp);
+    errno = e;
+    return r;
+} /* d_matrix_save */
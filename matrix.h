@@ -0,0 +1,79 @@
+/* matrix.h -- matrices of minimum costs between sets of nodes.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sun Oct 18 15:07:52 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _MATRIX_H
+#define _MATRIX_H
+
+#include <stdint.h>
+
+#include "dijkstra.h"
+
+#define D_MATRIX_VERSION    1          /* version of the file format */
+
+/**
+ * Compute the minimum costs from each node of a set of sources to
+ * each node of a set of targets.
+ *
+ * If the graph has a contraction hierarchy (see ch.h), the work
+ * is shared among sources: an upward search is run backwards from
+ * each target, leaving its cost in a bucket at every node it
+ * settles, and then an upward search from each source collects
+ * the costs from the buckets of the nodes it settles, so each
+ * search runs once, not once per pair.  Otherwise, a search is
+ * run from each source, until all the targets are settled.
+ *
+ * The searches are spread among threads, each one with its own
+ * query (see d_query_new()), so the graph must not be modified
+ * meanwhile.
+ *
+ * @param graph is the graph, that is frozen if not already.
+ * @param src is the array of ns sources.
+ * @param dst is the array of nt targets.
+ * @param res is an array of ns * nt entries, where res[i * nt + j]
+ *        gets the minimum cost from src[i] to dst[j], or -1 if
+ *        dst[j] cannot be reached from src[i] (paths costing more
+ *        than INT_MAX are dropped, as with D_COSTS_CHECKED).
+ * @param threads is the number of threads to use.
+ * @return the number of nodes settled by all the searches.
+ */
+long
+d_matrix(
+        struct d_graph   *graph,
+        struct d_node   **src,
+        int               ns,
+        struct d_node   **dst,
+        int               nt,
+        int32_t          *res,
+        int               threads,
+        int               flags);
+
+/**
+ * Save a matrix of costs in a binary file.
+ *
+ * The file has a header (a magic string, the format version, a
+ * byte order mark and the number of rows and columns), then the
+ * rows * cols costs, as 32 bit integers in the byte order of the
+ * machine, row after row, and then the names of the sources and
+ * of the targets, each one ended by a nul character.  The file is
+ * written under a temporary name, and renamed at the end.
+ *
+ * @param path is the name of the file.
+ * @param src are the ns nodes of the rows.
+ * @param dst are the nt nodes of the columns.
+ * @param res are the costs, as d_matrix() returns them.
+ * @return 0 on success, -1 on error (errno tells why).
+ */
+int
+d_matrix_save(
+        const char       *path,
+        struct d_node   **src,
+        int               ns,
+        struct d_node   **dst,
+        int               nt,
+        const int32_t    *res);
+
+#endif /* _MATRIX_H */
@@ -0,0 +1,154 @@
+/* order.c -- renumbering of the nodes of a graph, so the nodes
+ *            near in the graph are near in memory.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Tue Oct 20 12:14:03 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * Nodes get their ids in the order their names first appear in
+ * the input, so the costs, stamps and links of the neighbours of
+ * a node are scattered all over the arrays of the frozen layout
+ * and of the queries.  Renumbering them in breadth first order
+ * from some node (or in reverse Cuthill-McKee order, that also
+ * visits first the neighbours of lower degree) gives the
+ * neighbours of a node ids near its own, so a search touches
+ * less cache lines and pages.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "graph.h"
+#include "order.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+/* breadth first order of the nodes, starting each component at
+ * the first node not yet visited of start[].  With by_degree, the
+ * neighbours of each node are visited in increasing degree.
+ * ord[] gets the old ids, in the new order. */
+static void
+bfs_order(
+        struct d_node   **tab,
+        int               n,
+        const int        *start,
+        int               by_degree,
+        int              *ord)
+{
+    char *seen = calloc(n ? n : 1, 1);
+    int head = 0, tail = 0, s;
+    assert(seen != NULL);
+
+    for (s = 0; s < n; ++s) {
+        if (seen[start[s]]) continue;
+        seen[start[s]] = 1;
+        ord[tail++] = start[s];
+        while (head < tail) {
+            struct d_node *nod = tab[ord[head++]];
+            struct d_link *l, *end = nod->next + nod->next_n;
+            int first = tail, i, j;
+            for (l = nod->next; l < end; ++l) {
+                int v = l->to->id;
+                if (seen[v]) continue;
+                seen[v] = 1;
+                ord[tail++] = v;
+            }
+            if (!by_degree) continue;
+            /* insertion sort of the new ones, most nodes have
+             * a few neighbours */
+            for (i = first + 1; i < tail; ++i) {
+                int v = ord[i], dv = tab[v]->next_n;
+                for (j = i; j > first && tab[ord[j - 1]]->next_n > dv; --j)
+                    ord[j] = ord[j - 1];
+                ord[j] = v;
+            }
+        }
+    }
+    free(seen);
+} /* bfs_order */
+
+void
+d_order_nodes(
+        struct d_graph   *graph,
+        int               kind,
+        int               flags)
+{
+    struct d_node **tab = graph->tab;
+    int n = graph->nodes, i;
+
+    assert(graph->csr == NULL);
+    if (kind == D_ORDER_NONE || n <= 0) return;
+
+    int *start = malloc(n * sizeof *start);
+    int *ord   = malloc(n * sizeof *ord);
+    uint32_t *new_id = malloc(n * sizeof *new_id);
+    assert(start && ord && new_id);
+
+    if (kind == D_ORDER_RCM) {
+        /* components start at a node of minimum degree, a cheap
+         * approximation of a peripheral node: counting sort of the
+         * nodes by degree */
+        int max_d = 0, *cnt;
+        for (i = 0; i < n; ++i)
+            if (tab[i]->next_n > max_d)
+                max_d = tab[i]->next_n;
+        cnt = calloc(max_d + 2, sizeof *cnt);
+        assert(cnt != NULL);
+        for (i = 0; i < n; ++i)
+            cnt[tab[i]->next_n + 1]++;
+        for (i = 1; i <= max_d + 1; ++i)
+            cnt[i] += cnt[i - 1];
+        for (i = 0; i < n; ++i)
+            start[cnt[tab[i]->next_n]++] = i;
+        free(cnt);
+    } else {
+        for (i = 0; i < n; ++i)
+            start[i] = i;
+    }
+    bfs_order(tab, n, start, kind == D_ORDER_RCM, ord);
+    if (kind == D_ORDER_RCM) {
+        /* the reverse, as the linear algebra folks do */
+        for (i = 0; i < n / 2; ++i) {
+            int t = ord[i];
+            ord[i] = ord[n - 1 - i];
+            ord[n - 1 - i] = t;
+        }
+    }
+
+    struct d_node **old = malloc(n * sizeof *old);
+    assert(old != NULL);
+    memcpy(old, tab, n * sizeof *old);
+    for (i = 0; i < n; ++i) {
+        new_id[ord[i]] = i;
+        tab[i] = old[ord[i]];
+        tab[i]->id = i;
+    }
+    d_hindex_renumber(&graph->idx, new_id);
+    /* the nodes published by the last query */
+    for (i = 0; i < graph->pub_n; ++i)
+        graph->pub[i] = new_id[graph->pub[i]];
+
+    if (flags & (D_FLAG_DEBUG | D_FLAG_FREEZE))
+        printf(F("Graph %s, %d nodes renumbered in %s order\n"),
+                graph->name, n,
+                kind == D_ORDER_RCM ? "reverse Cuthill-McKee" : "BFS");
+    free(old);
+    free(new_id);
+    free(ord);
+    free(start);
+} /* d_order_nodes */
+
+double
+d_order_gap(
+        const struct d_csr *csr)
+{
+    double sum = 0.0;
+    uint32_t u, e;
+
+    for (u = 0; u < csr->n; ++u)
+        for (e = csr->off[u]; e < csr->off[u + 1]; ++e)
+            sum += csr->tgt[e] > u ? csr->tgt[e] - u : u - csr->tgt[e];
+    return csr->m ? sum / csr->m : 0.0;
+} /* d_order_gap */
@@ -0,0 +1,47 @@
+/* order.h -- renumbering of the nodes of a graph, so the nodes
+ *            near in the graph are near in memory.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Tue Oct 20 12:14:03 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * This is an internal header, shared by the modules of the
+ * library (and the benchmark).  Users of the library select the
+ * order with d_set_order(), in dijkstra.h
+ */
+
+#ifndef _ORDER_H
+#define _ORDER_H
+
+#include "dijkstra.h"
+#include "csr.h"
+
+/**
+ * Renumber the nodes of a graph in the order given.
+ *
+ * The ids of the nodes change (and so their places in the table of
+ * nodes, in the index of names and in the frozen layout built
+ * after this), the nodes and their links don't.  The graph must
+ * not be frozen (d_freeze() calls this before building the
+ * layout).
+ *
+ * @param kind is one of the D_ORDER_* constants, D_ORDER_NONE
+ *        does nothing.
+ */
+void
+d_order_nodes(
+        struct d_graph   *graph,
+        int               kind,
+        int               flags);
+
+/**
+ * @return the mean distance between the ids of the ends of the
+ *         links of a frozen layout.  The lower, the more links go
+ *         to nodes stored near their origin, and the less cache
+ *         misses a search has.
+ */
+double
+d_order_gap(
+        const struct d_csr *csr);
+
+#endif /* _ORDER_H */
@@ -0,0 +1,1226 @@
+/* query.c -- reentrant queries on a frozen graph.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Fri Oct 16 13:05:44 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * A query holds all the state of a run of the algorithm, so the
+ * graph is only read, and can be shared by as many queries as
+ * needed (e.g. one per thread).
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "graph.h"
+#include "alt.h"
+#include "delta.h"
+#include "relax.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+/* steps of a route printed without allocating */
+#define ROUTE_STACK         64
+
+static void *
+xrealloc(void *p, size_t n)
+{
+    p = realloc(p, n);
+    assert(p != NULL);
+    return p;
+} /* xrealloc */
+
+/* adjust the size of the arrays to the frozen layout of the
+ * graph. */
+static void
+q_fit(struct d_query *q)
+{
+    int n = q->graph->csr->n;
+    if (n <= q->cap) return;
+
+    q->cost  = xrealloc(q->cost,  n * sizeof *q->cost);
+    q->back  = xrealloc(q->back,  n * sizeof *q->back);
+    q->order = xrealloc(q->order, n * sizeof *q->order);
+    q->stamp = xrealloc(q->stamp, n * sizeof *q->stamp);
+    memset(q->stamp + q->cap, 0, (n - q->cap) * sizeof *q->stamp);
+    d_heap_grow(q->heap, n);
+    if (q->rheap) {
+        q->rcost  = xrealloc(q->rcost,  n * sizeof *q->rcost);
+        q->rback  = xrealloc(q->rback,  n * sizeof *q->rback);
+        q->rstamp = xrealloc(q->rstamp, n * sizeof *q->rstamp);
+        memset(q->rstamp + q->cap, 0,
+                (n - q->cap) * sizeof *q->rstamp);
+        d_heap_grow(q->rheap, n);
+    }
+    if (q->hval)
+        q->hval = xrealloc(q->hval, n * sizeof *q->hval);
+    if (q->jump)
+        q->jump = xrealloc(q->jump, n * sizeof *q->jump);
+    if (q->wcost)
+        q->wcost = xrealloc(q->wcost, n * sizeof *q->wcost);
+    q->cap = n;
+} /* q_fit */
+
+struct d_query *
+d_query_new(
+        struct d_graph   *graph,
+        int               flags)
+{
+    d_freeze(graph, flags);
+
+    struct d_query *res = calloc(1, sizeof *res);
+    assert(res != NULL);
+    res->graph = graph;
+    res->heap  = d_graph_heap_new(graph, graph->csr->n);
+    res->epoch = 2;
+    res->orig  = -1;
+    q_fit(res);
+    return res;
+} /* d_query_new */
+
+void
+d_query_free(
+        struct d_query   *q)
+{
+    if (!q) return;
+    d_heap_free(q->heap);
+    d_heap_free(q->rheap);
+    free(q->rcost);
+    free(q->rback);
+    free(q->rstamp);
+    free(q->hval);
+    free(q->path);
+    free(q->jump);
+    free(q->wcost);
+    free(q->cost);
+    free(q->back);
+    free(q->stamp);
+    free(q->order);
+    free(q);
+} /* d_query_free */
+
+void
+d_query_start(
+        struct d_query   *q)
+{
+#if D_STATS
+    double t0 = d_stats_now();
+#endif
+    assert(q->graph->csr != NULL); /* graph must be frozen */
+    q_fit(q);
+    if (q->epoch >= UINT32_MAX - 2) {
+        memset(q->stamp, 0, q->cap * sizeof *q->stamp);
+        if (q->rstamp)
+            memset(q->rstamp, 0, q->cap * sizeof *q->rstamp);
+        q->epoch = 0;
+    }
+    q->epoch    += 2;
+    q->settled   = 0;
+    q->r_settled = 0;
+    q->wide      = 0;
+    d_heap_clear(q->heap);
+#if D_STATS
+    q->stats.t_setup += d_stats_now() - t0;
+#endif
+} /* d_query_start */
+
+/* variants of the one directional search, see forward.h, by
+ * [arithmetic of the costs][traces][destination] */
+#define FW_NAME q_fwd
+#define FW_TRACE 0
+#define FW_DEST 0
+#define FW_CHECKED 0
+#define FW_WIDE 0
+#include "forward.h"
+#define FW_NAME q_fwd_dest
+#define FW_TRACE 0
+#define FW_DEST 1
+#define FW_CHECKED 0
+#define FW_WIDE 0
+#include "forward.h"
+#define FW_NAME q_fwd_trace
+#define FW_TRACE 1
+#define FW_DEST 0
+#define FW_CHECKED 0
+#define FW_WIDE 0
+#include "forward.h"
+#define FW_NAME q_fwd_trace_dest
+#define FW_TRACE 1
+#define FW_DEST 1
+#define FW_CHECKED 0
+#define FW_WIDE 0
+#include "forward.h"
+#define FW_NAME q_fwd_chk
+#define FW_TRACE 0
+#define FW_DEST 0
+#define FW_CHECKED 1
+#define FW_WIDE 0
+#include "forward.h"
+#define FW_NAME q_fwd_chk_dest
+#define FW_TRACE 0
+#define FW_DEST 1
+#define FW_CHECKED 1
+#define FW_WIDE 0
+#include "forward.h"
+#define FW_NAME q_fwd_chk_trace
+#define FW_TRACE 1
+#define FW_DEST 0
+#define FW_CHECKED 1
+#define FW_WIDE 0
+#include "forward.h"
+#define FW_NAME q_fwd_chk_trace_dest
+#define FW_TRACE 1
+#define FW_DEST 1
+#define FW_CHECKED 1
+#define FW_WIDE 0
+#include "forward.h"
+#define FW_NAME q_fwd_wide
+#define FW_TRACE 0
+#define FW_DEST 0
+#define FW_CHECKED 0
+#define FW_WIDE 1
+#include "forward.h"
+#define FW_NAME q_fwd_wide_dest
+#define FW_TRACE 0
+#define FW_DEST 1
+#define FW_CHECKED 0
+#define FW_WIDE 1
+#include "forward.h"
+#define FW_NAME q_fwd_wide_trace
+#define FW_TRACE 1
+#define FW_DEST 0
+#define FW_CHECKED 0
+#define FW_WIDE 1
+#include "forward.h"
+#define FW_NAME q_fwd_wide_trace_dest
+#define FW_TRACE 1
+#define FW_DEST 1
+#define FW_CHECKED 0
+#define FW_WIDE 1
+#include "forward.h"
+
+/* arithmetics of the costs, the first index of q_fwd_variants */
+#define Q_INT               0
+#define Q_CHECKED           1
+#define Q_WIDE              2
+
+static int
+(*const q_fwd_variants[3][2][2])(
+        struct d_query *, struct d_node *, struct d_node *, int) = {
+    { { q_fwd,            q_fwd_dest },
+      { q_fwd_trace,      q_fwd_trace_dest } },
+    { { q_fwd_chk,        q_fwd_chk_dest },
+      { q_fwd_chk_trace,  q_fwd_chk_trace_dest } },
+    { { q_fwd_wide,       q_fwd_wide_dest },
+      { q_fwd_wide_trace, q_fwd_wide_trace_dest } },
+};
+
+/* flags that print traces in the one directional search */
+#define FW_TRACE_FLAGS      (D_FLAG_DEBUG | D_FLAG_ADD_NODE_FRONTIER \
+                           | D_FLAG_PASS_START | D_FLAG_PASS_END)
+
+/* the arithmetic of the costs of the searches on the graph, see
+ * d_set_costs() */
+static int
+q_arith(struct d_graph *g)
+{
+    switch (g->costs) {
+    case D_COSTS_INT:     return Q_INT;
+    case D_COSTS_CHECKED: return Q_CHECKED;
+    case D_COSTS_INT64:   return Q_WIDE;
+    }
+    /* D_COSTS_AUTO */
+    return d_csr_cost_bound(g->csr) > INT_MAX ? Q_WIDE : Q_INT;
+} /* q_arith */
+
+/* the strategies other than the one directional search sum their
+ * costs in int: with 64 bit costs they are run checking them, as
+ * with D_COSTS_CHECKED, and this warns once per graph about it */
+static void
+q_narrow(struct d_graph *g, int arith, const char *what)
+{
+    if (arith == Q_WIDE
+            && !__atomic_exchange_n(&g->narrowed, 1, __ATOMIC_RELAXED))
+        fprintf(stderr, F("WARNING: %s: the %s search has int costs, "
+                "paths costing more than %d are dropped\n"),
+                g->name, what, INT_MAX);
+} /* q_narrow */
+
+/* one directional search, from orig until dest (if not NULL) is
+ * settled, with the variant for the arithmetic and flags given */
+static int
+q_run_forward(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               arith,
+        int               flags)
+{
+    if (arith == Q_WIDE && !q->wcost)
+        q->wcost = xrealloc(NULL, q->cap * sizeof *q->wcost);
+    return q_fwd_variants
+            [arith]
+            [(flags & FW_TRACE_FLAGS) != 0]
+            [dest != NULL](q, orig, dest, flags);
+} /* q_run_forward */
+
+int
+d_query_forward(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+    int arith = q_arith(q->graph);
+    return q_run_forward(q, orig, dest,
+            arith == Q_WIDE ? Q_CHECKED : arith, flags);
+} /* d_query_forward */
+
+int
+d_query_forward_checked(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+    return q_run_forward(q, orig, dest, Q_CHECKED, flags);
+} /* d_query_forward_checked */
+
+/* allocates the state of the backward search */
+static void
+q_rfit(struct d_query *q)
+{
+    if (q->rheap) return;
+    q_fit(q);
+    q->rheap  = d_graph_heap_new(q->graph, q->cap);
+    q->rcost  = xrealloc(NULL, q->cap * sizeof *q->rcost);
+    q->rback  = xrealloc(NULL, q->cap * sizeof *q->rback);
+    q->rstamp = calloc(q->cap, sizeof *q->rstamp);
+    assert(q->rstamp != NULL);
+} /* q_rfit */
+
+/* prepares the query for a bidirectional search: builds the
+ * reverse adjacency of the graph, if needed, and the state of the
+ * backward search. */
+static void
+q_bidir_fit(struct d_query *q)
+{
+    struct d_graph *g = q->graph;
+    struct d_csr *csr = g->csr;
+
+    if (!__atomic_load_n(&csr->r_off, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&g->mtx);
+        d_csr_build_reverse(csr);
+        pthread_mutex_unlock(&g->mtx);
+    }
+    q_rfit(q);
+} /* q_bidir_fit */
+
+/* bidirectional search.  mu is the cost of the best path found
+ * so far, through the link (mf, mb) that joins both searches.
+ * Once the searches are done, the path from mb to dest is copied
+ * into the forward state, so the results are read as in a one
+ * directional search. */
+static int
+q_run_bidir(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+    q_bidir_fit(q);
+    d_query_start(q);
+    d_heap_clear(q->rheap);
+
+    const struct d_csr *csr    = q->graph->csr;
+    const uint32_t     *off    = csr->off;
+    const uint32_t     *tgt    = csr->tgt;
+    const int32_t      *wgt    = csr->wgt;
+    const uint32_t     *r_off  = csr->r_off;
+    const uint32_t     *r_src  = csr->r_src;
+    const int32_t      *r_wgt  = csr->r_wgt;
+    int                *cost   = q->cost;
+    int                *back   = q->back;
+    uint32_t           *stamp  = q->stamp;
+    int                *rcost  = q->rcost;
+    int                *rback  = q->rback;
+    uint32_t           *rstamp = q->rstamp;
+    uint32_t            ep     = q->epoch;
+    int                 d      = dest->id;
+    struct d_stats     *st     = &q->stats;
+
+    if (flags & (D_FLAG_DEBUG | D_FLAG_ADD_NODE_FRONTIER))
+        printf(F("Add start node %s and end node %s to the "
+                "frontiers\n"), orig->name, dest->name);
+    q->orig          = orig->id;
+    cost[orig->id]   = 0;
+    back[orig->id]   = -1;
+    stamp[orig->id]  = ep;
+    d_heap_push(q->heap, orig->id, 0);
+    rcost[d]         = 0;
+    rback[d]         = -1;
+    rstamp[d]        = ep;
+    d_heap_push(q->rheap, d, 0);
+
+    /* paths costing more than an int holds are dropped */
+    long long mu = (long long)INT_MAX + 1;
+    int mf = -1, mb = -1;
+    for (;;) {
+        int64_t kf, kb;
+        if (d_heap_peek(q->heap, &kf) < 0
+                || d_heap_peek(q->rheap, &kb) < 0)
+            break;
+        if (kf + kb >= mu)
+            break; /* no better path can be found */
+
+        if (kf <= kb) {
+            int u = d_heap_pop(q->heap, NULL);
+            stamp[u] = ep + 1;
+            q->order[q->settled++] = u;
+            if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_START))
+                printf(F("Pass #%d START, forward node %s(c=%d)\n"),
+                        q->settled + q->r_settled,
+                        d_csr_name(csr, u), cost[u]);
+
+            uint32_t e, end = off[u + 1];
+            int cu = cost[u];
+            STAT(st->scanned += end - off[u]);
+            for (e = off[u]; e < end; ++e) {
+                uint32_t v = tgt[e];
+                if ((long long)cu + wgt[e] > INT_MAX) {
+                    STAT(st->overflows++);
+                    continue;
+                }
+                int new_cost = cu + wgt[e];
+                if (Q_R_SEEN(q, v) && (long long)new_cost + rcost[v] < mu) {
+                    mu = (long long)new_cost + rcost[v];
+                    mf = u;
+                    mb = v;
+                }
+                if (stamp[v] != ep) {
+                    if (stamp[v] == ep + 1) {
+                        STAT(st->visited++);
+                        continue; /* already settled */
+                    }
+                    stamp[v] = ep;
+                } else if (new_cost >= cost[v]) {
+                    continue;
+                }
+                cost[v] = new_cost;
+                back[v] = u;
+                d_heap_push(q->heap, v, new_cost);
+                STAT(st->improved++);
+            }
+            STAT(d_stats_frontier(st, d_heap_size(q->heap)));
+        } else {
+            int u = d_heap_pop(q->rheap, NULL);
+            rstamp[u] = ep + 1;
+            q->r_settled++;
+            if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_START))
+                printf(F("Pass #%d START, backward node %s(c=%d)\n"),
+                        q->settled + q->r_settled,
+                        d_csr_name(csr, u), rcost[u]);
+
+            uint32_t e, end = r_off[u + 1];
+            int cu = rcost[u];
+            STAT(st->scanned += end - r_off[u]);
+            for (e = r_off[u]; e < end; ++e) {
+                uint32_t v = r_src[e];
+                if ((long long)cu + r_wgt[e] > INT_MAX) {
+                    STAT(st->overflows++);
+                    continue;
+                }
+                int new_cost = cu + r_wgt[e];
+                if (Q_SEEN(q, v) && (long long)new_cost + cost[v] < mu) {
+                    mu = (long long)new_cost + cost[v];
+                    mf = v;
+                    mb = u;
+                }
+                if (rstamp[v] != ep) {
+                    if (rstamp[v] == ep + 1) {
+                        STAT(st->visited++);
+                        continue; /* already settled */
+                    }
+                    rstamp[v] = ep;
+                } else if (new_cost >= rcost[v]) {
+                    continue;
+                }
+                rcost[v] = new_cost;
+                rback[v] = u;
+                d_heap_push(q->rheap, v, new_cost);
+                STAT(st->improved++);
+            }
+            STAT(d_stats_frontier(st, d_heap_size(q->rheap)));
+        }
+    }
+    STAT(st->passes += q->settled + q->r_settled);
+
+    if (mf >= 0) {
+        /* copy the path mf -> mb -> ... -> dest into the forward
+         * state.  Nodes already settled by the forward search
+         * keep their (equally good) parents. */
+        int prev = mf, v = mb;
+        if (!Q_SETTLED(q, mf)) {
+            stamp[mf] = ep + 1;
+            q->order[q->settled++] = mf;
+        }
+        for (;;) {
+            if (!Q_SETTLED(q, v)) {
+                cost[v]  = mu - rcost[v];
+                back[v]  = prev;
+                stamp[v] = ep + 1;
+                q->order[q->settled++] = v;
+            }
+            if (v == d) break;
+            prev = v;
+            v = rback[v];
+        }
+    }
+    if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END)) {
+        printf(F("Pass #%d END (%d + %d nodes in the frontiers)\n"),
+                q->settled + q->r_settled,
+                d_heap_size(q->heap), d_heap_size(q->rheap));
+    }
+    STAT(st->settled += q->settled);
+    return q->settled + q->r_settled;
+} /* q_run_bidir */
+
+/* a value of the heuristic of d_set_heuristic(), as kept in hval */
+static inline int64_t
+q_hval(int h)
+{
+    return h == INT_MAX ? D_ALT_INF : h;
+} /* q_hval */
+
+/* A* search.  Costs are checked ints, as with D_COSTS_CHECKED, and
+ * a node is not put in the frontier if the bound of the heuristic
+ * says that the paths to dest through it cost more than INT_MAX. */
+static int
+q_run_astar(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int             (*heuristic)(
+                                struct d_node *,
+                                struct d_node *,
+                                void *),
+        void             *calldata,
+        int               flags)
+{
+    if (!dest || !heuristic)
+        return q_run_forward(q, orig, dest, q_arith(q->graph), flags);
+
+    d_query_start(q);
+    if (!q->hval)
+        q->hval = xrealloc(NULL, q->cap * sizeof *q->hval);
+
+    struct d_graph     *g     = q->graph;
+    const struct d_csr *csr   = g->csr;
+    const uint32_t     *off   = csr->off;
+    const uint32_t     *tgt   = csr->tgt;
+    const int32_t      *wgt   = csr->wgt;
+    int                *cost  = q->cost;
+    int                *back  = q->back;
+    int64_t            *hval  = q->hval;
+    uint32_t           *stamp = q->stamp;
+    uint32_t            ep    = q->epoch;
+    int                 d     = dest->id;
+    struct d_stats     *st    = &q->stats;
+
+    /* the landmark heuristic works on the ids, without going
+     * through the d_node structures */
+    const struct d_alt *alt = heuristic == d_alt_heuristic
+            && ((struct d_alt *)calldata)->graph == g
+            ? calldata
+            : NULL;
+#define H(_v) (alt  ? d_alt_bound(alt, (_v), d) \
+                    : q_hval(heuristic(d_node_by_id(g, (_v)), dest, \
+                            calldata)))
+
+    if (flags & (D_FLAG_DEBUG | D_FLAG_ADD_NODE_FRONTIER))
+        printf(F("Add start node %s to the frontier\n"),
+                orig->name);
+    q->orig         = orig->id;
+    cost[orig->id]  = 0;
+    back[orig->id]  = -1;
+    stamp[orig->id] = ep;
+    hval[orig->id]  = H(orig->id);
+    d_heap_push(q->heap, orig->id, 0); /* alone, any key will do */
+
+    int u;
+    while ((u = d_heap_pop(q->heap, NULL)) >= 0) {
+        stamp[u] = ep + 1;
+        q->order[q->settled++] = u;
+        if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_START))
+            printf(F("Pass #%d START, node %s(c=%d, h=%lld) "
+                    "(%d nodes in the frontier)\n"),
+                    q->settled, d_csr_name(csr, u), cost[u],
+                    (long long)hval[u], d_heap_size(q->heap));
+        if (u == d) break;
+
+        uint32_t e, end = off[u + 1];
+        int cu = cost[u];
+        STAT(st->scanned += end - off[u]);
+        for (e = off[u]; e < end; ++e) {
+            uint32_t v = tgt[e];
+            if ((long long)cu + wgt[e] > INT_MAX) {
+                STAT(st->overflows++);
+                continue;
+            }
+            int new_cost = cu + wgt[e];
+            if (stamp[v] != ep) {
+                if (stamp[v] == ep + 1) {
+                    STAT(st->visited++);
+                    continue; /* already settled */
+                }
+                stamp[v] = ep;
+                hval[v]  = H(v);
+            } else if (new_cost >= cost[v]) {
+                continue;
+            }
+            cost[v] = new_cost;
+            back[v] = u;
+            STAT(st->improved++);
+            if (hval[v] > INT_MAX - new_cost)
+                continue; /* dest cannot be reached from v, or only
+                           * paying more than an int holds */
+            d_heap_push(q->heap, v, new_cost + hval[v]);
+        }
+        STAT(d_stats_frontier(st, d_heap_size(q->heap)));
+    }
+#undef H
+    if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END)) {
+        printf(F("Pass #%d END (%d nodes in the frontier)\n"),
+                q->settled, d_heap_size(q->heap));
+    }
+    STAT(st->passes += q->settled);
+    STAT(st->settled += q->settled);
+    return q->settled;
+} /* q_run_astar */
+
+/* finds the link from a to b in the hierarchy, that is in the up
+ * links of a or in the down links of b, depending on their rank */
+static void
+ch_link(const struct d_ch *ch, int a, int b, int *w, int *via)
+{
+    uint32_t e;
+
+    if (ch->rank[a] < ch->rank[b]) {
+        for (e = ch->up_off[a]; ch->up_tgt[e] != (uint32_t)b; ++e)
+            assert(e < ch->up_off[a + 1]);
+        *w   = ch->up_wgt[e];
+        *via = ch->up_via[e];
+    } else {
+        for (e = ch->dn_off[b]; ch->dn_src[e] != (uint32_t)a; ++e)
+            assert(e < ch->dn_off[b + 1]);
+        *w   = ch->dn_wgt[e];
+        *via = ch->dn_via[e];
+    }
+} /* ch_link */
+
+/* makes room for n more entries in q->path */
+static void
+q_path_room(struct d_query *q, int n)
+{
+    if (q->path_n + n <= q->path_cap) return;
+    while (q->path_n + n > q->path_cap)
+        q->path_cap = q->path_cap ? 2 * q->path_cap : 256;
+    q->path = xrealloc(q->path, q->path_cap * sizeof *q->path);
+} /* q_path_room */
+
+/* query on the contraction hierarchy: both searches only go up
+ * in rank, and they don't expand nodes that can be reached
+ * cheaper from a higher ranked node (stall on demand).  The best
+ * path found, through the meeting node, is unpacked into the
+ * forward state, as a one directional search would leave it. */
+static int
+q_run_ch(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+    const struct d_ch  *ch     = q->graph->ch;
+
+    q_rfit(q);
+    d_query_start(q);
+    d_heap_clear(q->rheap);
+
+    int                *cost   = q->cost;
+    int                *back   = q->back;
+    uint32_t           *stamp  = q->stamp;
+    int                *rcost  = q->rcost;
+    int                *rback  = q->rback;
+    uint32_t           *rstamp = q->rstamp;
+    uint32_t            ep     = q->epoch;
+    int                 s      = orig->id;
+    int                 d      = dest->id;
+    int                 fwd    = 0;   /* side to expand */
+    int                 f_done = 0, b_done = 0, f_n = 0, b_n = 0;
+    struct d_stats     *st     = &q->stats;
+
+    cost[s]   = 0;
+    back[s]   = -1;
+    stamp[s]  = ep;
+    d_heap_push(q->heap, s, 0);
+    rcost[d]  = 0;
+    rback[d]  = -1;
+    rstamp[d] = ep;
+    d_heap_push(q->rheap, d, 0);
+
+    /* paths costing more than an int holds are dropped */
+    long long mu = (long long)INT_MAX + 1;
+    int meet = -1;
+    while (!f_done || !b_done) {
+        fwd = b_done || (!f_done && !fwd);
+        int64_t k;
+        int u;
+        uint32_t e;
+        if (fwd) {
+            if (d_heap_peek(q->heap, &k) < 0 || k >= mu) {
+                f_done = 1;
+                continue;
+            }
+            u = d_heap_pop(q->heap, NULL);
+            stamp[u] = ep + 1;
+            f_n++;
+            if (Q_R_SEEN(q, u) && (long long)cost[u] + rcost[u] < mu) {
+                mu   = (long long)cost[u] + rcost[u];
+                meet = u;
+            }
+            /* stalled if a higher node reaches it cheaper */
+            for (e = ch->dn_off[u]; e < ch->dn_off[u + 1]; ++e) {
+                int x = ch->dn_src[e];
+                if (Q_SEEN(q, x)
+                        && (long long)cost[x] + ch->dn_wgt[e] < cost[u])
+                    break;
+            }
+            if (e < ch->dn_off[u + 1]) continue;
+            STAT(st->scanned += ch->up_off[u + 1] - ch->up_off[u]);
+            for (e = ch->up_off[u]; e < ch->up_off[u + 1]; ++e) {
+                int v = ch->up_tgt[e];
+                if ((long long)cost[u] + ch->up_wgt[e] > INT_MAX) {
+                    STAT(st->overflows++);
+                    continue;
+                }
+                int nc = cost[u] + ch->up_wgt[e];
+                if (stamp[v] != ep) {
+                    if (stamp[v] == ep + 1) {
+                        STAT(st->visited++);
+                        continue;
+                    }
+                    stamp[v] = ep;
+                } else if (nc >= cost[v]) {
+                    continue;
+                }
+                cost[v] = nc;
+                back[v] = u;
+                d_heap_push(q->heap, v, nc);
+                STAT(st->improved++);
+            }
+            STAT(d_stats_frontier(st, d_heap_size(q->heap)));
+        } else {
+            if (d_heap_peek(q->rheap, &k) < 0 || k >= mu) {
+                b_done = 1;
+                continue;
+            }
+            u = d_heap_pop(q->rheap, NULL);
+            rstamp[u] = ep + 1;
+            b_n++;
+            if (Q_SEEN(q, u) && (long long)cost[u] + rcost[u] < mu) {
+                mu   = (long long)cost[u] + rcost[u];
+                meet = u;
+            }
+            for (e = ch->up_off[u]; e < ch->up_off[u + 1]; ++e) {
+                int x = ch->up_tgt[e];
+                if (Q_R_SEEN(q, x)
+                        && (long long)rcost[x] + ch->up_wgt[e] < rcost[u])
+                    break;
+            }
+            if (e < ch->up_off[u + 1]) continue;
+            STAT(st->scanned += ch->dn_off[u + 1] - ch->dn_off[u]);
+            for (e = ch->dn_off[u]; e < ch->dn_off[u + 1]; ++e) {
+                int v = ch->dn_src[e];
+                if ((long long)rcost[u] + ch->dn_wgt[e] > INT_MAX) {
+                    STAT(st->overflows++);
+                    continue;
+                }
+                int nc = rcost[u] + ch->dn_wgt[e];
+                if (rstamp[v] != ep) {
+                    if (rstamp[v] == ep + 1) {
+                        STAT(st->visited++);
+                        continue;
+                    }
+                    rstamp[v] = ep;
+                } else if (nc >= rcost[v]) {
+                    continue;
+                }
+                rcost[v] = nc;
+                rback[v] = u;
+                d_heap_push(q->rheap, v, nc);
+                STAT(st->improved++);
+            }
+            STAT(d_stats_frontier(st, d_heap_size(q->rheap)));
+        }
+    }
+    STAT(st->passes += f_n + b_n);
+    if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END))
+        printf(F("CH search END, %d + %d nodes settled, meeting at "
+                "%s\n"), f_n, b_n,
+                meet >= 0 ? d_csr_name(q->graph->csr, meet) : "<none>");
+
+    /* the path in the hierarchy, from dest back to orig */
+    int v;
+    q->path_n = 0;
+    if (meet >= 0) {
+        for (v = meet; v >= 0; v = rback[v]) {
+            q_path_room(q, 1);
+            q->path[q->path_n++] = v;
+        }
+        /* reverse it, so orig is on top of the stack */
+        int i, j;
+        for (i = 0, j = q->path_n - 1; i < j; ++i, --j) {
+            int t = q->path[i];
+            q->path[i] = q->path[j];
+            q->path[j] = t;
+        }
+        for (v = back[meet]; v >= 0; v = back[v]) {
+            q_path_room(q, 1);
+            q->path[q->path_n++] = v;
+        }
+    }
+
+    /* new epoch, only the nodes of the path will be reached */
+    d_query_start(q);
+    ep = q->epoch;
+    q->r_settled = f_n + b_n;
+    q->orig      = s;
+    if (q->path_n == 0) {
+        /* dest not reached, only orig is */
+        cost[s]  = 0;
+        back[s]  = -1;
+        stamp[s] = ep + 1;
+        q->order[q->settled++] = s;
+        STAT(st->settled += q->settled);
+        return q->r_settled;
+    }
+
+    /* unpack the links of the path, with the stack in q->path:
+     * each entry is a node, and the link to unpack goes from the
+     * node below it to it */
+    int prev = q->path[--q->path_n];
+    cost[prev]  = 0;
+    back[prev]  = -1;
+    stamp[prev] = ep + 1;
+    q->order[q->settled++] = prev;
+    while (q->path_n > 0) {
+        int b = q->path[q->path_n - 1], w, via;
+        ch_link(ch, prev, b, &w, &via);
+        if (via >= 0) {
+            /* replace prev -> b by prev -> via -> b */
+            q_path_room(q, 1);
+            q->path[q->path_n++] = via;
+            continue;
+        }
+        q->path_n--;
+        if (stamp[b] != ep + 1) {
+            cost[b]  = cost[prev] + w;
+            back[b]  = prev;
+            stamp[b] = ep + 1;
+            q->order[q->settled++] = b;
+        }
+        prev = b;
+    }
+    STAT(st->settled += q->settled);
+    return q->r_settled;
+} /* q_run_ch */
+
+/* the level of the overlay a search from s to t uses at node u:
+ * one more than the coarsest level where the cell of u has neither
+ * s nor t, or 0 if u is in the cell of s or of t of the finest
+ * level (so the links of the graph are used) */
+static inline int
+crp_level(const struct d_crp *crp, int u, int s, int t)
+{
+    int k;
+    for (k = crp->levels - 1; k >= 0; --k) {
+        const uint32_t *cell = crp->lvl[k].cell;
+        if (cell[u] != cell[s] && cell[u] != cell[t])
+            return k + 1;
+    }
+    return 0;
+} /* crp_level */
+
+static inline void
+crp_relax(
+        struct d_query   *q,
+        int               u,
+        int               v,
+        long long         nc,
+        int               jump)
+{
+    uint32_t ep = q->epoch;
+
+    if (nc > INT_MAX) {
+        STAT(q->stats.overflows++);
+        return;
+    }
+    if (q->stamp[v] != ep) {
+        if (q->stamp[v] == ep + 1) {
+            STAT(q->stats.visited++);
+            return;
+        }
+        q->stamp[v] = ep;
+    } else if (nc >= q->cost[v]) {
+        return;
+    }
+    q->cost[v] = nc;
+    q->back[v] = u;
+    q->jump[v] = jump;
+    d_heap_push(q->heap, v, nc);
+    STAT(q->stats.improved++);
+} /* crp_relax */
+
+/* query on the partition of the graph (see crp.h): the links of
+ * the graph are only followed in the cells of orig and dest of the
+ * finest level, elsewhere the overlay of the coarsest cell without
+ * them takes the search from the entry of the cell to its exits.
+ * The overlay links of the route are unpacked by searches inside
+ * their cells (on the state of the backward search), and the route
+ * is left in the forward state, as q_run_ch() does. */
+static int
+q_run_crp(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+    const struct d_crp *crp    = q->graph->crp;
+    const struct d_csr *csr    = q->graph->csr;
+
+    q_rfit(q);
+    if (!q->jump)
+        q->jump = xrealloc(NULL, q->cap * sizeof *q->jump);
+    d_query_start(q);
+
+    const uint32_t     *off    = csr->off;
+    const uint32_t     *tgt    = csr->tgt;
+    const int32_t      *wgt    = csr->wgt;
+    int                *cost   = q->cost;
+    int                *back   = q->back;
+    uint32_t           *stamp  = q->stamp;
+    uint32_t            ep     = q->epoch;
+    int                 s      = orig->id;
+    int                 d      = dest->id;
+    int                 u, v, n_set = 0;
+    uint32_t            e;
+    struct d_stats     *st     = &q->stats;
+
+    cost[s]    = 0;
+    back[s]    = -1;
+    q->jump[s] = 0;
+    stamp[s]   = ep;
+    d_heap_push(q->heap, s, 0);
+    while ((u = d_heap_pop(q->heap, NULL)) >= 0) {
+        stamp[u] = ep + 1;
+        n_set++;
+        if (u == d) break;
+
+        int k = crp_level(crp, u, s, d);
+        const struct d_crp_level *l = k ? crp->lvl + k - 1 : NULL;
+        long long cu = cost[u];
+        if (l && l->ent_idx[u] >= 0) {
+            /* across the cell */
+            uint32_t c = l->cell[u], j;
+            uint32_t nx = l->ext_off[c + 1] - l->ext_off[c];
+            const int32_t *row = l->mat + l->mat_off[c]
+                + (size_t)l->ent_idx[u] * nx;
+            const uint32_t *ext = l->ext + l->ext_off[c];
+            STAT(st->scanned += nx);
+            for (j = 0; j < nx; ++j)
+                if (row[j] != D_CRP_INF)
+                    crp_relax(q, u, ext[j], cu + row[j], k);
+        }
+        STAT(st->scanned += off[u + 1] - off[u]);
+        for (e = off[u]; e < off[u + 1]; ++e) {
+            /* the links inside the cell are in its overlay */
+            if (l && l->cell[tgt[e]] == l->cell[u]) continue;
+            crp_relax(q, u, tgt[e], cu + wgt[e], 0);
+        }
+        STAT(d_stats_frontier(st, d_heap_size(q->heap)));
+    }
+    STAT(st->passes += n_set);
+    if (flags & (D_FLAG_DEBUG | D_FLAG_PASS_END))
+        printf(F("CRP search END, %d nodes settled\n"), n_set);
+
+    /* the steps of the route, as (node, level + 1 of the overlay
+     * link reaching it) pairs, the first one on top */
+    q->path_n = 0;
+    if (stamp[d] == ep + 1) {
+        for (v = d; back[v] >= 0; v = back[v]) {
+            q_path_room(q, 2);
+            q->path[q->path_n++] = v;
+            q->path[q->path_n++] = q->jump[v];
+        }
+    }
+
+    /* the nodes of the route go to q->order, that the searches of
+     * the unpacking don't use */
+    struct d_crp_search cs = {
+        .dist  = q->rcost,
+        .back  = q->rback,
+        .jump  = q->jump,
+        .stamp = q->rstamp,
+        .heap  = q->rheap,
+    };
+    int m = 0, prev = s, r_n = n_set;
+    q->order[m++] = s;
+    while (q->path_n > 0) {
+        int j = q->path[--q->path_n];
+        int x = q->path[--q->path_n];
+        if (j == 0) {
+            q->order[m++] = prev = x;
+            continue;
+        }
+        /* the route inside the cell of the overlay link, that can
+         * have overlay links of the level below */
+        d_query_start(q);
+        d_heap_clear(q->rheap);
+        cs.ep = q->epoch;
+        r_n += d_crp_cell_search(crp, csr, j - 1, prev, x, &cs);
+        for (v = x; v != prev; v = q->rback[v]) {
+            q_path_room(q, 2);
+            q->path[q->path_n++] = v;
+            q->path[q->path_n++] = q->jump[v];
+        }
+    }
+
+    /* new epoch, only the nodes of the route will be reached */
+    d_query_start(q);
+    ep = q->epoch;
+    q->r_settled = r_n;
+    q->orig      = s;
+    cost[s]  = 0;
+    back[s]  = -1;
+    stamp[s] = ep + 1;
+    q->settled = 1;
+    int i;
+    for (i = 1, prev = s; i < m; ++i) {
+        int b = q->order[i], w = INT_MAX;
+        for (e = off[prev]; e < off[prev + 1]; ++e)
+            if (tgt[e] == (uint32_t)b && wgt[e] < w)
+                w = wgt[e];
+        if (stamp[b] != ep + 1) {
+            cost[b]  = cost[prev] + w;
+            back[b]  = prev;
+            stamp[b] = ep + 1;
+            q->order[q->settled++] = b;
+        }
+        prev = b;
+    }
+    STAT(st->settled += q->settled);
+    return q->r_settled;
+} /* q_run_crp */
+
+/* runs the search given by the graph configuration */
+static int
+q_run(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+    struct d_graph *g = q->graph;
+    int arith = q_arith(g);
+
+    if (dest && dest != orig && g->search == D_SEARCH_BIDIR) {
+        q_narrow(g, arith, "bidirectional");
+        return q_run_bidir(q, orig, dest, flags);
+    }
+    if (dest && dest != orig && g->search == D_SEARCH_CH && g->ch) {
+        q_narrow(g, arith, "contraction hierarchy");
+        return q_run_ch(q, orig, dest, flags);
+    }
+    if (dest && dest != orig && g->search == D_SEARCH_CRP
+            && g->crp && g->crp->customized) {
+        q_narrow(g, arith, "overlay");
+        return q_run_crp(q, orig, dest, flags);
+    }
+    if (!dest && g->d_threads > 1) {
+        q_narrow(g, arith, "delta-stepping");
+        return d_query_delta(q, orig, g->delta, g->d_threads, flags);
+    }
+    if (g->search == D_SEARCH_ASTAR) {
+        if (dest && g->heuristic)
+            q_narrow(g, arith, "A*");
+        return q_run_astar(q, orig, dest,
+                g->heuristic, g->h_data, flags);
+    }
+    if (g->cache) {
+        q_narrow(g, arith, "cached");
+        return d_cache_run(q, orig, dest, flags);
+    }
+    return q_run_forward(q, orig, dest, arith, flags);
+} /* q_run */
+
+int
+d_query_run(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int               flags)
+{
+#if D_STATS
+    double t0 = d_stats_now(), setup = q->stats.t_setup;
+    int res = q_run(q, orig, dest, flags);
+    /* the setup is timed apart */
+    q->stats.t_search += d_stats_now() - t0 - (q->stats.t_setup - setup);
+    q->stats.queries++;
+    return res;
+#else
+    return q_run(q, orig, dest, flags);
+#endif
+} /* d_query_run */
+
+int
+d_query_astar(
+        struct d_query   *q,
+        struct d_node    *orig,
+        struct d_node    *dest,
+        int             (*heuristic)(
+                                struct d_node *,
+                                struct d_node *,
+                                void *),
+        void             *calldata,
+        int               flags)
+{
+#if D_STATS
+    double t0 = d_stats_now(), setup = q->stats.t_setup;
+    int res = q_run_astar(q, orig, dest, heuristic, calldata, flags);
+    q->stats.t_search += d_stats_now() - t0 - (q->stats.t_setup - setup);
+    q->stats.queries++;
+    return res;
+#else
+    return q_run_astar(q, orig, dest, heuristic, calldata, flags);
+#endif
+} /* d_query_astar */
+
+const struct d_stats *
+d_query_stats(
+        const struct d_query *q)
+{
+    return &q->stats;
+} /* d_query_stats */
+
+void
+d_query_stats_reset(
+        struct d_query   *q)
+{
+    memset(&q->stats, 0, sizeof q->stats);
+} /* d_query_stats_reset */
+
+int
+d_query_reached(
+        const struct d_query *q,
+        const struct d_node  *nod)
+{
+    return nod->id < q->cap && Q_SETTLED(q, nod->id);
+} /* d_query_reached */
+
+int64_t
+d_query_cost(
+        const struct d_query *q,
+        const struct d_node  *nod)
+{
+    return d_query_reached(q, nod)
+        ? Q_COST(q, nod->id)
+        : -1;
+} /* d_query_cost */
+
+struct d_node *
+d_query_back(
+        const struct d_query *q,
+        const struct d_node  *nod)
+{
+    return d_query_reached(q, nod) && q->back[nod->id] >= 0
+        ? d_node_by_id(q->graph, q->back[nod->id])
+        : NULL;
+} /* d_query_back */
+
+ssize_t
+d_query_print_route(
+        FILE                 *file,
+        const struct d_query *q,
+        const struct d_node  *nod)
+{
+    /* stacked from the end, and printed from the origin */
+    int stk[ROUTE_STACK], *path = stk, id;
+    size_t n = 0, cap = ROUTE_STACK;
+    ssize_t res = 0;
+
+    if (!d_query_reached(q, nod))
+        return fprintf(file, "[%s:c=0]", nod->name);
+    for (id = nod->id; ; id = q->back[id]) {
+        if (n == cap) {
+            int *np = malloc(2 * cap * sizeof *np);
+            assert(np != NULL);
+            memcpy(np, path, n * sizeof *np);
+            if (path != stk) free(path);
+            path = np;
+            cap *= 2;
+        }
+        path[n++] = id;
+        if (q->back[id] < 0 || !Q_SETTLED(q, q->back[id]))
+            break;
+    }
+    while (n-- > 0)
+        res += fprintf(file, "[%s:c=%lld]%s",
+                d_csr_name(q->graph->csr, path[n]),
+                (long long)Q_COST(q, path[n]), n ? "->" : "");
+    if (path != stk) free(path);
+    return res;
+} /* d_query_print_route */
+
+ssize_t
+d_query_print_tree(
+        FILE                 *file,
+        const struct d_query *q,
+        int                   format)
+{
+    const struct d_csr *csr = q->graph->csr;
+    uint32_t u, n = csr->n < (uint32_t)q->cap ? csr->n : (uint32_t)q->cap;
+    ssize_t res = 0;
+
+    if (format == D_TREE_BINARY) {
+        struct d_tree_header h;
+        memcpy(h.magic, D_TREE_MAGIC, sizeof h.magic);
+        h.version = D_TREE_VERSION;
+        h.nodes   = csr->n;
+        h.reached = 0;
+        for (u = 0; u < n; ++u)
+            if (Q_SETTLED(q, u)) h.reached++;
+        res += fwrite(&h, sizeof h, 1, file) * sizeof h;
+    }
+    for (u = 0; u < n; ++u) {
+        if (!Q_SETTLED(q, u)) continue;
+        int b = q->back[u];
+        if (format == D_TREE_BINARY) {
+            struct d_tree_rec r = {
+                .node   = u,
+                .parent = b >= 0 ? (uint32_t)b : D_TREE_ROOT,
+                .cost   = Q_COST(q, u),
+            };
+            res += fwrite(&r, sizeof r, 1, file) * sizeof r;
+        } else {
+            res += fprintf(file, "%s %s %lld\n",
+                    d_csr_name(csr, u),
+                    b >= 0 ? d_csr_name(csr, b) : "-",
+                    (long long)Q_COST(q, u));
+        }
+    }
+    return res;
+} /* d_query_print_tree */
@@ -0,0 +1,172 @@
+/* relax.c -- relaxation kernels over the links of a frozen graph.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Mon Oct 19 10:21:44 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * The frozen layout keeps targets and weights in separate arrays,
+ * so the links of a node can be loaded eight at a time, the costs
+ * and stamps of their targets gathered, and the improving ones
+ * selected with a mask, without a branch per link.
+ */
+
+#include <stdint.h>
+
+#include "relax.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+typedef int relax_fn(
+        const uint32_t   *tgt,
+        const int32_t    *wgt,
+        int               n,
+        int               cu,
+        const int        *cost,
+        const uint32_t   *stamp,
+        uint32_t          ep,
+        int              *sel,
+        int              *hits);
+
+static int
+relax_scalar(
+        const uint32_t   *tgt,
+        const int32_t    *wgt,
+        int               n,
+        int               cu,
+        const int        *cost,
+        const uint32_t   *stamp,
+        uint32_t          ep,
+        int              *sel,
+        int              *hits)
+{
+    int k, m = 0, h = 0;
+
+    for (k = 0; k < n; ++k) {
+        uint32_t v = tgt[k], s = stamp[v];
+        if (s == ep + 1)
+            h++;
+        else if (s != ep || cu + wgt[k] < cost[v])
+            sel[m++] = k;
+    }
+    *hits = h;
+    return m;
+} /* relax_scalar */
+
+#ifdef HAVE_AVX2_KERNEL
+__attribute__((target("avx2")))
+static int
+relax_avx2(
+        const uint32_t   *tgt,
+        const int32_t    *wgt,
+        int               n,
+        int               cu,
+        const int        *cost,
+        const uint32_t   *stamp,
+        uint32_t          ep,
+        int              *sel,
+        int              *hits)
+{
+    const __m256i vcu  = _mm256_set1_epi32(cu),
+                  vep  = _mm256_set1_epi32((int)ep),
+                  vep1 = _mm256_set1_epi32((int)(ep + 1)),
+                  ones = _mm256_set1_epi32(-1);
+    int k, m = 0, h = 0;
+
+    for (k = 0; k + 8 <= n; k += 8) {
+        __m256i t  = _mm256_loadu_si256((const __m256i *)(tgt + k));
+        __m256i nc = _mm256_add_epi32(vcu,
+                _mm256_loadu_si256((const __m256i *)(wgt + k)));
+        __m256i st = _mm256_i32gather_epi32((const int *)stamp, t, 4);
+        /* costs of nodes not queued are garbage, but masked out */
+        __m256i c  = _mm256_i32gather_epi32(cost, t, 4);
+        __m256i not_queued = _mm256_xor_si256(
+                _mm256_cmpeq_epi32(st, vep), ones);
+        __m256i settled = _mm256_cmpeq_epi32(st, vep1);
+        __m256i ok = _mm256_andnot_si256(settled,
+                _mm256_or_si256(not_queued, _mm256_cmpgt_epi32(c, nc)));
+        unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(ok));
+        h += __builtin_popcount(
+                _mm256_movemask_ps(_mm256_castsi256_ps(settled)));
+        while (mask) {
+            sel[m++] = k + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    for (; k < n; ++k) {
+        uint32_t v = tgt[k], s = stamp[v];
+        if (s == ep + 1)
+            h++;
+        else if (s != ep || cu + wgt[k] < cost[v])
+            sel[m++] = k;
+    }
+    *hits = h;
+    return m;
+} /* relax_avx2 */
+#endif /* HAVE_AVX2_KERNEL */
+
+/* selects the kernel on the first call */
+static int
+relax_first(
+        const uint32_t   *tgt,
+        const int32_t    *wgt,
+        int               n,
+        int               cu,
+        const int        *cost,
+        const uint32_t   *stamp,
+        uint32_t          ep,
+        int              *sel,
+        int              *hits)
+{
+    d_relax_set_kernel(D_RELAX_AUTO);
+    return __atomic_load_n(&d_relax, __ATOMIC_RELAXED)(
+            tgt, wgt, n, cu, cost, stamp, ep, sel, hits);
+} /* relax_first */
+
+relax_fn *d_relax = relax_first;
+
+int
+d_relax_set_kernel(
+        int               kind)
+{
+    relax_fn *fn = NULL;
+
+    if (kind == D_RELAX_AUTO) {
+#ifdef HAVE_AVX2_KERNEL
+        __builtin_cpu_init();
+        kind = __builtin_cpu_supports("avx2")
+            ? D_RELAX_AVX2
+            : D_RELAX_SCALAR;
+#else
+        kind = D_RELAX_SCALAR;
+#endif
+    }
+    switch (kind) {
+    case D_RELAX_SCALAR: fn = relax_scalar; break;
+#ifdef HAVE_AVX2_KERNEL
+    case D_RELAX_AVX2:
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            fn = relax_avx2;
+        break;
+#endif
+    }
+    if (!fn) return -1;
+    /* several threads may select it at once, all the same one */
+    __atomic_store_n(&d_relax, fn, __ATOMIC_RELAXED);
+    return kind;
+} /* d_relax_set_kernel */
+
+const char *
+d_relax_name(
+        int               kind)
+{
+    switch (kind) {
+    case D_RELAX_AUTO:   return "auto";
+    case D_RELAX_SCALAR: return "scalar";
+    case D_RELAX_AVX2:   return "avx2";
+    }
+    return "unknown";
+} /* d_relax_name */
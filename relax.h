@@ -0,0 +1,79 @@
+/* relax.h -- relaxation kernels over the links of a frozen graph.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Mon Oct 19 10:21:44 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * This is an internal header, shared by the modules of the
+ * library that traverse a frozen graph.
+ */
+
+#ifndef _RELAX_H
+#define _RELAX_H
+
+#include <stdint.h>
+
+/* kinds of kernel */
+#define D_RELAX_AUTO        0   /* best one the cpu supports */
+#define D_RELAX_SCALAR      1   /* portable C, one link at a time */
+#define D_RELAX_AVX2        2   /* eight links at a time, with AVX2
+                                 * gathers */
+
+#define D_RELAX_CHUNK       64  /* max links per call to d_relax() */
+#define D_RELAX_MIN         8   /* nodes with less links are not worth
+                                 * a call to the kernel */
+
+/**
+ * Select the relaxation kernel.
+ *
+ * The kernel is selected with D_RELAX_AUTO on first use, checking
+ * the features of the cpu.  This allows to force one (e.g. to
+ * compare them).
+ *
+ * @param kind is one of the D_RELAX_* kinds above.
+ * @return kind (or the kind chosen for D_RELAX_AUTO), or -1 if the
+ *         cpu (or the compiler) cannot run it.
+ */
+int
+d_relax_set_kernel(
+        int               kind);
+
+/**
+ * @return the name of a kind of kernel.
+ */
+const char *
+d_relax_name(
+        int               kind);
+
+/**
+ * Relax n links (at most D_RELAX_CHUNK) leaving a node of cost cu.
+ *
+ * The links go to tgt[k] with weight wgt[k].  A link improves its
+ * target v if v is not settled (stamp[v] != ep + 1) and either it
+ * is not queued (stamp[v] != ep) or cu + wgt[k] < cost[v].  The
+ * kernel only selects the links, the caller updates the targets
+ * (checking them again, if several links go to the same node).
+ *
+ * @param sel gets the indexes k of the links that improve their
+ *        targets, in increasing order.
+ * @param hits gets the number of links to settled nodes.
+ * @return the number of links selected.
+ *
+ * The kernel is selected on the first call (or by
+ * d_relax_set_kernel()), and the pointer is stored atomically, so
+ * it must be read with __atomic_load_n() by the searches that may
+ * run in several threads.
+ */
+extern int
+(*d_relax)(
+        const uint32_t   *tgt,
+        const int32_t    *wgt,
+        int               n,
+        int               cu,
+        const int        *cost,
+        const uint32_t   *stamp,
+        uint32_t          ep,
+        int              *sel,
+        int              *hits);
+
+#endif /* _RELAX_H */
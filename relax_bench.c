@@ -0,0 +1,203 @@
+/* relax_bench.c -- micro-benchmark of the relaxation of links, on
+ * the links of the nodes and on the frozen layout.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Mon Oct 19 10:21:44 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * Every node of the graph is given a random state (not reached,
+ * queued with some cost, or settled) and all the links of all the
+ * nodes are relaxed, several rounds, counting the links that would
+ * improve their targets: first following the d_link structures of
+ * the nodes, as d_dijkstra() does with the 'list' engine, and then
+ * with each of the kernels of relax.h on the frozen layout.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "graph.h"
+#include "loader.h"
+#include "relax.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+/* same meaning as the node flags of dijkstra.c */
+#define REACHED             (1 << 1)
+#define QUEUED              (1 << 2)
+
+#define EPOCH               2
+
+int rounds = 10;
+unsigned seed = 1;
+
+struct state {
+    struct d_graph  *graph;
+    struct d_node  **nodes;    /* nodes, by id */
+    int             *cu;       /* cost of each node, when settled */
+    int             *cost;
+    uint32_t        *stamp;
+    int              n;
+    long             links;
+};
+
+static double
+now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+} /* now */
+
+static void
+report(const char *name, long improved, double t, const struct state *s)
+{
+    double links = (double)s->links * rounds;
+    printf("%-8s %12.0f links in %8.3fs, %8.2f Mlinks/s "
+            "(%ld improve)\n",
+            name, links, t, t > 0.0 ? links / t * 1e-6 : 0.0,
+            improved);
+} /* report */
+
+static long
+bench_nodes(const struct state *s)
+{
+    long res = 0;
+    int u;
+
+    for (u = 0; u < s->n; ++u) {
+        struct d_node *nod = s->nodes[u];
+        struct d_link *l, *end = nod->next + nod->next_n;
+        for (l = nod->next; l < end; ++l) {
+            struct d_node *to = l->to;
+            if (to->flags & REACHED)
+                continue;
+            int new_cost = s->cu[u] + l->weight;
+            if (!(to->flags & QUEUED) || new_cost < to->cost)
+                res++;
+        }
+    }
+    return res;
+} /* bench_nodes */
+
+static long
+bench_kernel(const struct state *s)
+{
+    const struct d_csr *csr = s->graph->csr;
+    int sel[D_RELAX_CHUNK], hits;
+    long res = 0;
+    int u;
+
+    for (u = 0; u < s->n; ++u) {
+        uint32_t e, end = csr->off[u + 1];
+        for (e = csr->off[u]; e < end; e += D_RELAX_CHUNK) {
+            int n = end - e < D_RELAX_CHUNK ? end - e : D_RELAX_CHUNK;
+            res += __atomic_load_n(&d_relax, __ATOMIC_RELAXED)(
+                    csr->tgt + e, csr->wgt + e, n, s->cu[u],
+                    s->cost, s->stamp, EPOCH, sel, &hits);
+        }
+    }
+    return res;
+} /* bench_kernel */
+
+static void
+setup(struct state *s, char *path)
+{
+    s->graph = d_new_graph(path, 0);
+    d_begin_bulk(s->graph);
+    if (d_load_file(s->graph, path, 1, 0) < 0) {
+        fprintf(stderr, F("LOAD: %s: %s\n"), path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    d_end_bulk(s->graph, 1, 0);
+    d_freeze(s->graph, 0);
+
+    const struct d_csr *csr = s->graph->csr;
+    int u;
+
+    s->n     = csr->n;
+    s->links = csr->m;
+    s->nodes = malloc((s->n + 1) * sizeof *s->nodes);
+    s->cu    = malloc((s->n + 1) * sizeof *s->cu);
+    s->cost  = malloc((s->n + 1) * sizeof *s->cost);
+    s->stamp = malloc((s->n + 1) * sizeof *s->stamp);
+    if (!s->nodes || !s->cu || !s->cost || !s->stamp) {
+        fprintf(stderr, F("%s\n"), strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    srand(seed);
+    for (u = 0; u < s->n; ++u) {
+        struct d_node *nod = d_node_by_id(s->graph, u);
+        s->nodes[u] = nod;
+        s->cu[u]    = rand() % 1000;
+        s->cost[u]  = rand() % 2000;
+        nod->cost   = s->cost[u];
+        nod->flags &= ~(REACHED | QUEUED);
+        switch (rand() % 3) {
+        case 0: s->stamp[u] = 0; break;
+        case 1: s->stamp[u] = EPOCH; nod->flags |= QUEUED; break;
+        case 2: s->stamp[u] = EPOCH + 1; nod->flags |= REACHED; break;
+        }
+    }
+} /* setup */
+
+int main(int argc, char **argv)
+{
+    static const int kinds[] = { D_RELAX_SCALAR, D_RELAX_AVX2 };
+    struct state s;
+    int opt, i, r;
+
+    while ((opt = getopt(argc, argv, "r:s:")) >= 0) {
+        switch (opt) {
+        case 'r': rounds = atoi(optarg); break;
+        case 's': seed = atoi(optarg); break;
+        default:
+            fprintf(stderr,
+                    "Usage: %s [ -r rounds ] [ -s seed ] file\n",
+                    argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [ -r rounds ] [ -s seed ] file\n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    setup(&s, argv[optind]);
+    printf("%s: %d nodes, %ld links, %d rounds\n",
+            argv[optind], s.n, s.links, rounds);
+
+    long ref = 0;
+    double t = now();
+    for (r = 0; r < rounds; ++r)
+        ref = bench_nodes(&s);
+    report("nodes", ref, now() - t, &s);
+
+    for (i = 0; i < (int)(sizeof kinds / sizeof kinds[0]); ++i) {
+        if (d_relax_set_kernel(kinds[i]) < 0) {
+            printf("%-8s not supported\n", d_relax_name(kinds[i]));
+            continue;
+        }
+        long res = 0;
+        t = now();
+        for (r = 0; r < rounds; ++r)
+            res = bench_kernel(&s);
+        report(d_relax_name(kinds[i]), res, now() - t, &s);
+        if (res != ref) {
+            fprintf(stderr, F("%s: %ld links improve, should be %ld\n"),
+                    d_relax_name(kinds[i]), res, ref);
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(s.nodes);
+    free(s.cu);
+    free(s.cost);
+    free(s.stamp);
+    d_free_graph(s.graph);
+    exit(EXIT_SUCCESS);
+} /* main */
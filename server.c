@@ -0,0 +1,901 @@
+/* server.c -- query server over a unix domain socket.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Thu Oct 22 11:40:07 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * The epoll loop is the only thread that touches the connections
+ * and the reference counts of the graphs.  Requests become jobs,
+ * queued to the workers, that give them back (with the reply
+ * already formatted) through a list and an eventfd.  Each graph
+ * file has a current generation, and each job holds a reference
+ * to the generation it was read for, so a reload only replaces
+ * the current one.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "graph.h"
+#include "server.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+#define SEP_STRING      ", \t\r\n"
+#define MAX_EVENTS      64
+#define READ_SIZE       65536      /* bytes read at once */
+#define MAX_PENDING     1024       /* jobs of a connection in flight */
+#define MAX_OUT         (1 << 20)  /* bytes of replies not yet sent */
+#define BACKLOG         128
+
+/* a graph, as loaded by the first load or a reload of its file */
+struct gen {
+    struct d_graph  *graph;
+    void            *data;     /* of ops->load() */
+    int              refs;     /* jobs using it, plus one while it's
+                                * the current one */
+    struct d_query **q;        /* query of each worker, created by it */
+};
+
+struct job {
+    struct job      *next;     /* in the queue of the workers, or in
+                                * the list of done jobs */
+    struct job      *c_next;   /* in the requests of the connection */
+    struct conn     *conn;
+    struct gen      *gen;      /* NULL for bad requests */
+    char            *src;      /* names, for text requests */
+    char            *dst;
+    uint32_t         src_id;   /* ids, for binary requests */
+    uint32_t         dst_id;
+    int              mode;
+    int              done;
+    int64_t          cost;
+    double           usec;
+    char            *out;      /* the reply */
+    size_t           out_n;
+};
+
+struct conn {
+    struct conn     *prev;     /* in the open connections */
+    struct conn     *next;     /* same, or in the closed ones */
+    struct conn     *d_next;   /* in the ones with jobs done */
+    int              fd;       /* -1 once closed */
+    int              binary;   /* -1 until known */
+    int              eof;      /* no more requests will come */
+    uint32_t         events;   /* registered in epoll */
+    char            *in;       /* requests not parsed yet */
+    size_t           in_n, in_cap;
+    char            *out;      /* replies not sent yet */
+    size_t           out_n, out_off, out_cap;
+    struct job      *head;     /* requests in flight, in order */
+    struct job      *tail;
+    int              pending;  /* number of them */
+};
+
+struct server {
+    const struct d_srv_ops *ops;
+    char           **paths;
+    int              npaths;
+    int              flags;
+    int              nthreads;
+    struct gen     **cur;      /* current generation of each path */
+    int              ep;       /* epoll */
+    int              lfd;      /* listening socket */
+    int              sfd;      /* signalfd */
+    int              done_fd;  /* eventfd, jobs done */
+    int              load_fd;  /* eventfd, reload done */
+    int              quit;     /* 1 stopping, 2 right now */
+    long             inflight; /* jobs queued or running */
+    struct conn     *conns;    /* open connections */
+    struct conn     *dead;     /* closed ones, freed at the end of
+                                * the round of events */
+
+    pthread_mutex_t  mtx;      /* protects the lists below */
+    pthread_cond_t   cv_work;
+    struct job      *q_head;   /* queue of the workers */
+    struct job      *q_tail;
+    struct job      *done;     /* jobs done, in any order */
+    int              stop;     /* workers must exit */
+
+    pthread_t        loader;   /* reload in progress */
+    int              loading;
+    int              load_again; /* SIGHUP received while loading */
+    struct gen     **loaded;   /* new generations, NULL if failed */
+
+    struct d_srv_stats st;
+    double           lat_sum;
+};
+
+struct worker {
+    struct server   *srv;
+    int              idx;
+};
+
+/* tags of the descriptors that are not connections */
+static char tag_listen, tag_signal, tag_done, tag_load;
+
+static double
+now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1.0E-9;
+} /* now */
+
+static struct gen *
+gen_new(struct server *s, const char *path)
+{
+    void *data = NULL;
+    struct d_graph *g = s->ops->load(path, &data, s->ops->arg);
+    if (!g) return NULL;
+    /* the queries need the frozen layout, see d_batch_run() */
+    d_freeze(g, s->flags);
+
+    struct gen *res = calloc(1, sizeof *res);
+    assert(res != NULL);
+    res->graph = g;
+    res->data  = data;
+    res->refs  = 1;
+    res->q     = calloc(s->nthreads, sizeof *res->q);
+    assert(res->q != NULL);
+    return res;
+} /* gen_new */
+
+static void
+gen_release(struct server *s, struct gen *gen)
+{
+    int i;
+
+    if (!gen || --gen->refs > 0) return;
+    for (i = 0; i < s->nthreads; ++i)
+        d_query_free(gen->q[i]);
+    free(gen->q);
+    s->ops->unload(gen->graph, gen->data, s->ops->arg);
+    free(gen);
+} /* gen_release */
+
+/* runs a job, and formats its reply */
+static void
+run_job(struct worker *w, struct job *j)
+{
+    struct server *s = w->srv;
+    struct gen *gen = j->gen;
+
+    if (!gen) return; /* the reply of bad requests is ready */
+    if (!gen->q[w->idx])
+        gen->q[w->idx] = d_query_new(gen->graph, s->flags);
+
+    struct d_query *q = gen->q[w->idx];
+    struct d_graph *g = gen->graph;
+    struct d_node *sn = NULL, *dn = NULL;
+    double t0 = now();
+    if (j->src) {
+        sn = d_find_node(g, j->src);
+        dn = d_find_node(g, j->dst);
+    } else if (j->src_id < g->csr->n && j->dst_id < g->csr->n) {
+        sn = d_node_by_id(g, j->src_id);
+        dn = d_node_by_id(g, j->dst_id);
+    }
+    j->cost = D_SRV_UNREACHED;
+    if (sn && dn) {
+        d_query_run(q, sn, dn, s->flags);
+        j->cost = d_query_cost(q, dn);
+    }
+    j->usec = (now() - t0) * 1.0E6;
+
+    int route = j->mode == D_SRV_ROUTE && j->cost >= 0;
+    if (j->src) {
+        FILE *f = open_memstream(&j->out, &j->out_n);
+        assert(f != NULL);
+        fprintf(f, "%s %s %lld %.3f", j->src, j->dst,
+                (long long)j->cost, j->usec);
+        if (route) {
+            fputc(' ', f);
+            d_query_print_route(f, q, dn);
+        }
+        fputc('\n', f);
+        fclose(f);
+        return;
+    }
+
+    /* the route is followed back, and stored from the end */
+    struct d_node *v;
+    uint32_t n = 0, len;
+    if (route)
+        for (v = dn; v; v = d_query_back(q, v))
+            n++;
+    len = sizeof(struct d_srv_reply) + n * sizeof(uint32_t);
+    j->out_n = sizeof len + len;
+    j->out = malloc(j->out_n);
+    assert(j->out != NULL);
+
+    struct d_srv_reply r = {
+        .cost  = j->cost,
+        .usec  = j->usec,
+        .nodes = n,
+    };
+    uint32_t *ids = (uint32_t *)(j->out + sizeof len + sizeof r);
+    memcpy(j->out, &len, sizeof len);
+    memcpy(j->out + sizeof len, &r, sizeof r);
+    for (v = dn; n > 0; v = d_query_back(q, v))
+        ids[--n] = v->id;
+} /* run_job */
+
+static void *
+worker(void *arg)
+{
+    struct worker *w = arg;
+    struct server *s = w->srv;
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&s->mtx);
+    for (;;) {
+        while (!s->stop && !s->q_head)
+            pthread_cond_wait(&s->cv_work, &s->mtx);
+        if (s->stop) break;
+
+        struct job *j = s->q_head;
+        s->q_head = j->next;
+        if (!s->q_head) s->q_tail = NULL;
+        pthread_mutex_unlock(&s->mtx);
+
+        run_job(w, j);
+
+        pthread_mutex_lock(&s->mtx);
+        j->next = s->done;
+        s->done = j;
+        if (!j->next) {
+            /* the list was empty, the loop must be woken up */
+            ssize_t r = write(s->done_fd, &one, sizeof one);
+            (void)r;
+        }
+    }
+    pthread_mutex_unlock(&s->mtx);
+    return NULL;
+} /* worker */
+
+/* the new generations of all the paths, left for the loop */
+static void *
+loader(void *arg)
+{
+    struct server *s = arg;
+    uint64_t one = 1;
+    int i;
+
+    for (i = 0; i < s->npaths; ++i)
+        s->loaded[i] = gen_new(s, s->paths[i]);
+    ssize_t r = write(s->load_fd, &one, sizeof one);
+    (void)r;
+    return NULL;
+} /* loader */
+
+static void
+start_reload(struct server *s)
+{
+    if (s->loading) {
+        s->load_again = 1;
+        return;
+    }
+    if (pthread_create(&s->loader, NULL, loader, s)) {
+        fprintf(stderr, F("cannot create loader thread\n"));
+        return;
+    }
+    s->loading    = 1;
+    s->load_again = 0;
+} /* start_reload */
+
+static void
+end_reload(struct server *s)
+{
+    uint64_t v;
+    int i, n = 0;
+
+    ssize_t r = read(s->load_fd, &v, sizeof v);
+    (void)r;
+    pthread_join(s->loader, NULL);
+    s->loading = 0;
+    for (i = 0; i < s->npaths; ++i) {
+        if (!s->loaded[i]) {
+            fprintf(stderr, F("%s: cannot be loaded again, the old "
+                    "graph is kept\n"), s->paths[i]);
+            continue;
+        }
+        gen_release(s, s->cur[i]);
+        s->cur[i] = s->loaded[i];
+        s->loaded[i] = NULL;
+        n++;
+    }
+    s->st.reloads += n;
+    fprintf(stderr, "%d of %d graphs loaded again\n", n, s->npaths);
+    if (s->load_again && !s->quit)
+        start_reload(s);
+} /* end_reload */
+
+static void
+submit(struct server *s, struct job *j)
+{
+    struct conn *c = j->conn;
+
+    if (c->tail) c->tail->c_next = j;
+    else c->head = j;
+    c->tail = j;
+    c->pending++;
+    s->inflight++;
+
+    pthread_mutex_lock(&s->mtx);
+    j->next = NULL;
+    if (s->q_tail) s->q_tail->next = j;
+    else s->q_head = j;
+    s->q_tail = j;
+    pthread_cond_signal(&s->cv_work);
+    pthread_mutex_unlock(&s->mtx);
+} /* submit */
+
+/* a job for a request of connection c on graph index gi, with the
+ * reply of an invalid request if gi or mode are not valid */
+static struct job *
+new_job(struct server *s, struct conn *c, long gi, int mode)
+{
+    struct job *j = calloc(1, sizeof *j);
+    assert(j != NULL);
+    j->conn = c;
+    j->mode = mode;
+    if (gi < 0 || gi >= s->npaths
+            || (mode != D_SRV_COST && mode != D_SRV_ROUTE)) {
+        s->st.invalid++;
+        j->cost = D_SRV_INVALID;
+        return j;
+    }
+    j->gen = s->cur[gi];
+    j->gen->refs++;
+    return j;
+} /* new_job */
+
+/* the index of the graph named by a text request */
+static long
+graph_index(struct server *s, const char *name)
+{
+    char *end;
+    long res = strtol(name, &end, 10);
+    int i;
+
+    if (*name && !*end) return res;
+    for (i = 0; i < s->npaths; ++i)
+        if (strcmp(s->paths[i], name) == 0)
+            return i;
+    return -1;
+} /* graph_index */
+
+static void
+text_request(struct server *s, struct conn *c, char *line)
+{
+    char *save;
+    char *src  = strtok_r(line, SEP_STRING, &save);
+    if (!src || src[0] == '#') return;
+    char *dst  = strtok_r(NULL, SEP_STRING, &save);
+    char *mode = strtok_r(NULL, SEP_STRING, &save);
+    char *gr   = strtok_r(NULL, SEP_STRING, &save);
+    int m = !mode || strcmp(mode, "cost") == 0 ? D_SRV_COST
+            : strcmp(mode, "route") == 0 ? D_SRV_ROUTE
+            : -1;
+
+    struct job *j = new_job(s, c,
+            !dst ? -1 : gr ? graph_index(s, gr) : 0, m);
+    if (!j->gen) {
+        FILE *f = open_memstream(&j->out, &j->out_n);
+        assert(f != NULL);
+        fprintf(f, "ERROR invalid request '%s'\n", src);
+        fclose(f);
+    } else {
+        j->src = strdup(src);
+        j->dst = strdup(dst);
+        assert(j->src != NULL && j->dst != NULL);
+    }
+    submit(s, j);
+} /* text_request */
+
+static void
+binary_request(struct server *s, struct conn *c,
+        const struct d_srv_request *r)
+{
+    struct job *j = new_job(s, c, r->graph, r->mode);
+
+    if (!j->gen) {
+        uint32_t len = sizeof(struct d_srv_reply);
+        struct d_srv_reply rep = { .cost = D_SRV_INVALID };
+        j->out_n = sizeof len + len;
+        j->out = malloc(j->out_n);
+        assert(j->out != NULL);
+        memcpy(j->out, &len, sizeof len);
+        memcpy(j->out + sizeof len, &rep, sizeof rep);
+    }
+    j->src_id = r->src;
+    j->dst_id = r->dst;
+    submit(s, j);
+} /* binary_request */
+
+/* takes the complete requests of the input of c, while there's
+ * room for them.  Returns -1 if the input is not valid. */
+static int
+parse(struct server *s, struct conn *c)
+{
+    size_t off = 0;
+
+    if (c->binary < 0 && c->in_n > 0) {
+        c->binary = c->in[0] == '\0';
+        if (c->binary && c->in_n < D_SRV_MAGIC_LEN)
+            c->binary = -1; /* wait for the rest of the magic */
+        else if (c->binary) {
+            if (memcmp(c->in, D_SRV_MAGIC, D_SRV_MAGIC_LEN))
+                return -1;
+            off = D_SRV_MAGIC_LEN;
+        }
+    }
+    while (c->binary >= 0 && !s->quit && c->pending < MAX_PENDING
+            && c->out_n - c->out_off < MAX_OUT) {
+        char *p = c->in + off;
+        size_t left = c->in_n - off;
+        if (c->binary) {
+            uint32_t len;
+            struct d_srv_request r;
+            if (left < sizeof len) break;
+            memcpy(&len, p, sizeof len);
+            if (len < sizeof r || len > D_SRV_MAX_REQUEST)
+                return -1;
+            if (left < sizeof len + len) break;
+            memcpy(&r, p + sizeof len, sizeof r);
+            binary_request(s, c, &r);
+            off += sizeof len + len;
+        } else {
+            char *nl = memchr(p, '\n', left);
+            if (!nl && c->eof && left > 0) {
+                nl = p + left; /* the last line has no newline */
+                assert(c->in_cap > c->in_n);
+            }
+            if (!nl) {
+                if (left > D_SRV_MAX_REQUEST) return -1;
+                break;
+            }
+            *nl = '\0';
+            text_request(s, c, p);
+            off += nl - p + 1;
+            if (off > c->in_n) off = c->in_n;
+        }
+    }
+    memmove(c->in, c->in + off, c->in_n - off);
+    c->in_n -= off;
+    return 0;
+} /* parse */
+
+static void
+conn_free(struct conn *c)
+{
+    free(c->in);
+    free(c->out);
+    free(c);
+} /* conn_free */
+
+/* closes a connection.  It is freed once its jobs come back, at
+ * the end of the round of events, as other events of the round
+ * can still refer to it. */
+static void
+conn_close(struct server *s, struct conn *c)
+{
+    if (c->fd < 0) return;
+    epoll_ctl(s->ep, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+    if (c->prev) c->prev->next = c->next;
+    else s->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    c->prev = NULL;
+    c->next = NULL;
+    if (!c->pending) {
+        c->next = s->dead;
+        s->dead = c;
+    }
+} /* conn_close */
+
+/* sends what it can of the replies of c.  Returns -1 if the
+ * connection is lost. */
+static int
+conn_send(struct conn *c)
+{
+    while (c->out_off < c->out_n) {
+        ssize_t n = send(c->fd, c->out + c->out_off,
+                c->out_n - c->out_off, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        c->out_off += n;
+    }
+    c->out_off = c->out_n = 0;
+    return 0;
+} /* conn_send */
+
+/* the events of c, as its state needs them, or closes it if it's
+ * finished */
+static void
+conn_update(struct server *s, struct conn *c)
+{
+    int more_in = !c->eof && !s->quit && c->pending < MAX_PENDING
+            && c->out_n - c->out_off < MAX_OUT;
+    int more_out = c->out_off < c->out_n;
+
+    if (!more_out && !c->pending && (c->eof || s->quit)) {
+        conn_close(s, c);
+        return;
+    }
+    uint32_t ev = (more_in ? EPOLLIN : 0) | (more_out ? EPOLLOUT : 0);
+    if (ev != c->events) {
+        struct epoll_event e = { .events = ev, .data.ptr = c };
+        epoll_ctl(s->ep, EPOLL_CTL_MOD, c->fd, &e);
+        c->events = ev;
+    }
+} /* conn_update */
+
+static void
+conn_read(struct server *s, struct conn *c)
+{
+    if (c->in_cap - c->in_n < READ_SIZE) {
+        c->in_cap = c->in_n + READ_SIZE;
+        c->in = realloc(c->in, c->in_cap);
+        assert(c->in != NULL);
+    }
+    /* room for a nul after the input, see parse() */
+    ssize_t n = read(c->fd, c->in + c->in_n, READ_SIZE - 1);
+    if (n < 0 && (errno == EINTR || errno == EAGAIN))
+        return;
+    if (n <= 0) {
+        /* the requests already read are still replied */
+        if (n < 0) {
+            conn_close(s, c);
+            return;
+        }
+        c->eof = 1;
+    }
+    c->in_n += n;
+    if (parse(s, c) < 0) {
+        fprintf(stderr, F("invalid request, connection closed\n"));
+        conn_close(s, c);
+        return;
+    }
+    conn_update(s, c);
+} /* conn_read */
+
+static void
+conn_write(struct server *s, struct conn *c)
+{
+    if (conn_send(c) < 0) {
+        conn_close(s, c);
+        return;
+    }
+    /* requests waiting for room */
+    if (c->in_n && parse(s, c) < 0) {
+        conn_close(s, c);
+        return;
+    }
+    conn_update(s, c);
+} /* conn_write */
+
+static void
+do_accept(struct server *s)
+{
+    int fd = accept(s->lfd, NULL, NULL);
+    if (fd < 0) {
+        if (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED)
+            fprintf(stderr, F("ACCEPT: %s\n"), strerror(errno));
+        return;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    struct conn *c = calloc(1, sizeof *c);
+    assert(c != NULL);
+    c->fd     = fd;
+    c->binary = -1;
+    c->events = EPOLLIN;
+    struct epoll_event e = { .events = EPOLLIN, .data.ptr = c };
+    if (epoll_ctl(s->ep, EPOLL_CTL_ADD, fd, &e) < 0) {
+        close(fd);
+        conn_free(c);
+        return;
+    }
+    c->next = s->conns;
+    if (s->conns) s->conns->prev = c;
+    s->conns = c;
+    s->st.conns++;
+} /* do_accept */
+
+/* takes the jobs done by the workers, and queues the replies that
+ * are next in their connections */
+static void
+do_done(struct server *s)
+{
+    uint64_t v;
+    ssize_t r = read(s->done_fd, &v, sizeof v);
+    (void)r;
+
+    pthread_mutex_lock(&s->mtx);
+    struct job *j = s->done;
+    s->done = NULL;
+    pthread_mutex_unlock(&s->mtx);
+
+    /* the jobs are freed in order, so their connections are taken
+     * first */
+    struct conn *dirty = NULL, *c;
+    for (; j; j = j->next) {
+        j->done = 1;
+        if (j->gen) {
+            s->st.queries++;
+            if (j->cost < 0) s->st.unreached++;
+            s->lat_sum += j->usec;
+            if (j->usec > s->st.lat_max) s->st.lat_max = j->usec;
+        }
+        c = j->conn;
+        if (j == c->head && !c->d_next && c != dirty) {
+            c->d_next = dirty;
+            dirty = c;
+        }
+    }
+    while ((c = dirty) != NULL) {
+        dirty = c->d_next;
+        c->d_next = NULL;
+        while ((j = c->head) != NULL && j->done) {
+            c->head = j->c_next;
+            if (!c->head) c->tail = NULL;
+            c->pending--;
+            s->inflight--;
+            if (c->fd >= 0) {
+                if (c->out_n + j->out_n > c->out_cap) {
+                    c->out_cap = 2 * (c->out_n + j->out_n);
+                    c->out = realloc(c->out, c->out_cap);
+                    assert(c->out != NULL);
+                }
+                memcpy(c->out + c->out_n, j->out, j->out_n);
+                c->out_n += j->out_n;
+            }
+            gen_release(s, j->gen);
+            free(j->src); free(j->dst); free(j->out);
+            free(j);
+        }
+        if (c->fd >= 0) {
+            conn_write(s, c);
+        } else if (!c->pending) {
+            c->next = s->dead;
+            s->dead = c;
+        }
+    }
+} /* do_done */
+
+static void
+do_signal(struct server *s)
+{
+    struct signalfd_siginfo si;
+
+    if (read(s->sfd, &si, sizeof si) != sizeof si)
+        return;
+    if (si.ssi_signo == SIGHUP) {
+        if (!s->quit) start_reload(s);
+        return;
+    }
+    if (s->quit) {
+        /* the second one doesn't wait */
+        s->quit = 2;
+        return;
+    }
+    /* stop taking connections and requests, the ones read are
+     * finished */
+    s->quit = 1;
+    epoll_ctl(s->ep, EPOLL_CTL_DEL, s->lfd, NULL);
+    if (s->flags & D_FLAG_DEBUG)
+        printf(F("signal %u, stopping the server\n"), si.ssi_signo);
+    struct conn *c, *next;
+    for (c = s->conns; c; c = next) {
+        next = c->next;
+        conn_update(s, c);
+    }
+} /* do_signal */
+
+/* the listening socket bound to path */
+static int
+listen_on(const char *path)
+{
+    struct sockaddr_un sa = { .sun_family = AF_UNIX };
+    struct stat st;
+
+    if (strlen(path) >= sizeof sa.sun_path) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(sa.sun_path, path);
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+        unlink(path); /* left by a previous server */
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (bind(fd, (struct sockaddr *)&sa, sizeof sa) < 0
+            || listen(fd, BACKLOG) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+} /* listen_on */
+
+static int
+watch(struct server *s, int fd, void *tag)
+{
+    struct epoll_event e = { .events = EPOLLIN, .data.ptr = tag };
+    return epoll_ctl(s->ep, EPOLL_CTL_ADD, fd, &e);
+} /* watch */
+
+int
+d_srv_run(
+        const char             *sock_path,
+        char                  **paths,
+        int                     npaths,
+        const struct d_srv_ops *ops,
+        int                     nthreads,
+        int                     flags,
+        struct d_srv_stats     *stats)
+{
+    struct server s = {
+        .ops      = ops,
+        .paths    = paths,
+        .npaths   = npaths,
+        .flags    = flags,
+        .nthreads = nthreads < 1 ? 1 : nthreads,
+        .ep = -1, .lfd = -1, .sfd = -1, .done_fd = -1, .load_fd = -1,
+        .mtx      = PTHREAD_MUTEX_INITIALIZER,
+        .cv_work  = PTHREAD_COND_INITIALIZER,
+    };
+    int i, res = -1, err = 0, started = 0;
+
+    s.cur    = calloc(npaths, sizeof *s.cur);
+    s.loaded = calloc(npaths, sizeof *s.loaded);
+    assert(s.cur != NULL && s.loaded != NULL);
+    for (i = 0; i < npaths; ++i) {
+        s.cur[i] = gen_new(&s, paths[i]);
+        if (!s.cur[i]) {
+            err = EINVAL;
+            goto out;
+        }
+    }
+
+    /* the signals are taken by the loop, and all the threads
+     * inherit the mask */
+    sigset_t mask, old;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGHUP);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, &old);
+
+    s.ep      = epoll_create1(EPOLL_CLOEXEC);
+    s.sfd     = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    s.done_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    s.load_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    s.lfd     = listen_on(sock_path);
+    if (s.ep < 0 || s.sfd < 0 || s.done_fd < 0 || s.load_fd < 0
+            || s.lfd < 0
+            || watch(&s, s.lfd, &tag_listen) < 0
+            || watch(&s, s.sfd, &tag_signal) < 0
+            || watch(&s, s.done_fd, &tag_done) < 0
+            || watch(&s, s.load_fd, &tag_load) < 0) {
+        err = errno;
+        goto out_sig;
+    }
+
+    struct worker *w = malloc(s.nthreads * sizeof *w);
+    pthread_t *th = malloc(s.nthreads * sizeof *th);
+    assert(w != NULL && th != NULL);
+    for (i = 0; i < s.nthreads; ++i) {
+        w[i].srv = &s;
+        w[i].idx = i;
+        if (pthread_create(&th[i], NULL, worker, &w[i]))
+            break;
+    }
+    started = i;
+    if (started == 0) {
+        fprintf(stderr, F("cannot create worker threads\n"));
+        err = EAGAIN;
+    } else {
+        fprintf(stderr, "serving %d graphs on %s with %d threads\n",
+                npaths, sock_path, started);
+        res = 0;
+    }
+
+    while (res == 0 && s.quit < 2
+            && !(s.quit && !s.conns && !s.inflight && !s.loading)) {
+        struct epoll_event ev[MAX_EVENTS];
+        int n = epoll_wait(s.ep, ev, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            err = errno;
+            res = -1;
+            break;
+        }
+        for (i = 0; i < n; ++i) {
+            void *p = ev[i].data.ptr;
+            if (p == &tag_listen) {
+                if (!s.quit) do_accept(&s);
+            } else if (p == &tag_signal) {
+                do_signal(&s);
+            } else if (p == &tag_done) {
+                do_done(&s);
+            } else if (p == &tag_load) {
+                end_reload(&s);
+            } else {
+                struct conn *c = p;
+                /* a previous event of this round may have closed it */
+                if (c->fd < 0) continue;
+                if (ev[i].events & (EPOLLHUP | EPOLLERR)) {
+                    /* the replies cannot be sent anymore */
+                    conn_close(&s, c);
+                    continue;
+                }
+                if (ev[i].events & EPOLLIN)
+                    conn_read(&s, c);
+                if (c->fd >= 0 && (ev[i].events & EPOLLOUT))
+                    conn_write(&s, c);
+            }
+        }
+        while (s.dead) {
+            struct conn *c = s.dead;
+            s.dead = c->next;
+            conn_free(c);
+        }
+    }
+    while (s.conns)
+        conn_close(&s, s.conns);
+
+    pthread_mutex_lock(&s.mtx);
+    s.stop = 1;
+    pthread_cond_broadcast(&s.cv_work);
+    pthread_mutex_unlock(&s.mtx);
+    for (i = 0; i < started; ++i)
+        pthread_join(th[i], NULL);
+    free(th);
+    free(w);
+    if (s.loading) {
+        pthread_join(s.loader, NULL);
+        for (i = 0; i < npaths; ++i)
+            gen_release(&s, s.loaded[i]);
+    }
+    unlink(sock_path);
+
+out_sig:
+    if (s.lfd >= 0) close(s.lfd);
+    if (s.load_fd >= 0) close(s.load_fd);
+    if (s.done_fd >= 0) close(s.done_fd);
+    if (s.sfd >= 0) close(s.sfd);
+    if (s.ep >= 0) close(s.ep);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+out:
+    /* connections still open (only on errors) are left to exit() */
+    for (i = 0; i < npaths; ++i)
+        gen_release(&s, s.cur[i]);
+    free(s.cur);
+    free(s.loaded);
+    if (stats) {
+        *stats = s.st;
+        if (s.st.queries > 0)
+            stats->lat_avg = s.lat_sum / s.st.queries;
+    }
+    if (err) errno = err;
+    return res;
+} /* d_srv_run */
@@ -0,0 +1,118 @@
+/* server.h -- query server over a unix domain socket.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Thu Oct 22 11:40:07 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _SERVER_H
+#define _SERVER_H
+
+#include <stdint.h>
+
+#include "dijkstra.h"
+
+/* binary connections start with these 8 bytes (the first one is a
+ * nul, that cannot start a text request) */
+#define D_SRV_MAGIC         "\0DIJKSRV"
+#define D_SRV_MAGIC_LEN     8
+
+/* modes of the requests */
+#define D_SRV_COST          0          /* the cost only */
+#define D_SRV_ROUTE         1          /* the cost and the route */
+
+/* costs of the replies, besides the minimum cost */
+#define D_SRV_UNREACHED     (-1)       /* no path, or unknown nodes */
+#define D_SRV_INVALID       (-2)       /* bad mode or graph */
+
+#define D_SRV_MAX_REQUEST   4096       /* longest request, in bytes */
+
+/* binary requests and replies are frames of a uint32_t with the
+ * number of bytes that follow, and the structures below, in host
+ * byte order.  Node ids are those of the frozen graph (and of its
+ * snapshots). */
+struct d_srv_request {
+    uint32_t        src;       /* id of the origin */
+    uint32_t        dst;       /* id of the destination */
+    uint16_t        mode;      /* D_SRV_COST or D_SRV_ROUTE */
+    uint16_t        graph;     /* index of the graph */
+};
+
+struct d_srv_reply {
+    int64_t         cost;      /* minimum cost, or D_SRV_UNREACHED,
+                                * D_SRV_INVALID */
+    uint32_t        usec;      /* time of the query in the server */
+    uint32_t        nodes;     /* ids of the route that follow, from
+                                * the origin (D_SRV_ROUTE only) */
+};
+
+/* how the server gets its graphs ready, and drops them */
+struct d_srv_ops {
+    /* loads the graph file path, and leaves in *data anything that
+     * unload() needs.  It returns NULL (with a message printed) if
+     * the graph cannot be loaded. */
+    struct d_graph *(*load)(const char *path, void **data, void *arg);
+    void            (*unload)(struct d_graph *graph, void *data,
+                                void *arg);
+    void             *arg;
+};
+
+struct d_srv_stats {
+    long            conns;     /* connections accepted */
+    long            queries;   /* queries run */
+    long            unreached; /* queries with no path */
+    long            invalid;   /* requests with bad mode or graph */
+    long            reloads;   /* graphs loaded again */
+    double          lat_avg;   /* average latency of the queries in
+                                * the server, in microseconds */
+    double          lat_max;   /* maximum latency */
+};
+
+/**
+ * Serve queries on a unix domain socket.
+ *
+ * Loads the graph files once (with ops->load()) and listens on a
+ * socket bound to sock_path.  An epoll loop in the calling thread
+ * accepts the connections and reads their requests, that are run
+ * by a pool of nthreads worker threads, each one with its own
+ * query context (see d_query_new()) per graph.  Replies are
+ * written in the order of the requests of each connection, so
+ * requests can be pipelined.
+ *
+ * Text connections send one request per line, as
+ * "src dst [mode [graph]]", where src and dst are node names,
+ * mode is "cost" (the default) or "route", and graph is the index
+ * of the graph (in the order of paths, 0 by default) or its path.
+ * The reply is a line "src dst cost usec", with the route at the
+ * end for "route", as d_batch_run() writes them, or "ERROR reason"
+ * for bad requests.  Binary connections send D_SRV_MAGIC first,
+ * and then frames of struct d_srv_request, each replied by a frame
+ * of struct d_srv_reply.
+ *
+ * SIGHUP loads the graph files again in a separate thread, while
+ * the old graphs keep serving the queries, and then swaps them:
+ * the queries already read finish on the old graphs, that are
+ * dropped (with ops->unload()) once the last one is done.  Graphs
+ * that fail to load are kept.  SIGINT and SIGTERM stop the server,
+ * once the queries read have been replied.
+ *
+ * @param sock_path is the path of the socket, that is replaced if
+ *        it exists, and removed at the end.
+ * @param paths is the array of npaths graph files.
+ * @param ops tells how to load and drop the graphs.
+ * @param nthreads is the number of worker threads.
+ * @param stats if not NULL, gets the statistics of the server.
+ * @return 0 when stopped by a signal, -1 on error (errno tells
+ *         why, if a graph cannot be loaded it's EINVAL).
+ */
+int
+d_srv_run(
+        const char             *sock_path,
+        char                  **paths,
+        int                     npaths,
+        const struct d_srv_ops *ops,
+        int                     nthreads,
+        int                     flags,
+        struct d_srv_stats     *stats);
+
+#endif /* _SERVER_H */
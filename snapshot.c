@@ -0,0 +1,519 @@
+/* snapshot.c -- binary snapshots of frozen graphs.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sat Oct 17 11:02:19 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ *
+ * The file is written in the byte order of the machine.  All the
+ * sections start at offsets multiple of 8, so they can be used in
+ * place once the file is mapped.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "graph.h"
+#include "snapshot.h"
+
+#define F(_fmt) __FILE__":%d:%s: "_fmt,__LINE__,__func__
+
+#define SNAP_MAGIC          "DIJKSNAP"
+#define SNAP_BYTE_ORDER     0x01020304U
+#define SNAP_ALIGN          8
+
+/* sections of the file */
+#define SEC_OFF             0  /* n + 1 link offsets */
+#define SEC_TGT             1  /* m link targets */
+#define SEC_WGT             2  /* m link weights */
+#define SEC_NAME_OFF        3  /* n offsets of the names in the pool */
+#define SEC_BY_NAME         4  /* n node ids, in name order */
+#define SEC_POOL            5  /* node names */
+#define SEC_CH_RANK         6  /* n ranks of the contraction hierarchy */
+#define SEC_CH_UP_OFF       7  /* n + 1 offsets of the up links */
+#define SEC_CH_UP_TGT       8  /* up_m up links */
+#define SEC_CH_UP_WGT       9
+#define SEC_CH_UP_VIA       10
+#define SEC_CH_DN_OFF       11 /* n + 1 offsets of the down links */
+#define SEC_CH_DN_SRC       12 /* dn_m down links */
+#define SEC_CH_DN_WGT       13
+#define SEC_CH_DN_VIA       14
+#define SECTIONS            15
+
+struct snap_header {
+    char            magic[8];  /* SNAP_MAGIC, no nul */
+    uint32_t        version;   /* D_SNAPSHOT_VERSION */
+    uint32_t        byte_order;/* SNAP_BYTE_ORDER */
+    uint64_t        nodes;     /* number of nodes */
+    uint64_t        links;     /* number of links */
+    uint64_t        pool_sz;   /* size of the names pool */
+    uint64_t        ch;        /* nonzero if there's a contraction
+                                * hierarchy */
+    uint64_t        ch_up_m;   /* number of up links */
+    uint64_t        ch_dn_m;   /* number of down links */
+    uint64_t        file_sz;   /* size of the whole file */
+    uint64_t        off[SECTIONS]; /* offset of each section */
+    uint64_t        sum[SECTIONS]; /* checksum of each section */
+    uint64_t        head_sum;  /* checksum of the header, with this
+                                * field set to zero */
+};
+
+/* a fast checksum, processing 8 bytes at a time */
+static uint64_t
+checksum(const void *p, size_t len)
+{
+    const char *s = p;
+    uint64_t h = 0xcbf29ce484222325ULL ^ len, w;
+
+    if (len == 0) return h;
+    while (len >= sizeof w) {
+        memcpy(&w, s, sizeof w);
+        h = (h ^ w) * 0x100000001b3ULL;
+        h = (h << 31) | (h >> 33);
+        s   += sizeof w;
+        len -= sizeof w;
+    }
+    w = 0;
+    memcpy(&w, s, len);
+    h = (h ^ w) * 0x100000001b3ULL;
+    h ^= h >> 29;
+    return h;
+} /* checksum */
+
+static uint64_t
+header_sum(const struct snap_header *h)
+{
+    struct snap_header tmp = *h;
+    tmp.head_sum = 0;
+    return checksum(&tmp, sizeof tmp);
+} /* header_sum */
+
+/* size of each section, from the counts in the header */
+static void
+section_sizes(const struct snap_header *h, uint64_t sz[SECTIONS])
+{
+    sz[SEC_OFF]      = (h->nodes + 1) * sizeof(uint32_t);
+    sz[SEC_TGT]      = h->links * sizeof(uint32_t);
+    sz[SEC_WGT]      = h->links * sizeof(int32_t);
+    sz[SEC_NAME_OFF] = h->nodes * sizeof(uint32_t);
+    sz[SEC_BY_NAME]  = h->nodes * sizeof(uint32_t);
+    sz[SEC_POOL]     = h->pool_sz;
+
+    uint64_t ch_n = h->ch ? h->nodes : 0;
+    sz[SEC_CH_RANK]   = ch_n * sizeof(uint32_t);
+    sz[SEC_CH_UP_OFF] = h->ch ? (ch_n + 1) * sizeof(uint32_t) : 0;
+    sz[SEC_CH_UP_TGT] = h->ch_up_m * sizeof(uint32_t);
+    sz[SEC_CH_UP_WGT] = h->ch_up_m * sizeof(int32_t);
+    sz[SEC_CH_UP_VIA] = h->ch_up_m * sizeof(int32_t);
+    sz[SEC_CH_DN_OFF] = sz[SEC_CH_UP_OFF];
+    sz[SEC_CH_DN_SRC] = h->ch_dn_m * sizeof(uint32_t);
+    sz[SEC_CH_DN_WGT] = h->ch_dn_m * sizeof(int32_t);
+    sz[SEC_CH_DN_VIA] = h->ch_dn_m * sizeof(int32_t);
+} /* section_sizes */
+
+static int
+write_all(int fd, const void *p, size_t len)
+{
+    const char *s = p;
+    while (len > 0) {
+        ssize_t n = write(fd, s, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        s   += n;
+        len -= n;
+    }
+    return 0;
+} /* write_all */
+
+int
+d_save_snapshot(
+        struct d_graph   *graph,
+        const char       *path,
+        int               flags)
+{
+    d_freeze(graph, flags);
+
+    const struct d_csr *csr = graph->csr;
+    const struct d_ch  *ch  = graph->ch;
+    const void *data[SECTIONS] = {
+        [SEC_OFF]      = csr->off,
+        [SEC_TGT]      = csr->tgt,
+        [SEC_WGT]      = csr->wgt,
+        [SEC_NAME_OFF] = csr->name_off,
+        [SEC_BY_NAME]  = csr->by_name,
+        [SEC_POOL]     = csr->pool,
+    };
+    if (ch) {
+        data[SEC_CH_RANK]   = ch->rank;
+        data[SEC_CH_UP_OFF] = ch->up_off;
+        data[SEC_CH_UP_TGT] = ch->up_tgt;
+        data[SEC_CH_UP_WGT] = ch->up_wgt;
+        data[SEC_CH_UP_VIA] = ch->up_via;
+        data[SEC_CH_DN_OFF] = ch->dn_off;
+        data[SEC_CH_DN_SRC] = ch->dn_src;
+        data[SEC_CH_DN_WGT] = ch->dn_wgt;
+        data[SEC_CH_DN_VIA] = ch->dn_via;
+    }
+    struct snap_header h;
+    uint64_t sz[SECTIONS], pos;
+    int i;
+
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, SNAP_MAGIC, sizeof h.magic);
+    h.version    = D_SNAPSHOT_VERSION;
+    h.byte_order = SNAP_BYTE_ORDER;
+    h.nodes      = csr->n;
+    h.links      = csr->m;
+    h.pool_sz    = csr->pool_sz;
+    if (ch) {
+        h.ch      = 1;
+        h.ch_up_m = ch->up_m;
+        h.ch_dn_m = ch->dn_m;
+    }
+    section_sizes(&h, sz);
+    pos = (sizeof h + SNAP_ALIGN - 1) & ~(uint64_t)(SNAP_ALIGN - 1);
+    for (i = 0; i < SECTIONS; ++i) {
+        h.off[i] = pos;
+        h.sum[i] = checksum(data[i], sz[i]);
+        pos = (pos + sz[i] + SNAP_ALIGN - 1)
+                & ~(uint64_t)(SNAP_ALIGN - 1);
+    }
+    h.file_sz  = pos;
+    h.head_sum = header_sum(&h);
+
+    /* write to a temporary file, and rename it at the end */
+    size_t plen = strlen(path);
+    char *tmp = malloc(plen + sizeof ".tmp");
+    assert(tmp != NULL);
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", sizeof ".tmp");
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        free(tmp);
+        return -1;
+    }
+
+    static const char zeros[SNAP_ALIGN];
+    int res = write_all(fd, &h, sizeof h);
+    pos = sizeof h;
+    for (i = 0; res == 0 && i < SECTIONS; ++i) {
+        if (h.off[i] > pos)
+            res = write_all(fd, zeros, h.off[i] - pos);
+        if (res == 0)
+            res = write_all(fd, data[i], sz[i]);
+        pos = h.off[i] + sz[i];
+    }
+    if (res == 0 && h.file_sz > pos)
+        res = write_all(fd, zeros, h.file_sz - pos);
+    if (close(fd) < 0) res = -1;
+    if (res == 0) res = rename(tmp, path);
+
+    int e = errno;
+    if (res < 0) unlink(tmp);
+    free(tmp);
+    errno = e;
+    if (res == 0 && (flags & (D_FLAG_DEBUG | D_FLAG_FREEZE)))
+        printf(F("Graph %s saved to %s (%u nodes, %u links, "
+                "%llu bytes)\n"),
+                graph->name, path, csr->n, csr->m,
+                (unsigned long long)h.file_sz);
+    return res;
+} /* d_save_snapshot */
+
+/* check the header against the file size.  Returns 0 if valid, or
+ * the errno value to return. */
+static int
+check_header(const struct snap_header *h, uint64_t file_sz, int flags)
+{
+    uint64_t sz[SECTIONS];
+    int i;
+
+    if (memcmp(h->magic, SNAP_MAGIC, sizeof h->magic) != 0
+            || h->version != D_SNAPSHOT_VERSION
+            || h->byte_order != SNAP_BYTE_ORDER) {
+        if (flags & D_FLAG_DEBUG)
+            printf(F("not a snapshot of version %d\n"),
+                    D_SNAPSHOT_VERSION);
+        return EINVAL;
+    }
+    if (h->head_sum != header_sum(h)
+            || h->file_sz != file_sz
+            || h->nodes >= UINT32_MAX
+            || h->links > UINT32_MAX
+            || h->pool_sz > UINT32_MAX
+            || h->pool_sz < h->nodes
+            || h->ch_up_m > UINT32_MAX
+            || h->ch_dn_m > UINT32_MAX) {
+        if (flags & D_FLAG_DEBUG)
+            printf(F("corrupt snapshot header\n"));
+        return EBADMSG;
+    }
+    section_sizes(h, sz);
+    for (i = 0; i < SECTIONS; ++i) {
+        if (h->off[i] % SNAP_ALIGN
+                || h->off[i] < sizeof *h
+                || h->off[i] > file_sz
+                || sz[i] > file_sz - h->off[i]) {
+            if (flags & D_FLAG_DEBUG)
+                printf(F("section %d out of the file\n"), i);
+            return EBADMSG;
+        }
+    }
+    return 0;
+} /* check_header */
+
+/* tells if all the n weights of w are non negative, as the searches
+ * require */
+static int
+check_weights(const int32_t *w, uint64_t n)
+{
+    uint64_t i;
+    for (i = 0; i < n; ++i)
+        if (w[i] < 0) return 0;
+    return 1;
+} /* check_weights */
+
+/* tells if the n + 1 offsets of off go up from 0 to m */
+static int
+check_offsets(const uint32_t *off, uint64_t n, uint64_t m)
+{
+    uint64_t i;
+    if (off[0] != 0 || off[n] != m) return 0;
+    for (i = 0; i < n; ++i)
+        if (off[i] > off[i + 1]) return 0;
+    return 1;
+} /* check_offsets */
+
+/* tells if all the len node ids of ids are less than n */
+static int
+check_ids(const uint32_t *ids, uint64_t len, uint64_t n)
+{
+    uint64_t i;
+    for (i = 0; i < len; ++i)
+        if (ids[i] >= n) return 0;
+    return 1;
+} /* check_ids */
+
+/* tells if all the len nodes a shortcut goes through are less
+ * than n, or -1 */
+static int
+check_via(const int32_t *via, uint64_t len, uint64_t n)
+{
+    uint64_t i;
+    for (i = 0; i < len; ++i)
+        if (via[i] < -1 || (int64_t)via[i] >= (int64_t)n) return 0;
+    return 1;
+} /* check_via */
+
+/* tells if the n ids of ids are a permutation of 0 .. n-1 */
+static int
+check_perm(const uint32_t *ids, uint64_t n)
+{
+    unsigned char *seen = calloc(n ? n : 1, 1);
+    uint64_t i;
+    int res = 1;
+
+    assert(seen != NULL);
+    for (i = 0; res && i < n; ++i) {
+        if (ids[i] >= n || seen[ids[i]]) res = 0;
+        else seen[ids[i]] = 1;
+    }
+    free(seen);
+    return res;
+} /* check_perm */
+
+/* check the arrays of the snapshot, so the searches never index out
+ * of them, even with a snapshot whose checksums were not verified.
+ * Returns 0 if valid, or the errno value to return. */
+static int
+check_structure(const struct snap_header *h, const char *base,
+        int flags)
+{
+    const char *what = NULL;
+    const uint32_t *name_off =
+            (const uint32_t *)(base + h->off[SEC_NAME_OFF]);
+    const char *pool = base + h->off[SEC_POOL];
+    uint64_t i;
+
+    if (!check_offsets((const uint32_t *)(base + h->off[SEC_OFF]),
+                h->nodes, h->links))
+        what = "link offsets";
+    else if (!check_ids((const uint32_t *)(base + h->off[SEC_TGT]),
+                h->links, h->nodes))
+        what = "link targets";
+    else if (h->pool_sz > 0 && pool[h->pool_sz - 1] != '\0')
+        what = "names pool";
+    else if (!check_perm((const uint32_t *)(base + h->off[SEC_BY_NAME]),
+                h->nodes))
+        what = "name index";
+    for (i = 0; !what && i < h->nodes; ++i)
+        if (name_off[i] >= h->pool_sz)
+            what = "name offsets";
+    if (!what && h->ch) {
+        if (!check_ids((const uint32_t *)(base + h->off[SEC_CH_RANK]),
+                    h->nodes, h->nodes)
+                || !check_offsets(
+                    (const uint32_t *)(base + h->off[SEC_CH_UP_OFF]),
+                    h->nodes, h->ch_up_m)
+                || !check_ids(
+                    (const uint32_t *)(base + h->off[SEC_CH_UP_TGT]),
+                    h->ch_up_m, h->nodes)
+                || !check_via(
+                    (const int32_t *)(base + h->off[SEC_CH_UP_VIA]),
+                    h->ch_up_m, h->nodes)
+                || !check_offsets(
+                    (const uint32_t *)(base + h->off[SEC_CH_DN_OFF]),
+                    h->nodes, h->ch_dn_m)
+                || !check_ids(
+                    (const uint32_t *)(base + h->off[SEC_CH_DN_SRC]),
+                    h->ch_dn_m, h->nodes)
+                || !check_via(
+                    (const int32_t *)(base + h->off[SEC_CH_DN_VIA]),
+                    h->ch_dn_m, h->nodes))
+            what = "contraction hierarchy";
+    }
+    if (!what) return 0;
+    if (flags & D_FLAG_DEBUG)
+        printf(F("invalid %s in the snapshot\n"), what);
+    return EINVAL;
+} /* check_structure */
+
+struct d_graph *
+d_open_snapshot(
+        const char       *path,
+        int               opts,
+        int               flags)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int e = errno;
+        close(fd);
+        errno = e;
+        return NULL;
+    }
+    if ((uint64_t)st.st_size < sizeof(struct snap_header)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int e = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        errno = e;
+        return NULL;
+    }
+
+    const struct snap_header *h = map;
+    const char *base = map;
+    if ((e = check_header(h, st.st_size, flags)) != 0) {
+        munmap(map, st.st_size);
+        errno = e;
+        return NULL;
+    }
+    if (!(opts & D_SNAPSHOT_NO_VERIFY)) {
+        uint64_t sz[SECTIONS];
+        int i;
+        section_sizes(h, sz);
+        for (i = 0; i < SECTIONS; ++i) {
+            if (checksum(base + h->off[i], sz[i]) != h->sum[i]) {
+                if (flags & D_FLAG_DEBUG)
+                    printf(F("%s: bad checksum in section %d\n"),
+                            path, i);
+                munmap(map, st.st_size);
+                errno = EBADMSG;
+                return NULL;
+            }
+        }
+        if (!check_weights((const int32_t *)(base + h->off[SEC_WGT]),
+                    h->links)
+                || !check_weights(
+                    (const int32_t *)(base + h->off[SEC_CH_UP_WGT]),
+                    h->ch_up_m)
+                || !check_weights(
+                    (const int32_t *)(base + h->off[SEC_CH_DN_WGT]),
+                    h->ch_dn_m)) {
+            if (flags & D_FLAG_DEBUG)
+                printf(F("%s: negative link weights\n"), path);
+            munmap(map, st.st_size);
+            errno = EBADMSG;
+            return NULL;
+        }
+    }
+    if ((e = check_structure(h, base, flags)) != 0) {
+        munmap(map, st.st_size);
+        errno = e;
+        return NULL;
+    }
+
+    struct d_csr *csr = calloc(1, sizeof *csr);
+    assert(csr != NULL);
+    csr->n        = h->nodes;
+    csr->m        = h->links;
+    csr->off      = (uint32_t *)(base + h->off[SEC_OFF]);
+    csr->tgt      = (uint32_t *)(base + h->off[SEC_TGT]);
+    csr->wgt      = (int32_t  *)(base + h->off[SEC_WGT]);
+    csr->name_off = (uint32_t *)(base + h->off[SEC_NAME_OFF]);
+    csr->by_name  = (uint32_t *)(base + h->off[SEC_BY_NAME]);
+    csr->pool     = (char     *)(base + h->off[SEC_POOL]);
+    csr->pool_sz  = h->pool_sz;
+    csr->map      = map;
+    csr->map_sz   = st.st_size;
+
+    struct d_graph *g = d_new_graph((char *)path, flags);
+    assert(g != NULL);
+    g->ro      = 1;
+    g->csr     = csr;
+    g->nodes   = csr->n;
+    g->tab_cap = csr->n;
+    /* node handles are created on demand */
+    g->tab     = calloc(csr->n ? csr->n : 1, sizeof *g->tab);
+    assert(g->tab != NULL);
+    if (h->ch) {
+        struct d_ch *ch = calloc(1, sizeof *ch);
+        assert(ch != NULL);
+        ch->n      = h->nodes;
+        ch->up_m   = h->ch_up_m;
+        ch->dn_m   = h->ch_dn_m;
+        ch->rank   = (uint32_t *)(base + h->off[SEC_CH_RANK]);
+        ch->up_off = (uint32_t *)(base + h->off[SEC_CH_UP_OFF]);
+        ch->up_tgt = (uint32_t *)(base + h->off[SEC_CH_UP_TGT]);
+        ch->up_wgt = (int32_t  *)(base + h->off[SEC_CH_UP_WGT]);
+        ch->up_via = (int32_t  *)(base + h->off[SEC_CH_UP_VIA]);
+        ch->dn_off = (uint32_t *)(base + h->off[SEC_CH_DN_OFF]);
+        ch->dn_src = (uint32_t *)(base + h->off[SEC_CH_DN_SRC]);
+        ch->dn_wgt = (int32_t  *)(base + h->off[SEC_CH_DN_WGT]);
+        ch->dn_via = (int32_t  *)(base + h->off[SEC_CH_DN_VIA]);
+        ch->mapped = 1;
+        g->ch = ch;
+    }
+    if (flags & (D_FLAG_DEBUG | D_FLAG_FREEZE))
+        printf(F("Graph %s opened (%u nodes, %u links%s)\n"),
+                g->name, csr->n, csr->m,
+                g->ch ? ", contraction hierarchy" : "");
+    return g;
+} /* d_open_snapshot */
+
+int
+d_is_snapshot(
+        const char       *path)
+{
+    char magic[sizeof SNAP_MAGIC - 1];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    ssize_t n = read(fd, magic, sizeof magic);
+    close(fd);
+    return n == sizeof magic
+        && memcmp(magic, SNAP_MAGIC, sizeof magic) == 0;
+} /* d_is_snapshot */
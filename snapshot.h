@@ -0,0 +1,78 @@
+/* snapshot.h -- binary snapshots of frozen graphs.
+ * Author: Luis Colorado <luiscoloradourcola@gmail.com>
+ * Date: Sat Oct 17 11:02:19 EEST 2026
+ * Copyright: (C) 2026 Luis Colorado.  All rights reserved.
+ * License: BSD.
+ */
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include "dijkstra.h"
+
+#define D_SNAPSHOT_VERSION  2          /* version of the file format */
+
+#define D_SNAPSHOT_NO_VERIFY (1 << 0)  /* don't check the data checksums */
+
+/**
+ * Save a graph in a binary snapshot file.
+ *
+ * The graph is frozen (see d_freeze()) and its frozen layout is
+ * written to the file: a header with the format version, the
+ * number of nodes and links and the checksums of the header and
+ * of every section, followed by the sections (offsets, targets
+ * and weights of the links, already sorted, and the node names,
+ * plus the contraction hierarchy if the graph has one, see ch.h).
+ * The file is written under a temporary name, and renamed at the
+ * end, so a reader never sees a partially written snapshot.
+ *
+ * @param graph is the graph to save.
+ * @param path is the name of the snapshot file.
+ * @return 0 on success, -1 on error (errno tells why).
+ */
+int
+d_save_snapshot(
+        struct d_graph   *graph,
+        const char       *path,
+        int               flags);
+
+/**
+ * Open a snapshot file as a graph.
+ *
+ * The file is mapped into memory and used in place as the frozen
+ * layout of a new graph, so there's no parsing nor sorting, and
+ * the graph can be queried immediately.  The header is checked
+ * (format version, byte order, sizes and checksum) and, unless
+ * D_SNAPSHOT_NO_VERIFY is given in opts, the checksums of all the
+ * sections are verified, and so is that no link weight is negative.
+ * The arrays are always checked to index within the graph: link
+ * offsets going up to the number of links, node ids and names in
+ * range, a nul terminated pool of names and a name index that is a
+ * permutation of the nodes (and so the contraction hierarchy).
+ *
+ * The graph is read only: d_lookup_node() doesn't create nodes
+ * (it returns NULL if the node doesn't exist) and d_add_link()
+ * fails.  The d_node structures are created the first time they
+ * are needed.  The graph is released with d_free_graph().
+ *
+ * @param path is the name of the snapshot file.
+ * @param opts is a combination of D_SNAPSHOT_* flags.
+ * @return the graph, or NULL on error (errno tells why, EINVAL
+ *         for a file that is not a snapshot of this version or
+ *         whose arrays don't index within the graph, and EBADMSG
+ *         for a corrupt one).
+ */
+struct d_graph *
+d_open_snapshot(
+        const char       *path,
+        int               opts,
+        int               flags);
+
+/**
+ * @return nonzero if the file at path starts as a snapshot.
+ */
+int
+d_is_snapshot(
+        const char       *path);
+
+#endif /* _SNAPSHOT_H */